@@ -6,6 +6,9 @@
 #include "glslStruct.h"
 #include "glslSymbol.h"
 
+#include <math.h>
+#include <stdlib.h>
+
 /// Table to convert GLSL variable types to strings
 const char typeString[EgstTypeCount][32] = 
 {
@@ -37,6 +40,478 @@ const char typeString[EgstTypeCount][32] =
    "struct"
 };
 
+
+//----------------GlslStringBuilder------------------
+
+GlslStringBuilder::GlslStringBuilder()
+: last(&head)
+, length(0)
+{
+	head.next = 0;
+	head.data = inlineData;
+	head.used = 0;
+	head.capacity = kInlineSize;
+}
+
+
+GlslStringBuilder::~GlslStringBuilder()
+{
+	clear();
+}
+
+
+void GlslStringBuilder::clear()
+{
+	Chunk* c = head.next;
+	while (c)
+	{
+		Chunk* next = c->next;
+		free (c);
+		c = next;
+	}
+	head.next = 0;
+	head.used = 0;
+	last = &head;
+	length = 0;
+}
+
+
+void GlslStringBuilder::reset()
+{
+	for (Chunk* c = &head; c; c = c->next)
+		c->used = 0;
+	last = &head;
+	length = 0;
+}
+
+
+void GlslStringBuilder::appendSlow (const char* s, size_t len)
+{
+	// fill up the current chunk and any kept by reset, then put the rest into a new one
+	// that is big enough
+	for (;;)
+	{
+		size_t room = last->capacity - last->used;
+		if (room > len)
+			room = len;
+		memcpy (last->data + last->used, s, room);
+		last->used += room;
+		length += room;
+		s += room;
+		len -= room;
+		if (len == 0)
+			return;
+		if (!last->next)
+			break;
+		last = last->next;
+	}
+
+	// chunks grow with the text so long outputs need only a few of them
+	size_t capacity = length < kMinChunkSize ? (size_t)kMinChunkSize : length;
+	if (capacity < len)
+		capacity = len;
+	Chunk* c = (Chunk*)malloc (sizeof(Chunk) + capacity);
+	c->next = 0;
+	c->data = (char*)(c + 1);
+	c->used = len;
+	c->capacity = capacity;
+	memcpy (c->data, s, len);
+	last->next = c;
+	last = c;
+	length += len;
+}
+
+
+GlslStringBuilder& GlslStringBuilder::append (const GlslStringBuilder& other)
+{
+	assert (&other != this);
+	for (const Chunk* c = &other.head; c; c = c->next)
+		append (c->data, c->used);
+	return *this;
+}
+
+
+std::string GlslStringBuilder::str() const
+{
+	std::string res;
+	res.reserve (length);
+	for (const Chunk* c = &head; c; c = c->next)
+		res.append (c->data, c->used);
+	return res;
+}
+
+
+GlslStringBuilder& GlslStringBuilder::appendInteger (unsigned long long v, bool negative)
+{
+	char buffer[24];
+	char* end = buffer + sizeof(buffer);
+	char* p = end;
+	do
+	{
+		*--p = char('0' + v % 10);
+		v /= 10;
+	} while (v);
+	if (negative)
+		*--p = '-';
+	return append (p, end - p);
+}
+
+
+GlslStringBuilder& GlslStringBuilder::operator<< (int v) { return *this << (long long)v; }
+GlslStringBuilder& GlslStringBuilder::operator<< (unsigned v) { return appendInteger (v, false); }
+GlslStringBuilder& GlslStringBuilder::operator<< (long v) { return *this << (long long)v; }
+GlslStringBuilder& GlslStringBuilder::operator<< (unsigned long v) { return appendInteger (v, false); }
+GlslStringBuilder& GlslStringBuilder::operator<< (unsigned long long v) { return appendInteger (v, false); }
+
+GlslStringBuilder& GlslStringBuilder::operator<< (long long v)
+{
+	// negate in unsigned arithmetic so the most negative value works too
+	if (v < 0)
+		return appendInteger (0ULL - (unsigned long long)v, true);
+	return appendInteger ((unsigned long long)v, false);
+}
+
+
+//----------------shortest round-trip float formatting------------------
+//
+// Finds the shortest decimal digit string that reads back as exactly the same float,
+// with the free-format algorithm of Steele & White / Burger & Dybvig. A float needs at
+// most ~180 bits of exact integer arithmetic here, so a small fixed-size big number is
+// enough and no allocation or global state is involved. Most literals in shaders are of
+// moderate magnitude, where all the numbers involved fit into 64 bits; those take the
+// same code with plain integers.
+
+namespace {
+
+struct ShortBigNum
+{
+	enum { kMaxWords = 10 };
+	unsigned words[kMaxWords]; // little endian
+	int count;
+
+	void set (unsigned long long v)
+	{
+		count = 0;
+		while (v)
+		{
+			words[count++] = (unsigned)v;
+			v >>= 32;
+		}
+	}
+
+	void mulSmall (unsigned x)
+	{
+		unsigned long long carry = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			unsigned long long t = (unsigned long long)words[i] * x + carry;
+			words[i] = (unsigned)t;
+			carry = t >> 32;
+		}
+		if (carry)
+		{
+			assert (count < kMaxWords);
+			words[count++] = (unsigned)carry;
+		}
+	}
+
+	void mulPow10 (int n)
+	{
+		for (; n >= 9; n -= 9)
+			mulSmall (1000000000u);
+		static const unsigned kPow10[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+		if (n > 0)
+			mulSmall (kPow10[n]);
+	}
+
+	void shiftLeft (int bits)
+	{
+		if (count == 0)
+			return;
+		const int wordShift = bits / 32;
+		const int bitShift = bits % 32;
+		assert (count + wordShift + 1 <= kMaxWords);
+		words[count + wordShift] = 0;
+		for (int i = count - 1; i >= 0; --i)
+		{
+			if (bitShift)
+				words[i + wordShift + 1] |= words[i] >> (32 - bitShift);
+			words[i + wordShift] = words[i] << bitShift;
+		}
+		for (int i = 0; i < wordShift; ++i)
+			words[i] = 0;
+		count += wordShift + 1;
+		while (count > 0 && words[count - 1] == 0)
+			--count;
+	}
+
+	static int compare (const ShortBigNum& a, const ShortBigNum& b)
+	{
+		if (a.count != b.count)
+			return a.count < b.count ? -1 : 1;
+		for (int i = a.count - 1; i >= 0; --i)
+			if (a.words[i] != b.words[i])
+				return a.words[i] < b.words[i] ? -1 : 1;
+		return 0;
+	}
+
+	static void add (ShortBigNum& res, const ShortBigNum& a, const ShortBigNum& b)
+	{
+		const ShortBigNum& lng = a.count >= b.count ? a : b;
+		const ShortBigNum& shrt = a.count >= b.count ? b : a;
+		unsigned long long carry = 0;
+		int i = 0;
+		for (; i < lng.count; ++i)
+		{
+			unsigned long long t = (unsigned long long)lng.words[i] + (i < shrt.count ? shrt.words[i] : 0) + carry;
+			res.words[i] = (unsigned)t;
+			carry = t >> 32;
+		}
+		res.count = lng.count;
+		if (carry)
+		{
+			assert (res.count < kMaxWords);
+			res.words[res.count++] = (unsigned)carry;
+		}
+	}
+
+	// Replaces the number with its remainder by d and returns the quotient, which has to be below 10
+	int divideDigit (const ShortBigNum& d)
+	{
+		int digit = 0;
+		while (compare (*this, d) >= 0)
+		{
+			sub (d);
+			++digit;
+		}
+		return digit;
+	}
+
+	// a -= b, requires a >= b
+	void sub (const ShortBigNum& b)
+	{
+		long long borrow = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			long long t = (long long)words[i] - (i < b.count ? b.words[i] : 0) - borrow;
+			borrow = t < 0 ? 1 : 0;
+			words[i] = (unsigned)(t + (borrow << 32));
+		}
+		while (count > 0 && words[count - 1] == 0)
+			--count;
+	}
+};
+
+
+// Same interface as ShortBigNum for values that are known to stay below 2^64
+struct ShortU64
+{
+	unsigned long long v;
+
+	void set (unsigned long long x) { v = x; }
+	void mulSmall (unsigned x) { v *= x; }
+	void mulPow10 (int n) { while (n-- > 0) v *= 10; }
+	void shiftLeft (int bits) { v <<= bits; }
+	int divideDigit (const ShortU64& d) { int digit = (int)(v / d.v); v %= d.v; return digit; }
+	static int compare (const ShortU64& a, const ShortU64& b) { return a.v < b.v ? -1 : (a.v > b.v ? 1 : 0); }
+	static void add (ShortU64& res, const ShortU64& a, const ShortU64& b) { res.v = a.v + b.v; }
+};
+
+} // namespace
+
+
+// Writes the shortest digits of a positive finite float to digits (at most 9) and returns
+// their count; the value is 0.d1d2d3... * 10^exponent10.
+template <typename Num>
+static int ShortestFloatDigits (unsigned mantissa, int exponent2, bool lowerGapIsSmaller, char* digits, int& exponent10)
+{
+	// value = r / s, with the rounding interval extending mMinus below and mPlus above it
+	Num r, s, mPlus, mMinus;
+	const bool acceptBounds = (mantissa & 1) == 0; // ties round to even when the text is read back
+	if (exponent2 >= 0)
+	{
+		r.set (mantissa);
+		r.shiftLeft (exponent2 + (lowerGapIsSmaller ? 2 : 1));
+		s.set (lowerGapIsSmaller ? 4 : 2);
+		mPlus.set (1);
+		mPlus.shiftLeft (exponent2 + (lowerGapIsSmaller ? 1 : 0));
+		mMinus.set (1);
+		mMinus.shiftLeft (exponent2);
+	}
+	else
+	{
+		r.set ((unsigned long long)mantissa << (lowerGapIsSmaller ? 2 : 1));
+		s.set (1);
+		s.shiftLeft (-exponent2 + (lowerGapIsSmaller ? 2 : 1));
+		mPlus.set (lowerGapIsSmaller ? 2 : 1);
+		mMinus.set (1);
+	}
+
+	// estimate the decimal exponent; this is either exact or one too small
+	int bits = 0;
+	for (unsigned m = mantissa; m; m >>= 1)
+		++bits;
+	int k = (int)ceil ((exponent2 + bits - 1) * 0.30102999566398114 - 1e-10);
+	if (k >= 0)
+		s.mulPow10 (k);
+	else
+	{
+		r.mulPow10 (-k);
+		mPlus.mulPow10 (-k);
+		mMinus.mulPow10 (-k);
+	}
+	Num high;
+	Num::add (high, r, mPlus);
+	int cmp = Num::compare (high, s);
+	if (acceptBounds ? cmp >= 0 : cmp > 0)
+	{
+		s.mulSmall (10);
+		++k;
+	}
+	exponent10 = k;
+
+	int count = 0;
+	for (;;)
+	{
+		r.mulSmall (10);
+		mPlus.mulSmall (10);
+		mMinus.mulSmall (10);
+		int digit = r.divideDigit (s);
+		cmp = Num::compare (r, mMinus);
+		const bool low = acceptBounds ? cmp <= 0 : cmp < 0;
+		Num::add (high, r, mPlus);
+		cmp = Num::compare (high, s);
+		bool up = acceptBounds ? cmp >= 0 : cmp > 0;
+		if (!low && !up)
+		{
+			digits[count++] = char('0' + digit);
+			continue;
+		}
+		if (low && up)
+		{
+			// both neighbours read back fine; pick the closer one
+			Num twice = r;
+			twice.mulSmall (2);
+			up = Num::compare (twice, s) >= 0;
+		}
+		digits[count++] = char('0' + digit + (up ? 1 : 0));
+		return count;
+	}
+}
+
+
+GlslStringBuilder& GlslStringBuilder::operator<< (float v)
+{
+	union { float f; unsigned u; } bits;
+	bits.f = v;
+	const bool negative = (bits.u >> 31) != 0;
+	const int biasedExponent = (bits.u >> 23) & 0xff;
+	unsigned mantissa = bits.u & 0x7fffff;
+
+	char buffer[32];
+	char* p = buffer;
+	if (negative)
+		*p++ = '-';
+
+	if (biasedExponent == 0xff)
+	{
+		// not representable in GLSL anyway; match what printf would produce
+		if (mantissa)
+			return append ("nan", 3);
+		memcpy (p, "inf", 3);
+		return append (buffer, p + 3 - buffer);
+	}
+	if (biasedExponent == 0 && mantissa == 0)
+	{
+		memcpy (p, "0.0", 3);
+		return append (buffer, p + 3 - buffer);
+	}
+
+	char digits[12];
+	int count, exponent10;
+	const float magnitude = negative ? -v : v;
+	if (magnitude < 16777216.0f && magnitude == (float)(int)magnitude)
+	{
+		// integers below 2^24 are exact, and their digits are the shortest representation
+		unsigned n = (unsigned)magnitude;
+		char tmp[12];
+		int len = 0;
+		for (; n; n /= 10)
+			tmp[len++] = char('0' + n % 10);
+		exponent10 = len;
+		count = 0;
+		while (len > 0)
+			digits[count++] = tmp[--len];
+		while (digits[count - 1] == '0')
+			--count;
+	}
+	else
+	{
+		int exponent2;
+		bool lowerGapIsSmaller = false;
+		if (biasedExponent == 0)
+			exponent2 = -149;
+		else
+		{
+			exponent2 = biasedExponent - 150;
+			lowerGapIsSmaller = mantissa == 0 && biasedExponent > 1;
+			mantissa |= 0x800000;
+		}
+		// within this range s stays below 2^60 after all the scaling, so r, the margins and
+		// their sums stay below 2^64 when multiplied by 10 for each digit
+		if (exponent2 >= -52 && exponent2 <= 24)
+			count = ShortestFloatDigits<ShortU64> (mantissa, exponent2, lowerGapIsSmaller, digits, exponent10);
+		else
+			count = ShortestFloatDigits<ShortBigNum> (mantissa, exponent2, lowerGapIsSmaller, digits, exponent10);
+	}
+
+	// the number is 0.digits * 10^exponent10; write it out in fixed notation for reasonable
+	// magnitudes, always with a decimal point so GLSL sees a float
+	const int pointPos = exponent10;
+	if (pointPos > 0 && pointPos <= 9)
+	{
+		for (int i = 0; i < pointPos; ++i)
+			*p++ = i < count ? digits[i] : '0';
+		*p++ = '.';
+		if (count > pointPos)
+			for (int i = pointPos; i < count; ++i)
+				*p++ = digits[i];
+		else
+			*p++ = '0';
+	}
+	else if (pointPos <= 0 && pointPos > -5)
+	{
+		*p++ = '0';
+		*p++ = '.';
+		for (int i = pointPos; i < 0; ++i)
+			*p++ = '0';
+		for (int i = 0; i < count; ++i)
+			*p++ = digits[i];
+	}
+	else
+	{
+		*p++ = digits[0];
+		*p++ = '.';
+		if (count > 1)
+			for (int i = 1; i < count; ++i)
+				*p++ = digits[i];
+		else
+			*p++ = '0';
+		*p++ = 'e';
+		int e = pointPos - 1;
+		if (e < 0)
+		{
+			*p++ = '-';
+			e = -e;
+		}
+		if (e >= 10)
+			*p++ = char('0' + e / 10);
+		*p++ = char('0' + e % 10);
+	}
+	return append (buffer, p - buffer);
+}
+
+
 const char* getGLSLPrecisiontring (TPrecision p)
 {
 	switch (p) {
@@ -55,7 +530,7 @@ const char* getGLSLPrecisiontring (TPrecision p)
 ///       The type of the GLSL symbol to output
 ///    \param s
 ///       If it is a structure, a pointer to the structure to write out
-void writeType (std::stringstream &out, EGlslSymbolType type, GlslStruct *s, TPrecision precision)
+void writeType (GlslStringBuilder &out, EGlslSymbolType type, GlslStruct *s, TPrecision precision)
 {
 	if (type >= EgstInt) // precision does not apply to void/bool
 		out << getGLSLPrecisiontring (precision);
@@ -180,7 +655,7 @@ EGlslQualifier translateQualifier( TQualifier qual )
 
 
 //----------------write uniform non-square matrix operand as array of vector------------------
-void writeUniformNQMOperand(const GlslSymbol* sym, const char *varName, std::stringstream& out)
+void writeUniformNQMOperand(const GlslSymbol* sym, const char *varName, GlslStringBuilder& out)
 {
 	int totalParams = sym->isArray()? sym->getArraySize(): 1;
 	out << sym->getStruct()->getName();
@@ -204,7 +679,7 @@ void writeUniformNQMOperand(const GlslSymbol* sym, const char *varName, std::str
 	}
 	out << ")";
 }
-void writeUniformNQMOperand(const GlslSymbol* sym, std::stringstream& out)
+void writeUniformNQMOperand(const GlslSymbol* sym, GlslStringBuilder& out)
 {
 	writeUniformNQMOperand(sym, sym->getName().c_str(), out);
 }
\ No newline at end of file
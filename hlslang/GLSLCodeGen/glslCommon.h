@@ -6,7 +6,7 @@
 #ifndef GLSL_COMMON_H
 #define GLSL_COMMON_H
 
-#include <sstream>
+#include <string.h>
 
 #include "localintermediate.h"
 
@@ -55,12 +55,99 @@ enum EGlslQualifier
 };
 
 
+/// Append-only text buffer that all the GLSL code generation writes into.
+///
+/// Text is kept in a list of chunks: the first one lives inside the object, so the many
+/// short-lived buffers used for subexpressions never touch the heap, and growing never
+/// moves text that was already written. Numbers are formatted directly instead of going
+/// through iostreams and the current locale. A builder can be appended to another one
+/// as is, without first flattening it into a std::string.
+class GlslStringBuilder
+{
+public:
+	struct Chunk
+	{
+		Chunk* next;
+		char* data;
+		size_t used;
+		size_t capacity;
+	};
+
+	GlslStringBuilder();
+	~GlslStringBuilder();
+
+	GlslStringBuilder& append (const char* s, size_t len)
+	{
+		if (len <= last->capacity - last->used)
+		{
+			memcpy (last->data + last->used, s, len);
+			last->used += len;
+			length += len;
+		}
+		else
+			appendSlow (s, len);
+		return *this;
+	}
+	GlslStringBuilder& append (const GlslStringBuilder& other);
+
+	GlslStringBuilder& operator<< (const char* s) { return append (s, strlen(s)); }
+	GlslStringBuilder& operator<< (const std::string& s) { return append (s.data(), s.size()); }
+	GlslStringBuilder& operator<< (const TString& s) { return append (s.data(), s.size()); }
+	GlslStringBuilder& operator<< (const GlslStringBuilder& other) { return append (other); }
+	GlslStringBuilder& operator<< (char c) { return append (&c, 1); }
+	GlslStringBuilder& operator<< (int v);
+	GlslStringBuilder& operator<< (unsigned v);
+	GlslStringBuilder& operator<< (long v);
+	GlslStringBuilder& operator<< (unsigned long v);
+	GlslStringBuilder& operator<< (long long v);
+	GlslStringBuilder& operator<< (unsigned long long v);
+
+	/// Writes the shortest text that reads back as exactly the same float. There is always
+	/// a decimal point, so GLSL treats the literal as a float.
+	GlslStringBuilder& operator<< (float v);
+
+	size_t size() const { return length; }
+	bool empty() const { return length == 0; }
+
+	/// Drops all the text, keeping the inline chunk only
+	void clear();
+
+	/// Drops all the text, keeping every chunk to be filled again
+	void reset();
+
+	/// Returns a flat copy of the text
+	std::string str() const;
+
+	/// Replaces the text
+	void str (const char* s) { clear(); *this << s; }
+	void str (const std::string& s) { clear(); *this << s; }
+
+	/// Chunks in order, for consumers that can work on the text piecewise
+	const Chunk* getFirstChunk() const { return &head; }
+
+private:
+	GlslStringBuilder (const GlslStringBuilder&);
+	GlslStringBuilder& operator= (const GlslStringBuilder&);
+	GlslStringBuilder& operator<< (double);
+
+	void appendSlow (const char* s, size_t len);
+	GlslStringBuilder& appendInteger (unsigned long long v, bool negative);
+
+	enum { kInlineSize = 120, kMinChunkSize = 4096 };
+
+	Chunk head;
+	Chunk* last;
+	size_t length;
+	char inlineData[kInlineSize];
+};
+
+
 // Forward Declarations
 class GlslStruct;
 class GlslSymbol;
 
 /// Outputs the type of the symbol to the output buffer
-void writeType(std::stringstream &out, EGlslSymbolType type, GlslStruct *s, TPrecision precision);
+void writeType(GlslStringBuilder &out, EGlslSymbolType type, GlslStruct *s, TPrecision precision);
 
 const char *getTypeString( const EGlslSymbolType t );
 const char *getGLSLPrecisiontring (TPrecision prec);
@@ -72,7 +159,7 @@ EGlslSymbolType translateType( const TType *type );
 EGlslQualifier translateQualifier( TQualifier qual);
 
 /// Write uniform non-square matrix operand as array of vector
-void writeUniformNQMOperand(const GlslSymbol* sym, std::stringstream& out);
-void writeUniformNQMOperand(const GlslSymbol* sym, const char *name, std::stringstream& out);
+void writeUniformNQMOperand(const GlslSymbol* sym, GlslStringBuilder& out);
+void writeUniformNQMOperand(const GlslSymbol* sym, const char *name, GlslStringBuilder& out);
 
 #endif //GLSL_COMMON_H
@@ -17,11 +17,7 @@ GlslFunction::GlslFunction( const std::string &n, const std::string &m, EGlslSym
 , depth(0)
 , inStatement(false)
 { 
-	active = new std::stringstream();
-	active->setf ( std::stringstream::showpoint );
-	active->unsetf(std::ios::fixed);
-	active->unsetf(std::ios::scientific);
-	active->precision (6);
+	active = new GlslStringBuilder();
 	pushDepth(0);
 }
 
@@ -107,7 +103,7 @@ void GlslFunction::addParameter (GlslSymbol *sym)
 
 std::string GlslFunction::getPrototype() const
 {
-	std::stringstream out;
+	GlslStringBuilder out;
 
 	writeType (out, returnType, structPtr, precision);
 	out << " " << name << "( ";
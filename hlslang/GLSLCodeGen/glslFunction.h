@@ -31,7 +31,7 @@ public:
 	std::string getPrototype() const;
 
 	/// Returns the active scope
-	std::string getCode() const { return active->str(); }
+	const GlslStringBuilder& getCode() const { return *active; }
 
 	int getParameterCount() { return (int)parameters.size();}   
 	GlslSymbol* getParameter( int i ) { return parameters[i];}
@@ -50,7 +50,7 @@ public:
 	void pushDepth(int depth);
 	void popDepth();
 
-	void indent( std::stringstream &s ) { for (int ii = 0; ii < depth.back(); ii++) s << "    "; }
+	void indent( GlslStringBuilder &s ) { for (int ii = 0; ii < depth.back(); ii++) s << "    "; }
 	void indent() { indent(*active); }
 
 	void beginBlock( bool brace = true) { if (brace) *active << "{\n"; increaseDepth(); inStatement = false; }
@@ -68,8 +68,8 @@ public:
 	const std::string& getSemantic() const { return semantic; }    
 	GlslStruct* getStruct() { return structPtr; }   
 	void setStruct( GlslStruct *s ) { structPtr = s;}
-	void setActiveOutput(std::stringstream* output) { active = output; }
-	std::stringstream& getActiveOutput () { return *active; }
+	void setActiveOutput(GlslStringBuilder* output) { active = output; }
+	GlslStringBuilder& getActiveOutput () { return *active; }
 	const TSourceLoc& getLine() const { return line; }
 
 private:
@@ -104,7 +104,7 @@ private:
 	std::set<TOperator> libFunctions;
 
 	// Stores the active output of the function
-	std::stringstream* active;
+	GlslStringBuilder* active;
 
 	bool inStatement;
 };
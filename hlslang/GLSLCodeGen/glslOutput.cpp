@@ -54,7 +54,7 @@ int getElements( EGlslSymbolType t )
 }
 
 TString buildArrayConstructorString(const TType& type) {
-	std::stringstream constructor;
+	GlslStringBuilder constructor;
 	constructor << getTypeString(translateType(&type))
 				<< '[' << type.getArraySize() << ']';
 
@@ -62,7 +62,7 @@ TString buildArrayConstructorString(const TType& type) {
 }
 
 
-void writeConstantConstructor( std::stringstream& out, EGlslSymbolType t, TPrecision prec, TIntermConstant *c, GlslStruct *structure = 0 )
+void writeConstantConstructor( GlslStringBuilder& out, EGlslSymbolType t, TPrecision prec, TIntermConstant *c, GlslStruct *structure = 0 )
 {
 	unsigned n_elems = getElements(t);
 	bool construct = n_elems > 1 || structure != 0;
@@ -110,7 +110,7 @@ void writeConstantConstructor( std::stringstream& out, EGlslSymbolType t, TPreci
 }
 
 
-void writeTempVarDecl(const TType *type, const char* tempVarName, TGlslOutputTraverser* goit, std::stringstream& out)
+void writeTempVarDecl(const TType *type, const char* tempVarName, TGlslOutputTraverser* goit, GlslStringBuilder& out)
 {
 	if (type->getBasicType() == EbtStruct)
 		out << type->getTypeName();
@@ -125,7 +125,7 @@ void writeTempVarDecl(const TType *type, const char* tempVarName, TGlslOutputTra
 		out << "[" << type->getArraySize() << "]";
 }
 
-void writeTempVarAssign(const TType *type, const char* tempVarName, TGlslOutputTraverser* goit, std::stringstream& out)
+void writeTempVarAssign(const TType *type, const char* tempVarName, TGlslOutputTraverser* goit, GlslStringBuilder& out)
 {
 	if (type->getBasicType() == EbtStruct)
 		out << type->getTypeName();
@@ -141,7 +141,7 @@ void writeTempVarAssign(const TType *type, const char* tempVarName, TGlslOutputT
 	out << " = ";
 }
 
-void writeTempVarAssign(const TType *type, const std::string& tempVarName, TGlslOutputTraverser* goit, std::stringstream& out)
+void writeTempVarAssign(const TType *type, const std::string& tempVarName, TGlslOutputTraverser* goit, GlslStringBuilder& out)
 {
 #if defined DEBUG || defined _DEBUG
 	bool dbgbreak = tempVarName.compare("xlat_bintemp45") == 0;
@@ -150,7 +150,7 @@ void writeTempVarAssign(const TType *type, const std::string& tempVarName, TGlsl
 }
 
 //----------------write an operand which is an element of uniform non-square matrix( uniform non-square matrix is transformed to an array of vector)------------------
-void writeUniformNQMArrayElementOperand(const TType* type, const char* varName, const char* indexEpr, std::stringstream& out)
+void writeUniformNQMArrayElementOperand(const TType* type, const char* varName, const char* indexEpr, GlslStringBuilder& out)
 {
 	out << type->getTypeName();
 	out << "(";
@@ -166,7 +166,7 @@ void writeUniformNQMArrayElementOperand(const TType* type, const char* varName,
 void writeComparison( const TString &compareOp, const TString &compareCall, TIntermBinary *node, TGlslOutputTraverser* goit ) 
 {
    GlslFunction *current = goit->current;    
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
    bool l_parentRequireValue = goit->parentRequireValue;
    bool bUseCompareCall = false;
 
@@ -179,7 +179,7 @@ void writeComparison( const TString &compareOp, const TString &compareCall, TInt
 
    //---------------------------------
    std::string leftOut;
-   std::stringstream childOutStream;//this also be used as rightOut
+   GlslStringBuilder childOutStream;//this also be used as rightOut
    bool needTempVar = false;
    //----traverse left and right-------------------
 	goit->parentRequireValue = true;//require them return values
@@ -191,7 +191,7 @@ void writeComparison( const TString &compareOp, const TString &compareCall, TInt
 		node->getLeft()->traverse(goit);	
 		if (goit->tempVariableName.size() > 0)//we have temporary variable
 		{
-			out << childOutStream.str();//write its calculation first
+			out << childOutStream;//write its calculation first
 			leftOut = goit->tempVariableName;
 			needTempVar = true;
 		}
@@ -200,14 +200,14 @@ void writeComparison( const TString &compareOp, const TString &compareCall, TInt
 	}
 	//right
 	goit->tempVariableName = "";
-	childOutStream.str("");//clear right's output stream
+	childOutStream.clear();//clear right's output stream
 	current->setActiveOutput(&childOutStream);
 	if (node->getRight())
 	{
 		node->getRight()->traverse(goit);	
 		if (goit->tempVariableName.size() > 0)//we have temporary variable
 		{
-			out << childOutStream.str();//write its calculation first
+			out << childOutStream;//write its calculation first
 			childOutStream.str(goit->tempVariableName);
 			needTempVar = true;
 		}
@@ -259,13 +259,13 @@ void writeComparison( const TString &compareOp, const TString &compareCall, TInt
          {
             out << "vec" <<  node->getLeft()->getNominalSize() << "( ";
 
-            out << childOutStream.str();
+            out << childOutStream;
 
             out << " )";             
          }
          else
          {
-            out << childOutStream.str();
+            out << childOutStream;
          }         
       }
       out << ")";
@@ -279,7 +279,7 @@ void writeComparison( const TString &compareOp, const TString &compareCall, TInt
          out << leftOut;
       out << " " << compareOp << " ";
       if (node->getRight())
-         out << childOutStream.str();
+         out << childOutStream;
 
       out << ")";
    }
@@ -299,7 +299,7 @@ void writeFuncCall( const TString &name, TIntermAggregate *node, TGlslOutputTrav
    TIntermSequence::iterator sit;
    TIntermSequence &sequence = node->getSequence(); 
    GlslFunction *current = goit->current;
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
    bool l_parentRequireValue = goit->parentRequireValue;
    bool l_parentInlining = goit->isInlining;
    bool isFuncReturn = node->getTypePointer()->getBasicType() != EbtVoid;//does this function return something
@@ -313,13 +313,13 @@ void writeFuncCall( const TString &name, TIntermAggregate *node, TGlslOutputTrav
    for (sit = sequence.begin(); sit != sequence.end(); ++sit)
 	{
 		goit->tempVariableName = "";
-		std::stringstream paramOutStream;
+		GlslStringBuilder paramOutStream;
 		current->setActiveOutput(&paramOutStream);
 		(*sit)->traverse(goit);
 
 		if (goit->tempVariableName.size() > 0)//we have temporary variable holding data calculated from last traversal
 		{
-			out << paramOutStream.str();//write the temporary variable calculation first
+			out << paramOutStream;//write the temporary variable calculation first
 			paramsOut.push_back(goit->tempVariableName);//use this temporary variable as a parameter
 			needTempVar = true;//we need new temp variable to hold the return value of this function call
 		}
@@ -518,7 +518,7 @@ void TGlslOutputTraverser::outputLineDirective (const TSourceLoc& line)
 		return;
 	if (SafeEquals(line.file, m_LastLineOutput.file) && std::abs(line.line - m_LastLineOutput.line) < 4) // don't sprinkle too many #line directives ;)
 		return;
-	std::stringstream& out = current->getActiveOutput();
+	GlslStringBuilder& out = current->getActiveOutput();
 	out << '\n';
 	current->indent(); // without this we could dry the code out further to put the preceeding CRLF in the shared function
 	OutputLineDirective(out, line);
@@ -531,7 +531,7 @@ TGlslOutputTraverser::TGlslOutputTraverser(TInfoSink& i,
 										   std::vector<GlslFunction*> &funcList, 
 										   std::vector<GlslStruct*> &sList, 
 										   std::map<TString, TIntermAggregate*> &_inlinefuncList,
-										   std::stringstream& deferredArrayInit, 
+										   GlslStringBuilder& deferredArrayInit, 
 										   ETargetVersion version, 
 										   unsigned options)
 : infoSink(i)
@@ -580,7 +580,7 @@ void TGlslOutputTraverser::traverseArrayDeclarationWithInit(TIntermDeclaration*
 {
 	assert(decl->containsArrayInitialization());
 	
-	std::stringstream* out = &current->getActiveOutput();
+	GlslStringBuilder* out = &current->getActiveOutput();
 	TType& type = *decl->getTypePointer();
 	EGlslSymbolType symbol_type = translateType(decl->getTypePointer());
 	
@@ -591,7 +591,7 @@ void TGlslOutputTraverser::traverseArrayDeclarationWithInit(TIntermDeclaration*
 	if (emit_both)
 	{
 		current->indent(*out);
-		(*out) << "#if defined(HLSL2GLSL_ENABLE_ARRAY_120_WORKAROUND)" << std::endl;
+		(*out) << "#if defined(HLSL2GLSL_ENABLE_ARRAY_120_WORKAROUND)\n";
 		current->increaseDepth();
 	}
 	
@@ -615,7 +615,7 @@ void TGlslOutputTraverser::traverseArrayDeclarationWithInit(TIntermDeclaration*
 		(*out) << " " << sym->getSymbol() << "[" << type.getArraySize() << "]";
 		current->endStatement();
 
-		std::stringstream* oldOut = out;
+		GlslStringBuilder* oldOut = out;
 		if (sym->isGlobal())
 		{
 			current->pushDepth(0);
@@ -644,7 +644,7 @@ void TGlslOutputTraverser::traverseArrayDeclarationWithInit(TIntermDeclaration*
 	{
 		current->decreaseDepth();
 		current->indent(*out);
-		(*out) << "#else" << std::endl;
+		(*out) << "#else\n";
 		current->increaseDepth();
 	}
 	
@@ -674,7 +674,7 @@ void TGlslOutputTraverser::traverseArrayDeclarationWithInit(TIntermDeclaration*
 	{
 		current->decreaseDepth();
 		current->indent(*out);
-		(*out) << "#endif" << std::endl;
+		(*out) << "#endif\n";
 	}
 }
 
@@ -683,7 +683,7 @@ void TGlslOutputTraverser::traverseArrayDeclarationWithInit(TIntermDeclaration*
 bool TGlslOutputTraverser::traverseDeclaration(bool preVisit, TIntermDeclaration* decl, TIntermTraverser* it) {
 	TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
 	GlslFunction *current = goit->current;
-	std::stringstream& out = current->getActiveOutput();
+	GlslStringBuilder& out = current->getActiveOutput();
 	bool l_parentIsVisitDeclaration = goit->firstVisitDeclaration;
 	bool l_parentDeclareUniform = goit->declareUniform;
 
@@ -721,10 +721,10 @@ bool TGlslOutputTraverser::traverseDeclaration(bool preVisit, TIntermDeclaration
 		++ite)
 	{
 #if defined DEBUG || defined _DEBUG
-		TIntermSymbol * itermNode = dynamic_cast<TIntermSymbol*> (*ite);
+		TIntermSymbol * itermNode = (*ite)->getAsSymbolNode();
 #endif
 		//visit initializer first
-		std::stringstream initilizerOut;
+		GlslStringBuilder initilizerOut;
 		goit->tempVariableName = "";
 		current->setActiveOutput(&initilizerOut);
 		(*ite)->traverse(goit);
@@ -734,9 +734,9 @@ bool TGlslOutputTraverser::traverseDeclaration(bool preVisit, TIntermDeclaration
 		if (goit->tempVariableName.size() > 0)
 		{
 			current->beginStatement();
-			out << initilizerOut.str();//write temp variable calculation first
+			out << initilizerOut;//write temp variable calculation first
 
-			initilizerOut.str("");
+			initilizerOut.clear();
 			//assign being declared varible to this temp var
 			current->setActiveOutput(&initilizerOut);
 
@@ -763,7 +763,7 @@ bool TGlslOutputTraverser::traverseDeclaration(bool preVisit, TIntermDeclaration
 
 		out << " ";
 		
-		out << initilizerOut.str();
+		out << initilizerOut;
 
 		if (type.isArray())
 			out << "[" << type.getArraySize() << "]";
@@ -780,7 +780,7 @@ void TGlslOutputTraverser::traverseSymbol(TIntermSymbol *node, TIntermTraverser
 {
 	TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
 	GlslFunction *current = goit->current;
-	std::stringstream& out = current->getActiveOutput();
+	GlslStringBuilder& out = current->getActiveOutput();
 
 	current->beginStatement();
 
@@ -865,7 +865,7 @@ void TGlslOutputTraverser::traverseConstant( TIntermConstant *node, TIntermTrave
 {
    TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
    GlslFunction *current = goit->current;
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
    EGlslSymbolType type = translateType( node->getTypePointer());
    GlslStruct *str = 0;
 
@@ -908,7 +908,7 @@ void TGlslOutputTraverser::traverseImmediateConstant( TIntermConstant *c, TInter
 
 
 // Special case for matrix[idx1][idx2]: output as matrix[idx2][idx1]
-static bool Check2DMatrixIndex (TGlslOutputTraverser* goit, std::stringstream& out, TIntermTyped *left, const std::string& rightExpr, bool needTempVarForRightIndex)
+static bool Check2DMatrixIndex (TGlslOutputTraverser* goit, GlslStringBuilder& out, TIntermTyped *left, const std::string& rightExpr, bool needTempVarForRightIndex)
 {
 	GlslFunction *current =  goit->current;
 	bool l_parentRequireValue = goit->parentRequireValue;
@@ -924,8 +924,8 @@ static bool Check2DMatrixIndex (TGlslOutputTraverser* goit, std::stringstream& o
 			{
 				  bool needTempVar = needTempVarForRightIndex;
 				  std::string tempVar;
-				  std::stringstream superLeftOut;
-				  std::stringstream superRightOut;
+				  GlslStringBuilder superLeftOut;
+				  GlslStringBuilder superRightOut;
 				//traverse superleft
 				  if (superLeft)
 				  {
@@ -939,7 +939,7 @@ static bool Check2DMatrixIndex (TGlslOutputTraverser* goit, std::stringstream& o
 						current->setActiveOutput(&out);
 						if (goit->tempVariableName.size() > 0)
 						{
-							out << superLeftOut.str();//write temporary variable calculation first
+							out << superLeftOut;//write temporary variable calculation first
 							current->endStatement();
 							current->beginStatement();
 							//use this temporary variable as left operand
@@ -962,7 +962,7 @@ static bool Check2DMatrixIndex (TGlslOutputTraverser* goit, std::stringstream& o
 						current->setActiveOutput(&out);
 						if (goit->tempVariableName.size() > 0)
 						{
-							out << superRightOut.str();//write temporary variable calculation first
+							out << superRightOut;//write temporary variable calculation first
 							current->endStatement();
 							current->beginStatement();
 							//use this temporary variable as right operand
@@ -983,11 +983,11 @@ static bool Check2DMatrixIndex (TGlslOutputTraverser* goit, std::stringstream& o
 					  out << "float " << tempVar << " = ";
 				  }
 
-				out << superLeftOut.str();
+				out << superLeftOut;
 				out << "[";
 				out << rightExpr;
 				out << "][";
-				out << superRightOut.str();
+				out << superRightOut;
 				out << "]";
 				
 				goit->tempVariableName = tempVar;
@@ -1007,7 +1007,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
    TString op = "??";
    TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
    GlslFunction *current = goit->current;
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
    bool l_parentRequireValue = goit->parentRequireValue;
    bool infix = true;
    bool assign = false;
@@ -1037,8 +1037,8 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 		TIntermTyped *right = node->getRight();
 		assert( left && right);
 
-		std::stringstream rvalOut;
-		std::stringstream lvalOut;
+		GlslStringBuilder rvalOut;
+		GlslStringBuilder lvalOut;
 		std::string tempVar;
 		bool nonSquareUniform = (left!= NULL) && left->isNonSquareMatrix() && left->getQualifier() == EvqUniform;
 		bool needTempVar = false;
@@ -1056,7 +1056,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			if (goit->tempVariableName.size() > 0)
 			{
 				current->beginStatement();
-				out << rvalOut.str();//write temporary variable calculation first
+				out << rvalOut;//write temporary variable calculation first
 				current->endStatement();
 				//use this temporary variable as index
 				rvalOut.str(goit->tempVariableName);
@@ -1090,7 +1090,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				current->setActiveOutput(&out);
 				if (goit->tempVariableName.size() > 0)
 				{
-					out << lvalOut.str();//write temporary variable calculation first
+					out << lvalOut;//write temporary variable calculation first
 					current->endStatement();
 					current->beginStatement();
 					//use this temporary variable as left operand
@@ -1121,9 +1121,9 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				 {
 					 current->addLibFunction (EOpMatrixIndex);
 					 out << "xll_matrixindex (";
-					 out << lvalOut.str();
+					 out << lvalOut;
 					 out << ", ";
-					 out << rvalOut.str();
+					 out << rvalOut;
 					 out << ")";
 
 					 goit->tempVariableName = tempVar;
@@ -1137,9 +1137,9 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 					 current->addLibFunction (EOpMatrixIndex);
 					 current->addLibFunction (EOpMatrixIndexDynamic);
 					 out << "xll_matrixindexdynamic (";
-					 out << lvalOut.str();
+					 out << lvalOut;
 					 out << ", ";
-					 out << rvalOut.str();
+					 out << rvalOut;
 					 out << ")";
 
 					 goit->tempVariableName = tempVar;
@@ -1158,7 +1158,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 		}
 		else
 		{
-			 out << lvalOut.str();
+			 out << lvalOut;
 
 			 // Special code for handling a vector component select (this improves readability)
 			 if (left->isVector() && !left->isArray() && right->getAsConstant())
@@ -1177,7 +1177,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			 else
 			 {
 				out << "[";
-				out << rvalOut.str();
+				out << rvalOut;
 				out << "]";
 			 }
 		}
@@ -1191,8 +1191,8 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
       TIntermTyped *left = node->getLeft();
       TIntermTyped *right = node->getRight();
 
-	   std::stringstream lvalOut;
-	   std::stringstream rvalOut;
+	   GlslStringBuilder lvalOut;
+	   GlslStringBuilder rvalOut;
 	   std::string tempVar;
 	   bool nonSquareUniform = (left!= NULL) && left->isNonSquareMatrix() && left->getQualifier() == EvqUniform;
 	   bool needTempVar = false;
@@ -1210,7 +1210,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			if (goit->tempVariableName.size() > 0)
 			{
 				current->beginStatement();
-				out << rvalOut.str();//write temporary variable calculation first
+				out << rvalOut;//write temporary variable calculation first
 				current->endStatement();
 				//use this temporary variable as index
 				rvalOut.str(goit->tempVariableName);
@@ -1225,7 +1225,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				//assign rval to temporary index var
 				current->beginStatement();
 				out << "int " << tempVarBuffer << " = ";
-				out << rvalOut.str();
+				out << rvalOut;
 				current->endStatement();
 
 				rvalOut.str(tempVarBuffer);//use this temp var as index expression
@@ -1263,7 +1263,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			current->setActiveOutput(&out);
 			if (goit->tempVariableName.size() > 0)
 			{
-				out << lvalOut.str();//write temporary variable calculation first
+				out << lvalOut;//write temporary variable calculation first
 				current->endStatement();
 				current->beginStatement();
 				//use this temporary variable as left operand
@@ -1291,9 +1291,9 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 		  {
 			  current->addLibFunction (EOpMatrixIndex);
 			  out << "xll_matrixindex (";
-			  out << lvalOut.str();
+			  out << lvalOut;
 			  out << ", ";
-			  out << rvalOut.str();
+			  out << rvalOut;
 			  out << ")";
 
 			  goit->tempVariableName = tempVar;
@@ -1308,9 +1308,9 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			  current->addLibFunction (EOpMatrixIndex);
 			  current->addLibFunction (EOpMatrixIndexDynamic);
 			  out << "xll_matrixindexdynamic (";
-			  out << lvalOut.str();
+			  out << lvalOut;
 			  out << ", ";
-			  out << rvalOut.str();
+			  out << rvalOut;
 			  out << ")";
 
 			  goit->tempVariableName = tempVar;
@@ -1329,10 +1329,10 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 	  else
 	  {
 		  if (left)
-			 out << lvalOut.str();
+			 out << lvalOut;
 		  out << "[";
 		  if (right)
-			out << rvalOut.str();
+			out << rvalOut;
 		  out << "]";
 	  }
 
@@ -1345,8 +1345,8 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 
    case EOpIndexDirectStruct:
       {
-		 std::stringstream indexPrefix;
-		 std::stringstream leftOut;
+		 GlslStringBuilder indexPrefix;
+		 GlslStringBuilder leftOut;
 		 bool isUniformNonSquareMatrix = false;
 		 std::string tempVar;
          GlslStruct *s = goit->createStructFromType(node->getLeft()->getTypePointer());
@@ -1361,7 +1361,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 					 TIntermTyped *leftOfBin = binNode->getLeft();
 					 TIntermTyped *rightOfBin = binNode->getRight();
 					 isUniformNonSquareMatrix = true;
-					 std::stringstream rvalOut;
+					 GlslStringBuilder rvalOut;
 					 //traverse right index expression operand
 					 if (rightOfBin)
 					 {
@@ -1376,7 +1376,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 						if (goit->tempVariableName.size() > 0)
 						{
 							current->beginStatement();
-							out << rvalOut.str();//write temporary variable calculation first
+							out << rvalOut;//write temporary variable calculation first
 							current->endStatement();
 							//use this temporary variable as index
 							rvalOut.str(goit->tempVariableName);
@@ -1396,7 +1396,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 					 //get prefix index
 					 indexPrefix << leftOfBin->getTypePointer()->getNonSquareColumns();
 					 indexPrefix << " * (";
-					 indexPrefix << rvalOut.str();
+					 indexPrefix << rvalOut;
 					 indexPrefix << ") + ";
 					
 					 leftOut.str(leftOfBin->getAsSymbolNode()->getSymbol().c_str());
@@ -1422,7 +1422,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				if (goit->tempVariableName.size() > 0)
 				{
 					current->beginStatement();
-					out << leftOut.str();//write temporary variable calculation first
+					out << leftOut;//write temporary variable calculation first
 					current->endStatement();
 					//use this temporary variable as left operand
 					leftOut.str(goit->tempVariableName);
@@ -1443,7 +1443,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 		 if (tempVar.size() > 0)
 			 writeTempVarAssign(node->getTypePointer(), tempVar, goit, out);
 
-		 out << leftOut.str();
+		 out << leftOut;
          // The right child is always an offset into the struct, switch to get an
          // immediate constant, and put it back afterwords
          goit->visitConstant = TGlslOutputTraverser::traverseImmediateConstant;
@@ -1457,7 +1457,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			if (isUniformNonSquareMatrix)//use diffrent way for non-square matrix uniform, because it is transformed to array of vector
 			{
 				out << "[";
-				out << indexPrefix.str() << goit->indexList[0];
+				out << indexPrefix << goit->indexList[0];
 				out << "]";
 			}
 			else
@@ -1656,7 +1656,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				   unsigned n_swizzles = swizzles.size();
 					bool tempRValVar = false;
 
-				   std::stringstream rvalOut;
+				   GlslStringBuilder rvalOut;
 
 				   //traverse right operand
 					goit->parentRequireValue = true;//require it returns a value
@@ -1671,7 +1671,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 					if (goit->tempVariableName.size() > 0)
 					{
 						tempRValVar = true;
-						out << rvalOut.str();//write temporary variable calculation first
+						out << rvalOut;//write temporary variable calculation first
 						//use this temporary variable instead of new one
 						strcpy(temp_rval, goit->tempVariableName.c_str());
 					}
@@ -1685,9 +1685,9 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 							//store value in temp variable first
 							current->beginStatement();
 							if (rval->getNominalSize() > 1)
-								out << "vec" << rval->getNominalSize() << " " << temp_rval << " = " << rvalOut.str();
+								out << "vec" << rval->getNominalSize() << " " << temp_rval << " = " << rvalOut;
 							else
-								out << "float " << temp_rval << " = " << rvalOut.str();
+								out << "float " << temp_rval << " = " << rvalOut;
 						}
 					}
 
@@ -1730,7 +1730,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 								out << "." << vec_swizzles[i];
 					   }
 					   else
-						   out << rvalOut.str();
+						   out << rvalOut;
 					   
 					   current->endStatement();
 					}
@@ -1751,7 +1751,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				   char temp_rval[64];
 				   char temp_indexval[64];
 
-				   std::stringstream rvalOut;
+				   GlslStringBuilder rvalOut;
 					   
 				   //traverse right operand
 				   goit->parentRequireValue = true;//require it returns a value
@@ -1765,7 +1765,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 					current->setActiveOutput(&out);
 					if (goit->tempVariableName.size() > 0)
 					{
-						out << rvalOut.str();//write temporary variable calculation first
+						out << rvalOut;//write temporary variable calculation first
 						//use this temporary variable instead of new one
 						strcpy(temp_rval, goit->tempVariableName.c_str());
 					}
@@ -1776,10 +1776,10 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 						//store value in temp variable first
 						current->beginStatement();
 						if (rval->getNominalSize() > 1)//vector
-							out << "vec" << rval->getNominalSize() << " " << temp_rval << " = " << rvalOut.str();
+							out << "vec" << rval->getNominalSize() << " " << temp_rval << " = " << rvalOut;
 						else
 						{
-							out << "float " << temp_rval << " = " << rvalOut.str();
+							out << "float " << temp_rval << " = " << rvalOut;
 						}
 					}
 					
@@ -1845,7 +1845,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 	   }
 
 	   std::string leftOut;
-	   std::stringstream childOutStream;//this also be used as rightOut
+	   GlslStringBuilder childOutStream;//this also be used as rightOut
 	   bool needTempVar = false;
 	   bool l_parentFirstVisitDeclaration = goit->firstVisitDeclaration;//save state
 	   goit->firstVisitDeclaration = false;//avoid telling recursive traversal that we are first visiting declaration
@@ -1862,7 +1862,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			node->getLeft()->traverse(goit);	
 			if (goit->tempVariableName.size() > 0)//we have temporary variable
 			{
-				out << childOutStream.str();//write its calculation first
+				out << childOutStream;//write its calculation first
 				leftOut = goit->tempVariableName;
 				needTempVar = true;
 			}
@@ -1871,14 +1871,14 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 		}
 		//right
 		goit->tempVariableName = "";
-		childOutStream.str("");//clear right's output stream
+		childOutStream.clear();//clear right's output stream
 		current->setActiveOutput(&childOutStream);
 		if (node->getRight())
 		{
 			node->getRight()->traverse(goit);	
 			if (goit->tempVariableName.size() > 0)//we have temporary variable
 			{
-				out << childOutStream.str();//write its calculation first
+				out << childOutStream;//write its calculation first
 				childOutStream.str(goit->tempVariableName);
 				needTempVar = true;
 			}
@@ -1909,7 +1909,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			out << ' ' << op << ' ';
 		}
 		if (node->getRight())
-			out << childOutStream.str();
+			out << childOutStream;
 		if (needsParens)
 		 out << ')';
 
@@ -1923,7 +1923,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
    else
    {
 	   std::string leftOut;
-	   std::stringstream childOutStream;//this also be used as rightOut
+	   GlslStringBuilder childOutStream;//this also be used as rightOut
 	   bool needTempVar = false;
 	   //----traverse left and right-------------------
 		goit->parentRequireValue = true;//require them return values
@@ -1935,7 +1935,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 			node->getLeft()->traverse(goit);	
 			if (goit->tempVariableName.size() > 0)//we have temporary variable
 			{
-				out << childOutStream.str();//write its calculation first
+				out << childOutStream;//write its calculation first
 				leftOut = goit->tempVariableName;
 				needTempVar = true;
 			}
@@ -1944,14 +1944,14 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 		}
 		//right
 		goit->tempVariableName = "";
-		childOutStream.str("");//clear right's output stream
+		childOutStream.clear();//clear right's output stream
 		current->setActiveOutput(&childOutStream);
 		if (node->getRight())
 		{
 			node->getRight()->traverse(goit);	
 			if (goit->tempVariableName.size() > 0)//we have temporary variable
 			{
-				out << childOutStream.str();//write its calculation first
+				out << childOutStream;//write its calculation first
 				childOutStream.str(goit->tempVariableName);
 				needTempVar = true;
 			}
@@ -1971,7 +1971,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				out << leftOut;
 			out << ", ";
 			if (node->getRight())
-				out << childOutStream.str();
+				out << childOutStream;
 
 			out << ')';
 		}
@@ -1995,7 +1995,7 @@ bool TGlslOutputTraverser::traverseBinary( bool preVisit, TIntermBinary *node, T
 				out << leftOut;
 			out << ", ";
 			if (node->getRight())
-				out << childOutStream.str();
+				out << childOutStream;
 
 			out << ')';
 			if (needTempVar)
@@ -2014,7 +2014,7 @@ bool TGlslOutputTraverser::traverseUnary( bool preVisit, TIntermUnary *node, TIn
    TString op("??");
    TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
    GlslFunction *current = goit->current;
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
    bool l_parentRequireValue = goit->parentRequireValue;
    bool funcStyle = false;
    bool prefix = true;
@@ -2334,7 +2334,7 @@ bool TGlslOutputTraverser::traverseUnary( bool preVisit, TIntermUnary *node, TIn
 	}
 
 	std::string operandStr;
-	std::stringstream opOutStream;
+	GlslStringBuilder opOutStream;
 	bool needTempVar = false;
 	//----traverse operand-------------------
 	goit->parentRequireValue = true;//require the operand traversal returns value
@@ -2344,7 +2344,7 @@ bool TGlslOutputTraverser::traverseUnary( bool preVisit, TIntermUnary *node, TIn
 	node->getOperand()->traverse(goit);
 	if (goit->tempVariableName.size() > 0)//we have temporary variable
 	{
-		out << opOutStream.str();//write its calculation first
+		out << opOutStream;//write its calculation first
 		operandStr = goit->tempVariableName;
 		needTempVar = true;
 	}
@@ -2392,10 +2392,10 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
 {
 	TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
 	GlslFunction *current = goit->current;
-	std::stringstream& out = current->getActiveOutput();
+	GlslStringBuilder& out = current->getActiveOutput();
 	
 	bool l_parentRequireValue = goit->parentRequireValue;
-   std::stringstream condOut;
+   GlslStringBuilder condOut;
 
    //-----traverse condition first
    goit->parentRequireValue = true;
@@ -2408,7 +2408,7 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
    current->setActiveOutput(&out);
    if (goit->tempVariableName.size() > 0)//we have temporary variable
    {
-	   out << condOut.str();//write its calculation first
+	   out << condOut;//write its calculation first
 	   current->endStatement();
 	   condOut.str(goit->tempVariableName);//then use this variable as condition
    }
@@ -2419,7 +2419,7 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
 	{
 		// if/else selection
 		out << "if (";
-		out << condOut.str();
+		out << condOut;
 		out << ')';
 		current->beginBlock();
 		node->getTrueBlock()->traverse(goit);
@@ -2435,8 +2435,8 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
 	}
 	else 
 	{
-		std::stringstream trueOut;
-		std::stringstream falseOut;
+		GlslStringBuilder trueOut;
+		GlslStringBuilder falseOut;
 		bool needTempVar = false;
 		//traverse true and false block
 		goit->parentRequireValue = true;
@@ -2446,7 +2446,7 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
 		node->getTrueBlock()->traverse(it);
 		if (goit->tempVariableName.size() > 0)//we have temporary variable
 		{
-		   out << trueOut.str();//write its calculation first
+		   out << trueOut;//write its calculation first
 		   current->endStatement();
 		   current->beginStatement();
 		   trueOut.str(goit->tempVariableName);//then use this variable as true selection
@@ -2461,7 +2461,7 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
 			node->getFalseBlock()->traverse(it);
 			if (goit->tempVariableName.size() > 0)//we have temporary variable
 			{
-			   out << falseOut.str();//write its calculation first
+			   out << falseOut;//write its calculation first
 			   current->endStatement();
 			   current->beginStatement();
 			   falseOut.str(goit->tempVariableName);//then use this variable as false selection
@@ -2489,13 +2489,13 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
 			// emulate HLSL's component-wise selection here
 			current->addLibFunction(EOpVecTernarySel);
 			out << "xll_vecTSel (";
-			out << condOut.str();
+			out << condOut;
 			out << ", ";
-			out << trueOut.str();
+			out << trueOut;
 			out << ", ";
 			if (node->getFalseBlock())
 			{
-				out << falseOut.str();
+				out << falseOut;
 			}
 			else
 				assert(0);
@@ -2508,13 +2508,13 @@ bool TGlslOutputTraverser::traverseSelection( bool preVisit, TIntermSelection *n
 
 			// simple ?: selection
 			out << "(( ";
-			out << condOut.str();
+			out << condOut;
 			out << " ) ? ( ";
-			out << trueOut.str();
+			out << trueOut;
 			out << " ) : ( ";
 			if (node->getFalseBlock())
 			{
-				out << falseOut.str();
+				out << falseOut;
 			}
 			else
 				assert(0);
@@ -2534,7 +2534,7 @@ bool TGlslOutputTraverser::traverseAggregate( bool preVisit, TIntermAggregate *n
 {
    TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
    GlslFunction *current = goit->current;
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
    bool l_parentRequireValue = goit->parentRequireValue;
    int argCount = (int) node->getSequence().size();
 
@@ -2705,7 +2705,7 @@ bool TGlslOutputTraverser::traverseAggregate( bool preVisit, TIntermAggregate *n
          //This should always have two arguments
          assert(node->getSequence().size() == 2);
 		 std::string firstOut;//this will store the string representing 1st argument
-		 std::stringstream sequenceOut;////this will store the string representing 2nd argument
+		 GlslStringBuilder sequenceOut;////this will store the string representing 2nd argument
 		 
 		 //--------
 		 bool needTempVar = false;
@@ -2716,7 +2716,7 @@ bool TGlslOutputTraverser::traverseAggregate( bool preVisit, TIntermAggregate *n
 		 node->getSequence()[0]->traverse(goit);
 		 if (goit->tempVariableName.size() > 0)
 		 {
-			 out << sequenceOut.str();//write temp variable calculation first
+			 out << sequenceOut;//write temp variable calculation first
 			 firstOut = goit->tempVariableName;//then use its name
 			 goit->tempVariableName = "";
 			 needTempVar = true;
@@ -2725,11 +2725,11 @@ bool TGlslOutputTraverser::traverseAggregate( bool preVisit, TIntermAggregate *n
 			 firstOut = sequenceOut.str();
 
 		 // second argument
-		 sequenceOut.str("");
+		 sequenceOut.clear();
 		 node->getSequence()[1]->traverse(goit);
 		 if (goit->tempVariableName.size() > 0)
 		 {
-			 out << sequenceOut.str();//write temp variable calculation first
+			 out << sequenceOut;//write temp variable calculation first
 			 sequenceOut.str( goit->tempVariableName);//then use its name
 			 goit->tempVariableName = "";
 			 needTempVar = true;
@@ -2753,7 +2753,7 @@ bool TGlslOutputTraverser::traverseAggregate( bool preVisit, TIntermAggregate *n
          out << '(';
          out << firstOut;
          out << " * ";
-		 out << sequenceOut.str();
+		 out << sequenceOut;
          out << ')';
 		 if (needTempVar)
 		 {
@@ -2931,11 +2931,11 @@ bool TGlslOutputTraverser::traverseLoop( bool preVisit, TIntermLoop *node, TInte
 {
    TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
    GlslFunction *current = goit->current;
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
    bool l_parentRequireValue = goit->parentRequireValue;
 
    //traverse the condition
-   std::stringstream condout;
+   GlslStringBuilder condout;
    current->setActiveOutput(&condout);
    goit->tempVariableName = "";
    goit->parentRequireValue = true;
@@ -2960,7 +2960,7 @@ bool TGlslOutputTraverser::traverseLoop( bool preVisit, TIntermLoop *node, TInte
 		  if (conditionTempVar)//hack, set loop condition to true and inside the body, break if temp var is false
 			out << "true";
 		  else
-			out << condout.str();
+			out << condout;
 	  }
       out << "; ";
       if (node->getExpression())
@@ -2969,7 +2969,7 @@ bool TGlslOutputTraverser::traverseLoop( bool preVisit, TIntermLoop *node, TInte
       current->beginBlock();
 	  if (conditionTempVar)//hack, set loop condition to true and inside the body, break if temp var is false
 	  {
-		  out << condout.str();//write temp var calculation
+		  out << condout;//write temp var calculation
 		  out << "if (!bool(" << goit->tempVariableName << ")) break;\n";
 	  }
       if (node->getBody())
@@ -2985,13 +2985,13 @@ bool TGlslOutputTraverser::traverseLoop( bool preVisit, TIntermLoop *node, TInte
 			  if (conditionTempVar)//hack, set loop condition to true and inside the body, break if temp var is false
 				out << "true";
 			  else
-				out << condout.str();
+				out << condout;
 		  }
          out << " ) ";
          current->beginBlock();
 		 if (conditionTempVar)//hack, set loop condition to true and inside the body, break if temp var is false
 		  {
-			  out << condout.str();//write temp var calculation
+			  out << condout;//write temp var calculation
 			  out << "if (!bool(" << goit->tempVariableName << ")) break;\n";
 		  }
          if (node->getBody())
@@ -3022,7 +3022,7 @@ bool TGlslOutputTraverser::traverseLoop( bool preVisit, TIntermLoop *node, TInte
 		 if (conditionTempVar)
 		 {
 			 //write temp var calculation
-			 out << condout.str();
+			 out << condout;
 			 //assign it to the temp conditional var
 			 out << tempCondVar << " = bool(" + tempCondChildVar + ");\n";
 		 }
@@ -3032,7 +3032,7 @@ bool TGlslOutputTraverser::traverseLoop( bool preVisit, TIntermLoop *node, TInte
 		 if (conditionTempVar)//hack, set loop condition to true and inside the body, break if temp var is false
 			out << tempCondVar;
 		  else
-			out << condout.str();
+			out << condout;
          out << " );\n";
       }
 
@@ -3045,10 +3045,10 @@ bool TGlslOutputTraverser::traverseBranch( bool preVisit, TIntermBranch *node,
 {
    TGlslOutputTraverser* goit = static_cast<TGlslOutputTraverser*>(it);
    GlslFunction *current = goit->current;
-   std::stringstream& out = current->getActiveOutput();
+   GlslStringBuilder& out = current->getActiveOutput();
 
    bool l_parentRequireValue = goit->parentRequireValue;
-   std::stringstream exprOut;
+   GlslStringBuilder exprOut;
 
    //-----traverse expression first
    goit->parentRequireValue = true;
@@ -3064,14 +3064,14 @@ bool TGlslOutputTraverser::traverseBranch( bool preVisit, TIntermBranch *node,
    current->setActiveOutput(&out);
    if (goit->tempVariableName.size() > 0)//we have temporary variable
    {
-	   out << exprOut.str();//write its calculation first
+	   out << exprOut;//write its calculation first
 	   exprOut.str(goit->tempVariableName);//then use this variable as expression
    }
 
    if (goit->isInlining && node->getFlowOp() == EOpReturn && node->getExpression())//inline expanding
    {
 	   current->beginStatement();
-	   out << *goit->inlineRetVar << " = " << exprOut.str();
+	   out << *goit->inlineRetVar << " = " << exprOut;
    }
    else
    {
@@ -3088,7 +3088,7 @@ bool TGlslOutputTraverser::traverseBranch( bool preVisit, TIntermBranch *node,
 
 	   if (node->getExpression())
 	   {
-		   out << exprOut.str();
+		   out << exprOut;
 	   }
 
    }
@@ -3107,7 +3107,7 @@ GlslStruct *TGlslOutputTraverser::createStructFromType (TType *type)
    //check for anonymous structures
    if (structName.size() == 0)
    {
-      std::stringstream temp;
+      GlslStringBuilder temp;
       TTypeList &tList = *type->getStruct();
 
       //build a mangled name that is hopefully mangled enough to prevent collisions
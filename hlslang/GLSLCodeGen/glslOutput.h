@@ -6,7 +6,6 @@
 #ifndef GLSL_OUTPUT_H
 #define GLSL_OUTPUT_H
 
-#include <sstream>
 #include <vector>
 #include <map>
 
@@ -40,7 +39,7 @@ public:
 		std::vector<GlslFunction*> &funcList, 
 		std::vector<GlslStruct*> &sList, 
 		std::map<TString, TIntermAggregate*> &inlinefuncList,
-		std::stringstream& deferredArrayInit, 
+		GlslStringBuilder& deferredArrayInit, 
 		ETargetVersion version, 
 		unsigned options);
 	GlslStruct *createStructFromType( TType *type );
@@ -70,7 +69,7 @@ public:
 	std::vector<int> indexList;
 	
 	// Code to initialize global arrays when we can't use GLSL 1.20+ syntax
-	std::stringstream& m_DeferredArrayInit;
+	GlslStringBuilder& m_DeferredArrayInit;
 
 	//temporary variable returns from last traversal, useful if one rhs transformed into multiple statement
 	std::string tempVariableName;
@@ -7,7 +7,7 @@
 
 std::string GlslStruct::getDecl() const
 {
-	std::stringstream out;
+	GlslStringBuilder out;
 	
 	out << "struct " << name << " {\n";
 	
@@ -4,7 +4,6 @@
 
 
 #include "glslSymbol.h"
-#include <float.h>
 
 
 // Check against names that are keywords in GLSL, but not HLSL
@@ -51,7 +50,7 @@ GlslSymbol::GlslSymbol( const std::string &n, const std::string &s, int id, EGls
 
 
 
-void GlslSymbol::writeDecl (std::stringstream& out, unsigned flags)
+void GlslSymbol::writeDecl (GlslStringBuilder& out, unsigned flags)
 {
 	const bool writeMutableUniforms = (flags & WRITE_DECL_MUTABLE_UNIFORMS);
 	bool uniformNonSquareMatrix = qual == EqtUniform && isNonSquareMatrix();
@@ -110,23 +109,18 @@ void GlslSymbol::writeDecl (std::stringstream& out, unsigned flags)
 // 	active.unsetf(std::ios::fixed);
 // 	active.unsetf(std::ios::scientific);
 // 	active.precision (6);
-// but the interpretation of precision was different between platforms
+// but the interpretation of precision was different between platforms, and later
+// sprintf with FLT_DIG digits, which did not round-trip. The builder writes the
+// shortest text that reads back as the same float, independent of platform and locale.
 
-void GlslSymbol::writeFloat(std::stringstream &out, float f)
+void GlslSymbol::writeFloat(GlslStringBuilder &out, float f)
 {
-	static char buffer[64];
-	
-	if (fractionalPart(f) == 0.f)
-		sprintf(buffer, "%.1f", f);
-	else
-		sprintf(buffer, "%.*g", FLT_DIG, f);
-
-	out << buffer;
+	out << f;
 }
 
 void GlslSymbol::mangleName()
 {
-	std::stringstream s;
+	GlslStringBuilder s;
 	mangleCounter++;
 	s << "_" << mangleCounter;
 	mangledName = name + s.str();
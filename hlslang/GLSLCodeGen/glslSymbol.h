@@ -47,7 +47,7 @@ public:
 	enum WriteDeclFlags {
 		WRITE_DECL_MUTABLE_UNIFORMS = (1<<0),
 	};
-	void writeDecl (std::stringstream& out, unsigned flags); // flags = bitmask of WriteDeclFlags
+	void writeDecl (GlslStringBuilder& out, unsigned flags); // flags = bitmask of WriteDeclFlags
 	/// Set the mangled name for the symbol
 	void mangleName();    
 
@@ -55,7 +55,7 @@ public:
 	void releaseRef() { assert (refCount >= 0 ); if ( refCount > 0 ) refCount--; }
 	int getRef() const { return refCount; }
 
-	static void writeFloat(std::stringstream &out, float f);
+	static void writeFloat(GlslStringBuilder &out, float f);
 
 	bool isNonSquareMatrix() const;
 	int getNonSquareColumns() const;
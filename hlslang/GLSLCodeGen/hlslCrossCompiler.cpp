@@ -6,6 +6,7 @@
 #include "hlslCrossCompiler.h"
 
 #include "glslOutput.h"
+#include "PassManager.h"
 #include "typeSamplers.h"
 #include "propagateMutable.h"
 #include "hlslLinker.h"
@@ -15,37 +16,104 @@ HlslCrossCompiler::HlslCrossCompiler(EShLanguage l)
 :	language(l)
 ,	m_ASTTransformed(false)
 ,	m_GlslProduced(false)
+,	includeOpen(0)
+,	includeClose(0)
+,	includeUserData(0)
+,	parseDeferred(false)
+,	deferredShader(0)
+,	deferredVersion(ETargetGLSL_110)
+,	deferredOptions(0)
+,	asyncParseFailed(false)
 {
-	linker = new HlslLinker(infoSink);
+	linker = new HlslLinker(infoSink, traceName);
+	memset(&stats, 0, sizeof(stats));
 }
 
 HlslCrossCompiler::~HlslCrossCompiler()
+{
+   deleteCodeLists();
+   delete deferredShader;
+   delete linker;
+}
+
+
+void HlslCrossCompiler::deleteCodeLists()
 {
    for ( std::vector<GlslFunction*>::iterator it = functionList.begin() ; it != functionList.end(); it++)
    {
       delete *it;
    }
+   functionList.clear();
 
    for ( std::vector<GlslStruct*>::iterator it = structList.begin() ; it != structList.end(); it++)
    {
       delete *it;
    }
-   delete linker;
+   structList.clear();
 }
 
 
-void HlslCrossCompiler::TransformAST (TIntermNode *root)
+void HlslCrossCompiler::reset()
 {
-	m_ASTTransformed = true;
-	PropagateSamplerTypes (root, infoSink);
-	PropagateMutableUniforms (root, infoSink);
+   m_ASTTransformed = false;
+   m_GlslProduced = false;
+   deleteCodeLists();
+   m_DeferredArrayInit.reset();
+   linker->reset();
+   infoSink.info.erase();
+   infoSink.debug.erase();
+   preprocessedText.clear();
+   preprocessedTokens.clear();
+   preprocessedSpellings.clear();
+   resultKey.clear();
+   parseDeferred = false;
+   delete deferredShader;
+   deferredShader = 0;
+   memset(&stats, 0, sizeof(stats));
+   passStats.clear();
+   diagnostics.clear();
+   asyncParseFailed = false;
 }
 
-void HlslCrossCompiler::ProduceGLSL (TParseContext* parseContext, 
-									 ETargetVersion version, 
-									 unsigned options)
+
+void HlslCrossCompiler::RunPasses (TParseContext* parseContext, 
+								   ETargetVersion version, 
+								   unsigned options)
 {
-	m_GlslProduced = true;
+	TIntermNode* root = parseContext->treeRoot;
+	TOutputTraverser treeOutput (infoSink);
 	TGlslOutputTraverser glslTraverse (infoSink, functionList, structList, parseContext->inlineFuncList, m_DeferredArrayInit, version, options);
-	parseContext->treeRoot->traverse(&glslTraverse);
+
+	TPassManager passes;
+
+	// The dump shows the tree as parsed, so the passes changing it wait for it.
+	TPass* outputTree = 0;
+	if (options & ETranslateOpIntermediate)
+	{
+		outputTree = new TWalkPass ("OutputTree", treeOutput);
+		passes.addPass (outputTree);
+	}
+
+	TPass* samplerTypes = CreateSamplerTypesPass (infoSink);
+	TPass* mutableUniforms = CreateMutableUniformsPass (infoSink);
+	TPass* produceGLSL = new TWalkPass ("ProduceGLSL", glslTraverse);
+	if (outputTree)
+	{
+		samplerTypes->runAfter (outputTree);
+		mutableUniforms->runAfter (outputTree);
+	}
+	produceGLSL->runAfter (samplerTypes);
+	produceGLSL->runAfter (mutableUniforms);
+	passes.addPass (samplerTypes);
+	passes.addPass (mutableUniforms);
+	passes.addPass (produceGLSL);
+
+	passes.run (root, traceName);
+	m_ASTTransformed = true;
+	m_GlslProduced = true;
+
+	passStats = passes.getStats();
+	stats.nodeCount = passes.getNodeCount();
+	stats.produceTime = passStats.back().time;
+	stats.transformTime = passes.getTime() - stats.produceTime;
 }
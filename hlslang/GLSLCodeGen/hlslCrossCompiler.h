@@ -14,6 +14,7 @@
 
 class HlslLinker;
 struct TParseContext; 
+struct TPreprocessedShader;
 
 class HlslCrossCompiler
 {
@@ -24,16 +25,24 @@ public:
    EShLanguage getLanguage() const { return language; }
    TInfoSink& getInfoSink() { return infoSink; }
 
-   void TransformAST (TIntermNode* root);
-   void ProduceGLSL (TParseContext* parseContext, 
-					ETargetVersion version, 
-					unsigned options);
+   // Runs the passes over the parsed tree: the ones that transform it, then the one that
+   // generates GLSL from it, and before them a dump of it if options ask for one
+   void RunPasses (TParseContext* parseContext, 
+				   ETargetVersion version, 
+				   unsigned options);
    bool IsASTTransformed() const { return m_ASTTransformed; }
    bool IsGlslProduced() const { return m_GlslProduced; }
 
    HlslLinker* GetLinker() { return linker; }
 
+   // Drop everything the last parse and translation produced, keeping the settings
+   // (include handler, user attribute names and varyings) and the buffers the results
+   // were built in
+   void reset();
+
 private:
+	void deleteCodeLists();
+
 	EShLanguage language;
 	bool m_ASTTransformed;
 	bool m_GlslProduced;
@@ -44,7 +53,23 @@ public:
 	TInfoSink infoSink;
 	std::vector<GlslFunction*> functionList;
 	std::vector<GlslStruct*> structList;
-	std::stringstream m_DeferredArrayInit;
+	GlslStringBuilder m_DeferredArrayInit;
+	IncludeOpenFunction includeOpen;
+	IncludeCloseFunction includeClose;
+	void* includeUserData;
+	std::string preprocessedText;
+	std::vector<int> preprocessedTokens;
+	std::vector<std::string> preprocessedSpellings;
+	std::string resultKey;          // parse part of the result cache key; empty if not cached
+	bool parseDeferred;             // parse skipped on a likely cache hit; inputs kept below
+	TPreprocessedShader* deferredShader;
+	ETargetVersion deferredVersion;
+	unsigned deferredOptions;
+	std::string traceName;          // labels the compiler's trace events; kept across reset()
+	ShCompileStats stats;           // of the last parse and translation; cleanupTime, outputLength and passes are filled in when asked for
+	std::vector<ShPassStats> passStats;
+	std::vector<ShDiagnostic> diagnostics;  // filled in from infoSink.info when asked for
+	bool asyncParseFailed;          // so translates queued after the parse are skipped
 };
 
 #endif //HLSL_CROSS_COMPILER_H
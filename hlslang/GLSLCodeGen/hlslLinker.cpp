@@ -10,6 +10,7 @@
 
 #include "hlslSupportLib.h"
 #include "osinclude.h"
+#include "Trace.h"
 #include <algorithm>
 #include <string.h>
 #include <set>
@@ -160,7 +161,7 @@ enum FunctionMatchType{
 	FUNC_FULL_MATCH = 2//match profile and name
 };
 
-static inline void AddToVaryings (std::stringstream& s, TPrecision prec, const std::string& type, const std::string& name)
+static inline void AddToVaryings (GlslStringBuilder& s, TPrecision prec, const std::string& type, const std::string& name)
 {
 	if (strstr (name.c_str(), kUserVaryingPrefix) == name.c_str())
 		s << "varying " << getGLSLPrecisiontring(prec) << type << " " << name << ";\n";
@@ -288,7 +289,7 @@ static inline void FunctionFinderCheck(GlslFunction* currentFunc,
 }
 
 
-HlslLinker::HlslLinker(TInfoSink& infoSink_) : infoSink(infoSink_)
+HlslLinker::HlslLinker(TInfoSink& infoSink_, const std::string& traceName_) : infoSink(infoSink_), traceName(traceName_)
 {
 	for ( int i = 0; i < EAttrSemCount; i++)
 	{
@@ -297,10 +298,19 @@ HlslLinker::HlslLinker(TInfoSink& infoSink_) : infoSink(infoSink_)
 
 	// By default, use GL build-in varyings
 	bUserVaryings = false;
+
+	shaderTextDirty = true;
+	shaderTextTime = 0;
 }
 
 
 HlslLinker::~HlslLinker()
+{
+	clearUniforms();
+}
+
+
+void HlslLinker::clearUniforms()
 {
 	for ( std::vector<ShUniformInfo>::iterator it = uniforms.begin(); it != uniforms.end(); it++)
 	{
@@ -308,6 +318,18 @@ HlslLinker::~HlslLinker()
 		delete [] it->semantic;
 		delete [] it->init;
 	}
+	uniforms.clear();
+}
+
+
+void HlslLinker::reset()
+{
+	clearUniforms();
+	shaderPrefix.reset();
+	shader.reset();
+	bs.clear();
+	shaderTextDirty = true;
+	shaderTextTime = 0;
 }
 
 
@@ -615,7 +637,7 @@ bool HlslLinker::addCalledFunctions( GlslFunction *func, FunctionSet& funcSet, s
 
 typedef std::vector<GlslFunction*> FunctionSet;
 
-static void EmitCalledFunctions (std::stringstream& shader, const FunctionSet& functions)
+static void EmitCalledFunctions (GlslStringBuilder& shader, const FunctionSet& functions)
 {
 	if (functions.empty())
 		return;
@@ -635,10 +657,10 @@ static void EmitCalledFunctions (std::stringstream& shader, const FunctionSet& f
 	}
 }
 
-static void EmitIfNotEmpty (std::stringstream& out, const std::stringstream& str)
+static void EmitIfNotEmpty (GlslStringBuilder& out, const GlslStringBuilder& str)
 {
-	if (str.str().size())
-		out << str.str() << "\n";
+	if (!str.empty())
+		out << str << "\n";
 }
 
 static const char* GetEntryName (const char* entryFunc)
@@ -867,7 +889,7 @@ void HlslLinker::buildUniformReflection(const std::vector<GlslSymbol*>& constant
 }
 
 
-static void emitSymbolWithPad (std::stringstream& str, const std::string& ctor, const std::string& name, int pad)
+static void emitSymbolWithPad (GlslStringBuilder& str, const std::string& ctor, const std::string& name, int pad)
 {
 	str << ctor << "(" << name;
 	for (int i = 0; i < pad; ++i)
@@ -876,7 +898,7 @@ static void emitSymbolWithPad (std::stringstream& str, const std::string& ctor,
 }
 
 
-static void emitSingleInputVariable (EShLanguage lang, const std::string& name, const std::string& ctor, EGlslSymbolType type, TPrecision prec, std::stringstream& attrib, std::stringstream& varying)
+static void emitSingleInputVariable (EShLanguage lang, const std::string& name, const std::string& ctor, EGlslSymbolType type, TPrecision prec, GlslStringBuilder& attrib, GlslStringBuilder& varying)
 {
 	// vertex shader: emit custom attributes
 	if (lang == EShLangVertex && strncmp(name.c_str(), "gl_", 3) != 0)
@@ -903,7 +925,7 @@ static void emitSingleInputVariable (EShLanguage lang, const std::string& name,
 }
 	
 
-void HlslLinker::emitInputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, std::stringstream& attrib, std::stringstream& varying, std::stringstream& preamble, std::stringstream& call)
+void HlslLinker::emitInputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, GlslStringBuilder& attrib, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& call)
 {
 	std::string name, ctor;
 	int pad;
@@ -943,7 +965,7 @@ void HlslLinker::emitInputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool
 }
 
 
-void HlslLinker::emitInputStructParam(GlslSymbol* sym, EShLanguage lang, ExtensionSet& extensions, std::stringstream& attrib, std::stringstream& varying, std::stringstream& preamble, std::stringstream& call)
+void HlslLinker::emitInputStructParam(GlslSymbol* sym, EShLanguage lang, ExtensionSet& extensions, GlslStringBuilder& attrib, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& call)
 {
 	GlslStruct* str = sym->getStruct();
 	assert(str);
@@ -1012,7 +1034,7 @@ void HlslLinker::emitInputStructParam(GlslSymbol* sym, EShLanguage lang, Extensi
 }
 
 
-void HlslLinker::emitOutputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, std::stringstream& varying, std::stringstream& preamble, std::stringstream& postamble, std::stringstream& call)
+void HlslLinker::emitOutputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& postamble, GlslStringBuilder& call)
 {
 	std::string name, ctor;
 	int pad;
@@ -1047,7 +1069,7 @@ void HlslLinker::emitOutputNonStructParam(GlslSymbol* sym, EShLanguage lang, boo
 }
 
 
-void HlslLinker::emitOutputStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, std::stringstream& varying, std::stringstream& preamble, std::stringstream& postamble, std::stringstream& call)
+void HlslLinker::emitOutputStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& postamble, GlslStringBuilder& call)
 {
 	//structs must pass the struct, then process per element
 	GlslStruct *Struct = sym->getStruct();
@@ -1091,11 +1113,11 @@ void HlslLinker::emitOutputStructParam(GlslSymbol* sym, EShLanguage lang, bool u
 }
 
 
-void HlslLinker::emitMainStart(const HlslCrossCompiler* compiler, const EGlslSymbolType retType, GlslFunction* funcMain, ETargetVersion version, unsigned options, bool usePrecision, std::stringstream& preamble)
+void HlslLinker::emitMainStart(const HlslCrossCompiler* compiler, const EGlslSymbolType retType, GlslFunction* funcMain, ETargetVersion version, unsigned options, bool usePrecision, GlslStringBuilder& preamble)
 {
 	preamble << "void main() {\n";
 	
-	std::string arrayInit = compiler->m_DeferredArrayInit.str();
+	const GlslStringBuilder& arrayInit = compiler->m_DeferredArrayInit;
 	if (!arrayInit.empty())
 	{
 		const bool emit_120_arrays = (version >= ETargetGLSL_120);
@@ -1103,10 +1125,10 @@ void HlslLinker::emitMainStart(const HlslCrossCompiler* compiler, const EGlslSym
 		const bool emit_both = emit_120_arrays && emit_old_arrays;
 		
 		if (emit_both)
-			preamble << "#if defined(HLSL2GLSL_ENABLE_ARRAY_120_WORKAROUND)" << std::endl;
+			preamble << "#if defined(HLSL2GLSL_ENABLE_ARRAY_120_WORKAROUND)\n";
 		preamble << arrayInit;
 		if (emit_both)
-			preamble << "\n#endif" << std::endl;
+			preamble << "\n#endif\n";
 	}
 	
 	if (retType == EgstStruct)
@@ -1124,7 +1146,7 @@ void HlslLinker::emitMainStart(const HlslCrossCompiler* compiler, const EGlslSym
 }
 
 
-bool HlslLinker::emitReturnValue(const EGlslSymbolType retType, GlslFunction* funcMain, EShLanguage lang, std::stringstream& varying, std::stringstream& postamble)
+bool HlslLinker::emitReturnValue(const EGlslSymbolType retType, GlslFunction* funcMain, EShLanguage lang, GlslStringBuilder& varying, GlslStringBuilder& postamble)
 {
 	// void return type
 	if (retType == EgstVoid)
@@ -1255,6 +1277,9 @@ bool HlslLinker::emitReturnValue(const EGlslSymbolType retType, GlslFunction* fu
 
 bool HlslLinker::link(HlslCrossCompiler* compiler, const char* entryFunc, const char* profile, ETargetVersion targetVersion, unsigned options)
 {
+	// Start from empty output, so that linking again does not append to the last result
+	reset();
+	
 	if (!linkerSanityCheck(compiler, entryFunc))
 		return false;
 	
@@ -1311,12 +1336,12 @@ bool HlslLinker::link(HlslCrossCompiler* compiler, const char* entryFunc, const
 	// connect items appropriately.	
 	
 	ExtensionSet extensions;
-	std::stringstream attrib;
-	std::stringstream uniform;
-	std::stringstream preamble;
-	std::stringstream postamble;
-	std::stringstream varying;
-	std::stringstream call;
+	GlslStringBuilder attrib;
+	GlslStringBuilder uniform;
+	GlslStringBuilder preamble;
+	GlslStringBuilder postamble;
+	GlslStringBuilder varying;
+	GlslStringBuilder call;
 
 	// Declare return value
 	const EGlslSymbolType retType = funcMain->getReturnType();
@@ -1421,44 +1446,95 @@ bool HlslLinker::link(HlslCrossCompiler* compiler, const char* entryFunc, const
 		shaderPrefix << kTargetVersionStrings[targetVersion];
 		std::set<const char*>::iterator it = extensions.begin(), end = extensions.end();
 		for (; it != end; ++it)
-			shaderPrefix << "#extension " << *it << " : require" << std::endl;
+			shaderPrefix << "#extension " << *it << " : require\n";
 	}
 
 	EmitIfNotEmpty (shader, uniform);
 	EmitIfNotEmpty (shader, attrib);
 	EmitIfNotEmpty (shader, varying);
 
-	shader << preamble.str() << "\n";
-	shader << call.str() << "\n";
-	shader << postamble.str() << "\n";
+	shader << preamble << "\n";
+	shader << call << "\n";
+	shader << postamble << "\n";
 
 	return true;
 }
 
 
-static std::string CleanupShaderText (const std::string& prefix, const std::string& str)
+// Appends the text of a builder to res; consecutive newlines are collapsed
+// into one when collapseNewlines is set.
+static void AppendShaderText (std::string& res, const GlslStringBuilder& text, bool collapseNewlines)
 {
-	std::string res = prefix;
-	size_t n = str.size();
-	res.reserve (n + prefix.size());
+	res.reserve (res.size() + text.size());
 	char cc = 0;
-	for (size_t i = 0; i < n; ++i)
+	for (const GlslStringBuilder::Chunk* chunk = text.getFirstChunk(); chunk; chunk = chunk->next)
+	{
+		for (size_t i = 0; i < chunk->used; ++i)
+		{
+			char c = chunk->data[i];
+			// Used to compare against str[i-1] instead of cc, but that produces some bug on OSX Lion
+			// with Xcode 4.3 (i686-apple-darwin11-llvm-gcc-4.2 (GCC) 4.2.1) in release config; str[i-1]
+			// always returns zero.
+			if (!collapseNewlines || c != '\n' || cc != '\n')
+				res.push_back(c);
+			cc = c;
+		}
+	}
+}
+
+
+void HlslLinker::buildShaderText() const
+{
+	double start = OS_GetTime();
+	bs.clear();
+	AppendShaderText (bs, shaderPrefix, false);
+	AppendShaderText (bs, shader, true);
+	shaderTextDirty = false;
+	double end = OS_GetTime();
+	shaderTextTime = end - start;
+
+	if (TraceEnabled())
 	{
-		char c = str[i];
-		// Next line used to have str[i-1] instead of cc, but that produces some bug on OSX Lion
-		// with Xcode 4.3 (i686-apple-darwin11-llvm-gcc-4.2 (GCC) 4.2.1) in release config; str[i-1]
-		// always returns zero.
-		if (c != '\n' || i==0 || cc != '\n')
-			res.push_back(c);
-		cc = c;
+		TTraceArg args[] = { { "outputBytes", (int)bs.size() } };
+		TraceEvent("Cleanup", start, end, traceName, args, 1);
 	}
-	return res;
 }
 
 
+void HlslLinker::setResult(const std::string& text, const ShUniformInfo* uniformInfo, int uniformCount)
+{
+	clearUniforms();
+
+	for (int i = 0; i < uniformCount; ++i)
+	{
+		ShUniformInfo info = uniformInfo[i];
+		info.name = new char[strlen(uniformInfo[i].name)+1];
+		strcpy(info.name, uniformInfo[i].name);
+		if (uniformInfo[i].semantic) {
+			info.semantic = new char[strlen(uniformInfo[i].semantic)+1];
+			strcpy(info.semantic, uniformInfo[i].semantic);
+		}
+		info.init = 0;
+		uniforms.push_back(info);
+	}
+
+	bs = text;
+	shaderTextDirty = false;
+	shaderTextTime = 0;
+}
+
 
 const char* HlslLinker::getShaderText() const 
 {
-	bs = CleanupShaderText (shaderPrefix.str(), shader.str());
+	if (shaderTextDirty)
+		buildShaderText();
 	return bs.c_str();
 }
+
+
+int HlslLinker::getShaderTextLength() const
+{
+	if (shaderTextDirty)
+		buildShaderText();
+	return (int)bs.size();
+}
@@ -6,8 +6,6 @@
 #ifndef HLSL_LINKER_H
 #define HLSL_LINKER_H
 
-#include <sstream>
-
 #include "../Include/Common.h"
 
 #include "glslFunction.h"
@@ -33,7 +31,8 @@ class HlslLinker
 {
 public:
 
-   HlslLinker(TInfoSink& infoSink);
+   // traceName labels the linker's trace events; it is read each time one is written
+   HlslLinker(TInfoSink& infoSink, const std::string& traceName);
    ~HlslLinker();
 	
    TInfoSink& getInfoSink() { return infoSink; }
@@ -41,10 +40,22 @@ public:
    bool link(HlslCrossCompiler*, const char* entry, const char* profile, ETargetVersion version, unsigned options);
 
    bool setUserAttribName (EAttribSemantic eSemantic, const char *pName);
+   const char* getUserAttribName (EAttribSemantic eSemantic) const { return userAttribString[eSemantic]; }
 
    void setUseUserVaryings (bool v) { bUserVaryings = v; }
+   bool getUseUserVaryings () const { return bUserVaryings; }
+
+   // Take the shader text and uniform table of an earlier link instead of linking
+   void setResult (const std::string& text, const ShUniformInfo* uniformInfo, int uniformCount);
+
+   // Drop the output of the last link, keeping the buffers it was built in
+   void reset();
 
    const char* getShaderText() const;
+   int getShaderTextLength() const;
+
+   // Seconds spent building the final text; 0 until it has been asked for
+   double getShaderTextTime() const { return shaderTextTime; }
       
    int getUniformCount() const { return (int)uniforms.size(); }
    const ShUniformInfo* getUniformInfo() const  { return (!uniforms.empty()) ? &uniforms[0] : 0; }
@@ -72,28 +83,34 @@ private:
 	void emitStructs(HlslCrossCompiler* comp);
 	void emitGlobals(const GlslFunction* globalFunction, const std::vector<GlslSymbol*>& constants);
 	
-	void emitInputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, std::stringstream& attrib, std::stringstream& varying, std::stringstream& preamble, std::stringstream& call);
-	void emitInputStructParam(GlslSymbol* sym, EShLanguage lang, ExtensionSet& extensions, std::stringstream& attrib, std::stringstream& varying, std::stringstream& preamble, std::stringstream& call);
-	void emitOutputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, std::stringstream& varying, std::stringstream& preamble, std::stringstream& postamble, std::stringstream& call);
-	void emitOutputStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, std::stringstream& varying, std::stringstream& preamble, std::stringstream& postamble, std::stringstream& call);
-	void emitMainStart(const HlslCrossCompiler* compiler, const EGlslSymbolType retType, GlslFunction* funcMain, ETargetVersion version, unsigned options, bool usePrecision, std::stringstream& preamble);
-	bool emitReturnValue(const EGlslSymbolType retType, GlslFunction* funcMain, EShLanguage lang, std::stringstream& varying, std::stringstream& postamble);
+	void emitInputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, GlslStringBuilder& attrib, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& call);
+	void emitInputStructParam(GlslSymbol* sym, EShLanguage lang, ExtensionSet& extensions, GlslStringBuilder& attrib, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& call);
+	void emitOutputNonStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& postamble, GlslStringBuilder& call);
+	void emitOutputStructParam(GlslSymbol* sym, EShLanguage lang, bool usePrecision, EAttribSemantic attrSem, GlslStringBuilder& varying, GlslStringBuilder& preamble, GlslStringBuilder& postamble, GlslStringBuilder& call);
+	void buildShaderText() const;
+	void clearUniforms();
+	
+	void emitMainStart(const HlslCrossCompiler* compiler, const EGlslSymbolType retType, GlslFunction* funcMain, ETargetVersion version, unsigned options, bool usePrecision, GlslStringBuilder& preamble);
+	bool emitReturnValue(const EGlslSymbolType retType, GlslFunction* funcMain, EShLanguage lang, GlslStringBuilder& varying, GlslStringBuilder& postamble);
 	
 private:
 	TInfoSink& infoSink;
+	const std::string& traceName;
 	
 	// GLSL string for additional extension prepropressor directives.
 	// This is used for version and extensions that expose built-in variables.
-	std::stringstream shaderPrefix;
+	GlslStringBuilder shaderPrefix;
 	
 	// GLSL string for generated shader
-	std::stringstream shader;
+	GlslStringBuilder shader;
 	
 	// Uniform list
 	std::vector<ShUniformInfo> uniforms;
 	
-	// Helper string to store shader text
+	// Final shader text, built from shaderPrefix and shader on first request after a link
 	mutable std::string bs;
+	mutable bool shaderTextDirty;
+	mutable double shaderTextTime;
 	
 	// Table holding the list of user attribute names per semantic
 	char userAttribString[EAttrSemCount][MAX_ATTRIB_NAME];
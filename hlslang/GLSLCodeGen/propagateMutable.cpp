@@ -4,7 +4,7 @@
 
 #include "propagateMutable.h"
 #include <set>
-#include "localintermediate.h"
+#include "PassManager.h"
 #include "glslOutput.h"
 
 
@@ -53,23 +53,44 @@ void TPropagateMutable::traverseSymbol( TIntermSymbol *node, TIntermTraverser *i
    }
 }
 
-void PropagateMutableUniforms (TIntermNode* root, TInfoSink &info)
+//
+// Propagates one mutable uniform per two walks: the first finds a symbol to
+// propagate from and stops looking, the second marks every use of it.  Done
+// when a first walk finds nothing.
+//
+class TMutableUniformsPass : public TPass
 {
-   TPropagateMutable st(info);
+public:
+   TMutableUniformsPass(TInfoSink &info) : TPass("PropagateMutableUniforms", EPassInputMutableUniforms), st(info), done(false)
+   {
+   }
 
-   do
+   virtual TIntermTraverser* beginWalk()
    {
+      if (done)
+         return 0;
       st.abort = false;
-      root->traverse(&st);
+      return &st;
+   }
 
+   virtual void endWalk()
+   {
       // If we aborted, try to type the node we aborted for
-      if (st.abort)
-      {
-         st.propagating = true;
-         st.abort = false;
-         root->traverse(&st);
+      if (st.propagating)
          st.propagating = false;
-         st.abort = true;
-      }
-   } while (st.abort);
+      else if (st.abort)
+         st.propagating = true;
+      else
+         done = true;
+   }
+
+private:
+   TPropagateMutable st;
+   bool done;
+};
+
+
+TPass* CreateMutableUniformsPass (TInfoSink &info)
+{
+   return new TMutableUniformsPass(info);
 }
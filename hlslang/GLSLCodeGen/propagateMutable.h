@@ -6,12 +6,12 @@
 #ifndef PROPAGATE_MUTABLE_H
 #define PROPAGATE_MUTABLE_H
 
-class TIntermNode;
+class TPass;
 class TInfoSink;
 
-// Iterates over the intermediate tree and propagates mutable uniform qualifiers as necessary
-// to the symbols.
-void PropagateMutableUniforms (TIntermNode* root, TInfoSink &info);
+// Creates the pass that iterates over the intermediate tree and propagates mutable uniform
+// qualifiers as necessary to the symbols.
+TPass* CreateMutableUniformsPass (TInfoSink &info);
 
 
 #endif //PROPAGATE_MUTABLE_H
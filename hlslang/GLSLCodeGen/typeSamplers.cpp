@@ -4,7 +4,7 @@
 
 
 #include "typeSamplers.h"
-#include "localintermediate.h"
+#include "PassManager.h"
 #include "glslOutput.h"
 
 struct TSamplerTraverser : public TIntermTraverser 
@@ -422,23 +422,44 @@ void TSamplerTraverser::typeSampler( TIntermTyped *node, TBasicType samp )
 }
 
 
-void PropagateSamplerTypes (TIntermNode* root, TInfoSink &info)
+//
+// Types one sampler per two walks: the first finds a sampler to type and
+// stops looking, the second sets the type on every use of it.  Done when a
+// first walk finds nothing.
+//
+class TSamplerTypesPass : public TPass
 {
-   TSamplerTraverser st(info);
+public:
+   TSamplerTypesPass(TInfoSink &info) : TPass("PropagateSamplerTypes", EPassInputSamplers), st(info), done(false)
+   {
+   }
 
-   do
+   virtual TIntermTraverser* beginWalk()
    {
+      if (done)
+         return 0;
       st.abort = false;
-      root->traverse( &st);
+      return &st;
+   }
 
+   virtual void endWalk()
+   {
       // If we aborted, try to type the node we aborted for
-      if (st.abort)
-      {
-         st.typing = true;
-         st.abort = false;
-         root->traverse( &st);
+      if (st.typing)
          st.typing = false;
-         st.abort = true;
-      }
-   } while (st.abort);
+      else if (st.abort)
+         st.typing = true;
+      else
+         done = true;
+   }
+
+private:
+   TSamplerTraverser st;
+   bool done;
+};
+
+
+TPass* CreateSamplerTypesPass (TInfoSink &info)
+{
+   return new TSamplerTypesPass(info);
 }
@@ -6,11 +6,11 @@
 #ifndef TYPE_SAMPLERS_H
 #define TYPE_SAMPLERS_H
 
-class TIntermNode;
+class TPass;
 class TInfoSink;
 
-// Iterates over the intermediate tree and sets untyped sampler symbols to have types based on the
-// type of texture operation the samplers are used for
-void PropagateSamplerTypes (TIntermNode* root, TInfoSink &info);
+// Creates the pass that iterates over the intermediate tree and sets untyped sampler symbols to
+// have types based on the type of texture operation the samplers are used for
+TPass* CreateSamplerTypesPass (TInfoSink &info);
 
 #endif //TYPE_SAMPLERS_H
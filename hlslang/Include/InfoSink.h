@@ -8,6 +8,8 @@
 
 #include "../Include/Common.h"
 #include <math.h>
+#include <set>
+#include <vector>
 
 // Returns the fractional part of the given floating-point number.
 inline float fractionalPart(float f) {
@@ -27,21 +29,41 @@ enum TPrefixType
    EPrefixInternalError,
 };
 
+//
+// A warning or error in a log.  Its text starts after the prefix and runs to
+// the end of the line.
+//
+struct TDiagnostic
+{
+   TPrefixType severity;
+   const char* file;    // owned by the log; null if the location has no file
+   int line;            // 0 if the message has no location
+   size_t start;        // offset of the text in the log
+};
+
 //
 // Encapsulate info logs for all objects that have them.
 //
 // The methods are a general set of tools for getting a variety of
-// messages and types inserted into the log.
+// messages and types inserted into the log.  Each warning and error,
+// started by prefix() after an optional location(), is also recorded as a
+// TDiagnostic, so callers need not parse the text to find them.
 //
 class TInfoSinkBase
 {
 public:
    TInfoSinkBase()
+      : pendingLine(0), pendingFile(0), pendingStart(0), hasPending(false), limit(0), dropped(0), dropping(false)
    {
    }
    void erase()
    {
       sink.erase();
+      diagnostics.clear();
+      files.clear();
+      hasPending = false;
+      dropped = 0;
+      dropping = false;
    }
    TInfoSinkBase& operator<<(const TPersistString& t)
    {
@@ -80,7 +102,7 @@ public:
 			stream.precision(6);
 			stream << f;
 		}
-		sink.append(stream.str());
+		append(stream.str());
 		return *this;
 	}
 	
@@ -106,17 +128,27 @@ public:
    }
    void prefix(TPrefixType message)
    {
-      switch (message)
-      {
-      case EPrefixNone:                                      break;
-      case EPrefixWarning:       append("WARNING: ");        break;
-      case EPrefixError:         append("ERROR: ");          break;
-      case EPrefixInternalError: append("INTERNAL ERROR: "); break;
-      default:                   append("UNKOWN ERROR: ");   break;
-      }
+      if (message != EPrefixNone && !beginDiagnostic(message))
+         return;
+      appendPrefix(message);
+      if (message != EPrefixNone)
+         diagnostics.back().start = sink.size();
+   }
+   // Starts a line that sums up the diagnostics before it, such as their
+   // count.  It reads like one but is not one, and the limit leaves it in.
+   void summaryPrefix(TPrefixType message)
+   {
+      hasPending = false;
+      dropping = false;
+      appendPrefix(message);
    }
    void location(TSourceLoc loc)
    {
+      dropping = false;
+      hasPending = true;
+      pendingStart = sink.size();
+      pendingLine = loc.line > 0 ? loc.line : 0;
+      pendingFile = loc.file;
       std::stringstream s;
       s << loc;
       append(s.str());
@@ -136,7 +168,28 @@ public:
       append("\n");
    }
 
+   const std::vector<TDiagnostic>& getDiagnostics() const { return diagnostics; }
+
+   // Warnings and errors past the limit are left out of the log; 0 for no
+   // limit.  The limit is kept when the log is erased.
+   void setLimit(int n) { limit = n; }
+   // Warnings and errors left out since the log was last erased.
+   int getDropped() const { return dropped; }
+
 private:
+   bool beginDiagnostic(TPrefixType severity);
+   void appendPrefix(TPrefixType message)
+   {
+      switch (message)
+      {
+      case EPrefixNone:                                      break;
+      case EPrefixWarning:       append("WARNING: ");        break;
+      case EPrefixError:         append("ERROR: ");          break;
+      case EPrefixInternalError: append("INTERNAL ERROR: "); break;
+      default:                   append("UNKOWN ERROR: ");   break;
+      }
+   }
+
    void append(const char *s); 
 
    void append(int count, char c);
@@ -150,6 +203,19 @@ private:
    }
    void appendToStream(const char* s);
    TPersistString sink;
+
+   std::vector<TDiagnostic> diagnostics;
+   std::set<std::string> files;    // copies of the files diagnostics point into
+
+   // The location written just before a prefix belongs to its diagnostic.
+   int pendingLine;
+   const char* pendingFile;
+   size_t pendingStart;
+   bool hasPending;
+
+   int limit;
+   int dropped;
+   bool dropping;      // the line of a diagnostic past the limit is being left out
 };
 
 class TInfoSink
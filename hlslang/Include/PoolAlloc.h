@@ -104,6 +104,17 @@ public:
    // by calling pop(), and to not have to solve memory leak problems.
    //
 
+   //
+   // Statistics.  The counts of calls to allocate() and of the bytes they
+   // asked for only ever grow; the page bytes are what the pool holds
+   // in use, and the peak is the most it has held since resetPeakBytes().
+   //
+   int getAllocationCount() const { return numCalls; }
+   size_t getAllocatedBytes() const { return totalBytes; }
+   size_t getInUseBytes() const { return inUseBytes; }
+   size_t getPeakBytes() const { return peakBytes; }
+   void resetPeakBytes() { peakBytes = inUseBytes; }
+
 protected:
    friend struct tHeader;
     
@@ -129,6 +140,13 @@ protected:
    };
    typedef std::vector<tAllocState> tAllocStack;
 
+   void addInUseBytes(size_t bytes)
+   {
+      inUseBytes += bytes;
+      if (inUseBytes > peakBytes)
+         peakBytes = inUseBytes;
+   }
+
    bool global;            // should be true if this object is globally scoped
    size_t pageSize;        // granularity of allocation from the OS
    size_t alignment;       // all returned allocations will be aligned at 
@@ -144,6 +162,8 @@ protected:
 
    int numCalls;           // just an interesting statistic
    size_t totalBytes;      // just an interesting statistic
+   size_t inUseBytes;      // size of the pages on inUseList
+   size_t peakBytes;       // high-water mark of inUseBytes
 private:
    TPoolAllocator& operator=(const TPoolAllocator&);  // dont allow assignment operator
    TPoolAllocator(const TPoolAllocator&);  // dont allow default copy constructor
@@ -78,7 +78,62 @@ typedef std::map<TTypeList*, TTypeList*> TStructureMap;
 
 
 //
-// Base class for things that have a type.
+// The part of a type that decides whether two types are the same.  These are
+// interned by a TTypeContext, so that equal ones are one shared instance that
+// is never changed, and what is worked out from them is worked out once.
+//
+struct TTypeData
+{
+   TBasicType type;
+   int size;                  // size of vector or matrix, not size of array
+   bool matrix;
+   bool array;
+   int arraySize;
+   TTypeList* structure;      // 0 unless this is a struct
+   const TString* typeName;   // for structure field type name
+
+   // Filled in when the data is interned
+   unsigned hash;
+   const TString* mangled;
+   int structureSize;
+   bool nonSquareMatrix;
+};
+
+//
+// Interns TTypeData.  Types are built while a context is current on the
+// thread (GlobalTypeContext), and their data lives in the pool allocator that
+// was current when the context was made, so the two go away together.  A
+// context also looks in its parent, which must not change while the context
+// is in use, so the types of the built-in symbol tables are shared by every
+// compile.
+//
+class TTypeContext
+{
+public:
+   explicit TTypeContext(const TTypeContext* parent = 0);
+
+   const TTypeData* intern(const TTypeData& key);
+
+private:
+   const TTypeData* find(const TTypeData& key) const;
+   void insert(const TTypeData* data);
+
+   const TTypeContext* parent;
+   TVector<const TTypeData*> table;   // open addressing; the size is a power of 2
+   int count;
+};
+
+extern TTypeContext*& GetGlobalTypeContext();
+#define GlobalTypeContext GetGlobalTypeContext()
+
+// Interns in the current context, or if there is none, makes data nothing else shares.
+const TTypeData* InternType(const TTypeData& key);
+
+
+//
+// Base class for things that have a type.  The structural part is shared
+// (see TTypeData); what differs from one use of a type to the next is kept
+// here, and changing the structural part points this type at other data.
 //
 class TType
 {
@@ -96,104 +151,87 @@ public:
    POOL_ALLOCATOR_NEW_DELETE(GlobalPoolAllocator)
 
    explicit TType() :
-   type(EbtVoid), precision(EbpUndefined), qualifier(EvqTemporary), size(1), line(gNullSourceLoc), matrix(0), array(0), arraySize(0), 
-      structure(0), structureSize(0), maxArraySize(0), arrayInformationType(0), fieldName(0), mangled(0), typeName(0),
-      semantic(0), nonSquareMatrix(-1)
-   { }
+      precision(EbpUndefined), qualifier(EvqTemporary), maxArraySize(0), line(gNullSourceLoc),
+      arrayInformationType(0), fieldName(0), semantic(0)
+   {
+      setData(EbtVoid, 1, false, false, 0, 0, 0);
+   }
    explicit TType(TBasicType t, TPrecision p, TQualifier q = EvqTemporary, int s = 1, bool m = false, bool a = false) :
-      type(t), precision(p), qualifier(q), size(s), line(gNullSourceLoc), matrix(m), array(a), arraySize(0),
-      structure(0), structureSize(0), maxArraySize(0), arrayInformationType(0), fieldName(0), mangled(0), typeName(0),
-      semantic(0), nonSquareMatrix(-1)
+      precision(p), qualifier(q), maxArraySize(0), line(gNullSourceLoc),
+      arrayInformationType(0), fieldName(0), semantic(0)
    {
+      setData(t, s, m, a, 0, 0, 0);
    }
    explicit TType(const TPublicType &p) :
-      type(p.type), precision(p.precision), qualifier(p.qualifier), size(p.size), line(p.line), matrix(p.matrix), array(p.array), arraySize(p.arraySize), 
-      structure(0), structureSize(0), maxArraySize(0), arrayInformationType(0), fieldName(0), mangled(0), typeName(0),
-      semantic(0), nonSquareMatrix(-1)
+      precision(p.precision), qualifier(p.qualifier), maxArraySize(0), line(p.line),
+      arrayInformationType(0), fieldName(0), semantic(0)
    {
       if (p.userDef)
       {
-         structure = p.userDef->getStruct();
-		  line = p.userDef->line;
-         typeName = NewPoolTString(p.userDef->getTypeName().c_str());
+         setData(p.type, p.size, p.matrix, p.array, p.arraySize, p.userDef->getStruct(), &p.userDef->getTypeName());
+         line = p.userDef->line;
       }
+      else
+         setData(p.type, p.size, p.matrix, p.array, p.arraySize, 0, 0);
    }
    explicit TType(TTypeList* userDef, const TString& n, TPrecision p = EbpUndefined, const TSourceLoc& l = gNullSourceLoc) :
-      type(EbtStruct), precision(p), qualifier(EvqTemporary), size(1), line(l), matrix(false), array(false), arraySize(0),
-      structure(userDef), structureSize(0), maxArraySize(0), arrayInformationType(0), fieldName(0), mangled(0), semantic(0)
-		, nonSquareMatrix(-1)
+      precision(p), qualifier(EvqTemporary), maxArraySize(0), line(l),
+      arrayInformationType(0), fieldName(0), semantic(0)
    {
-      typeName = NewPoolTString(n.c_str());
-   }
-
-   TType(const TType& type) 
-   { 
-	   *this = type;
-	   structureSize = 0; nonSquareMatrix = - 1;//force recalculate structureSize and nonSquareMatrix
+      setData(EbtStruct, 1, false, false, 0, userDef, &n);
    }
 
    TType(const TType& type, TPrecision p, TQualifier q = EvqTemporary) 
    { 
 	   *this = type;
 	   precision = p; qualifier = q;
-	   structureSize = 0; nonSquareMatrix = - 1;//force recalculate structureSize and nonSquareMatrix
    }
 
 
    void copyType(const TType& copyOf, TStructureMap& remapper)
    {
-      type = copyOf.type;
-	  precision = copyOf.precision;
-      qualifier = copyOf.qualifier;
-      size = copyOf.size;
-      matrix = copyOf.matrix;
-      array = copyOf.array;
-      arraySize = copyOf.arraySize;
-	   line = copyOf.line;
-
-      TStructureMap::iterator iter;
-      if (copyOf.structure)
+      TTypeList* structure = 0;
+      if (copyOf.getStruct())
       {
-         if ((iter = remapper.find(structure)) == remapper.end())
+         TStructureMap::iterator iter = remapper.find(copyOf.getStruct());
+         if (iter == remapper.end())
          {
             // create the new structure here
             structure = NewPoolTTypeList();
-            for (unsigned int i = 0; i < copyOf.structure->size(); ++i)
+            for (unsigned int i = 0; i < copyOf.getStruct()->size(); ++i)
             {
                TTypeLine typeLine;
-               typeLine.line = (*copyOf.structure)[i].line;
-               typeLine.type = (*copyOf.structure)[i].type->clone(remapper);
+               typeLine.line = (*copyOf.getStruct())[i].line;
+               typeLine.type = (*copyOf.getStruct())[i].type->clone(remapper);
                structure->push_back(typeLine);
             }
+            remapper[copyOf.getStruct()] = structure;
          }
          else
          {
             structure = iter->second;
          }
       }
-      else
-         structure = 0;
+
+      // The data of copyOf may be going away with its pool, so intern it again here.
+      TTypeData key = *copyOf.data;
+      key.structure = structure;
+      data = InternType(key);
+
+      precision = copyOf.precision;
+      qualifier = copyOf.qualifier;
+      line = copyOf.line;
 
       fieldName = 0;
       if (copyOf.fieldName)
          fieldName = NewPoolTString(copyOf.fieldName->c_str());
-      typeName = 0;
-      if (copyOf.typeName)
-         typeName = NewPoolTString(copyOf.typeName->c_str());
       semantic = 0;
       if (copyOf.semantic)
          semantic = NewPoolTString(copyOf.semantic->c_str());
 
-      mangled = 0;
-      if (copyOf.mangled)
-         mangled = NewPoolTString(copyOf.mangled->c_str());
-
-      structureSize = copyOf.structureSize;
       maxArraySize = copyOf.maxArraySize;
       assert(copyOf.arrayInformationType == 0);
       arrayInformationType = 0; // arrayInformationType should not be set for builtIn symbol table level
-
-	  nonSquareMatrix = -1;//force recheck if this is non-square matrix
    }
 
    TType* clone(TStructureMap& remapper)
@@ -206,7 +244,9 @@ public:
 
    void setTypeName(const TString& n)
    {
-      typeName = NewPoolTString(n.c_str());
+      TTypeData key = *data;
+      key.typeName = &n;
+      data = InternType(key);
    }
    void setFieldName(const TString& n)
    {
@@ -214,8 +254,8 @@ public:
    }
    const TString& getTypeName() const
    {
-      assert(typeName);          
-      return *typeName; 
+      assert(data->typeName);          
+      return *data->typeName; 
    }
 
    const TString& getFieldName() const
@@ -224,42 +264,78 @@ public:
       return *fieldName; 
    }
 
-   TBasicType getBasicType() const { return type; }
+   // Types with the same data are the same type
+   const TTypeData* getData() const { return data; }
+
+   TBasicType getBasicType() const { return data->type; }
    TBasicType getNonSquareMatBasicType() const;
    TPrecision getPrecision() const { return precision; }
    TQualifier getQualifier() const { return qualifier; }
    const TSourceLoc& getLine() const { return line; }
 
-   void setBasicType(TBasicType t) { type = t; }
+   void setBasicType(TBasicType t)
+   {
+      TTypeData key = *data;
+      key.type = t;
+      data = InternType(key);
+   }
    void setPrecision(TPrecision p) { precision = p; }
    void changeQualifier(TQualifier q) { qualifier = q; }
 
    // One-dimensional size of single instance type
-   int getNominalSize() const { return size; }  
-   void setNominalSize(int s) { size = s; }
+   int getNominalSize() const { return data->size; }  
+   void setNominalSize(int s)
+   {
+      TTypeData key = *data;
+      key.size = s;
+      data = InternType(key);
+   }
 
    // Full-dimensional size of single instance of type
    int getInstanceSize() const  
    {
-      if (matrix)
-         return size * size;
+      if (data->matrix)
+         return data->size * data->size;
       else
-         return size;
+         return data->size;
    }
 
-   bool isMatrix() const { return matrix ? true : false; }
-   void setMatrix(bool m) { matrix = m; }
-   void setArray(bool is_array) { array = is_array; }
-   bool isArray() const { return array ? true : false; }
-   int getArraySize() const { return arraySize; }
-   void setArraySize(int s) { array = true; arraySize = s; }
+   bool isMatrix() const { return data->matrix; }
+   void setMatrix(bool m)
+   {
+      TTypeData key = *data;
+      key.matrix = m;
+      data = InternType(key);
+   }
+   void setArray(bool is_array)
+   {
+      TTypeData key = *data;
+      key.array = is_array;
+      data = InternType(key);
+   }
+   bool isArray() const { return data->array; }
+   int getArraySize() const { return data->arraySize; }
+   void setArraySize(int s)
+   {
+      TTypeData key = *data;
+      key.array = true;
+      key.arraySize = s;
+      data = InternType(key);
+   }
    void setMaxArraySize (int s) { maxArraySize = s; }
    int getMaxArraySize () const { return maxArraySize; }
-   void clearArrayness() { array = false; arraySize = 0; maxArraySize = 0; }
+   void clearArrayness()
+   {
+      TTypeData key = *data;
+      key.array = false;
+      key.arraySize = 0;
+      data = InternType(key);
+      maxArraySize = 0;
+   }
    void setArrayInformationType(TType* t) { arrayInformationType = t; }
-   TType* getArrayInformationType() { return arrayInformationType; }
-   bool isVector() const { return size > 1 && !matrix; }
-   bool isNonSquareMatrix() const;
+   TType* getArrayInformationType() const { return arrayInformationType; }
+   bool isVector() const { return data->size > 1 && !data->matrix; }
+   bool isNonSquareMatrix() const { return data->nonSquareMatrix; }
    int getNonSquareColumns() const { assert(getStruct()); return getStruct()->size(); }
    int getNonSquareRows() const ;
    int getNonSquareFieldIndex(int array_subscriptIndex) const;
@@ -283,8 +359,13 @@ public:
       default:                   return "unknown type";
       }
    }
-   TTypeList* getStruct() const { return structure; }
-   void setStruct(TTypeList* s) { structure = s; }
+   TTypeList* getStruct() const { return data->structure; }
+   void setStruct(TTypeList* s)
+   {
+      TTypeData key = *data;
+      key.structure = s;
+      data = InternType(key);
+   }
 	
    int getObjectSize() const
    {
@@ -292,10 +373,10 @@ public:
 
       if (getBasicType() == EbtStruct)
          totalSize = getStructSize();
-      else if (matrix)
-         totalSize = size * size;
+      else if (data->matrix)
+         totalSize = data->size * data->size;
       else
-         totalSize = size;
+         totalSize = data->size;
 
       if (isArray())
          totalSize *= Max(getArraySize(), getMaxArraySize());
@@ -303,38 +384,26 @@ public:
       return totalSize;
    }
 
-   TString& getMangledName()
-   {
-      if (!mangled)
-      {
-         mangled = NewPoolTString("");
-         buildMangledName(*mangled);            
-         *mangled += ';' ;
-      }
-
-      return *mangled;
-   }
+   const TString& getMangledName() const { return *data->mangled; }
+   // The mangled name without its terminating ';'
+   void buildMangledName(TString& res) const { res.append(*data->mangled, 0, data->mangled->size() - 1); }
    bool sameElementType(const TType& right) const
    {
-      return      type == right.type   &&
-      size == right.size   &&
-      matrix == right.matrix &&
-      structure == right.structure;
+      return      data->type == right.data->type   &&
+      data->size == right.data->size   &&
+      data->matrix == right.data->matrix &&
+      data->structure == right.data->structure;
    }
    bool operator==(const TType& right) const
    {
-      return      type == right.type   &&
-      size == right.size   &&
-      matrix == right.matrix &&
-      array == right.array  && (!array || arraySize == right.arraySize) &&
-      structure == right.structure;
+      return data == right.data;
       // don't check the qualifier, it's not ever what's being sought after
    }
    bool operator!=(const TType& right) const
    {
       return !operator==(right);
    }
-   const char* getBasicString() const { return TType::getBasicString(type); }
+   const char* getBasicString() const { return TType::getBasicString(data->type); }
    const char* getQualifierString() const { return ::getQualifierString(qualifier); }
    TString getCompleteString() const;
 
@@ -342,31 +411,25 @@ public:
    void setSemantic( const TString &s) { semantic = NewPoolTString(s.c_str()); }
    bool hasSemantic() const { return semantic != 0; }
 
-   void buildMangledName(TString& res) const;
-
    // Determine the parameter compatibility between this type and the parameter type
    ECompatibility determineCompatibility ( const TType *pType ) const;
 
 private:
    int getStructSize() const;
 
-   TPrecision precision;
-   TBasicType type      : 6;
-   TQualifier qualifier : 7;
-   int size             : 8; // size of vector or matrix, not size of array
-   unsigned int matrix  : 1;
-   unsigned int array   : 1;
-   int arraySize;
-   TSourceLoc line;
-   mutable int nonSquareMatrix;
+   void setData(TBasicType t, int s, bool m, bool a, int arraySize, TTypeList* structure, const TString* typeName)
+   {
+      TTypeData key = { t, s, m, a, arraySize, structure, typeName, 0, 0, 0, false };
+      data = InternType(key);
+   }
 
-   TTypeList* structure;      // 0 unless this is a struct
-   mutable int structureSize;
+   const TTypeData* data;
+   TPrecision precision : 8;
+   TQualifier qualifier : 8;
    int maxArraySize;
+   TSourceLoc line;
    TType* arrayInformationType;
    TString *fieldName;         // for structure field names
-   TString *mangled;
-   TString *typeName;          // for structure field type name
    TString *semantic; //for semantics on structure fields
 };
 
@@ -256,6 +256,24 @@ class TIntermSymbol;
 class TInfoSink;
 class TIntermDeclaration;
 
+//
+// Which class a node is.  Nodes have no virtual functions: traversal, the
+// getAs* casts and destruction switch on this instead.  The kinds of typed
+// nodes come first, and those of operator nodes are together among them.
+//
+enum TIntermNodeKind
+{
+	EIntermSymbol,
+	EIntermConstant,
+	EIntermDeclaration,
+	EIntermSelection,
+	EIntermBinary,
+	EIntermUnary,
+	EIntermAggregate,
+	EIntermLoop,
+	EIntermBranch,
+};
+
 //
 // Base class for the tree nodes
 //
@@ -264,32 +282,38 @@ class TIntermNode
 public:
 	POOL_ALLOCATOR_NEW_DELETE(GlobalPoolAllocator)
 
-	TIntermNode() : line(gNullSourceLoc), refCount(1)
+	explicit TIntermNode(TIntermNodeKind k) : line(gNullSourceLoc), kind(k), refCount(1)
 	{
 	}
 
 	void AddRef() { refCount++; }
-	void Release() { refCount--; if (!refCount) delete this; }
+	void Release() { refCount--; if (!refCount) destroy(); }
 
 	const TSourceLoc& getLine() const { return line; }
 	void setLine(const TSourceLoc& l) { line = l; }
 
-	virtual void traverse(TIntermTraverser*) = 0;
+	TIntermNodeKind getKind() const { return kind; }
+
+	// Visits this node and everything below it; see IntermTraverse.cpp.
+	void traverse(TIntermTraverser*);
 
-	virtual TIntermTyped*     getAsTyped() { return 0; }
-	virtual TIntermOperator*  getAsOperatorNode() { return 0; }
-	virtual TIntermConstant*     getAsConstant() { return 0; }
-	virtual TIntermAggregate* getAsAggregate() { return 0; }
-	virtual TIntermBinary*    getAsBinaryNode() { return 0; }
-	virtual TIntermSelection* getAsSelectionNode() { return 0; }
-	virtual TIntermSymbol*    getAsSymbolNode() { return 0; }
-	virtual TIntermDeclaration* getAsDeclaration() { return 0; }
+	TIntermTyped*     getAsTyped();
+	TIntermOperator*  getAsOperatorNode();
+	TIntermConstant*     getAsConstant();
+	TIntermAggregate* getAsAggregate();
+	TIntermBinary*    getAsBinaryNode();
+	TIntermSelection* getAsSelectionNode();
+	TIntermSymbol*    getAsSymbolNode();
+	TIntermDeclaration* getAsDeclaration();
 
 protected:
-	virtual ~TIntermNode() {}
+	~TIntermNode() {}
 	TSourceLoc line;
 private:
-	size_t refCount;
+	void destroy();
+
+	TIntermNodeKind kind;
+	int refCount;
 };
 
 //
@@ -310,14 +334,12 @@ class TIntermBinary;
 class TIntermTyped : public TIntermNode
 {
 public:
-   TIntermTyped(const TType& t) : type(t)
+   TIntermTyped(TIntermNodeKind k, const TType& t) : TIntermNode(k), type(t)
    {
    }
 
-   virtual TIntermTyped* getAsTyped() { return this; }
-
    void setType(const TType& t) { type = t; }
-   TType getType() const { return type; }
+   const TType& getType() const { return type; }
    TType* getTypePointer() { return &type; }
 
    TBasicType getBasicType() const { return type.getBasicType(); }
@@ -334,6 +356,7 @@ public:
    TString getCompleteString() const { return type.getCompleteString(); }
 
 protected:
+	friend class TIntermNode;
 	~TIntermTyped() {}
    TType type;
 };
@@ -351,13 +374,13 @@ class TIntermLoop : public TIntermNode
 {
 public:
 	TIntermLoop(TLoopType aType, TIntermTyped* aCond, TIntermTyped* aExpr, TIntermNode* aBody) : 
+	TIntermNode(EIntermLoop),
 	type(aType),
 	cond(aCond),
 	expr(aExpr),
 	body(aBody)
    {
    }
-   virtual void traverse(TIntermTraverser*);
 	
 	TLoopType getType() const { return type; }
 	TIntermTyped* getCondition() { return cond; }
@@ -365,6 +388,7 @@ public:
    TIntermNode*  getBody() { return body; }
 	
 protected:
+	friend class TIntermNode;
 	~TIntermLoop() {}
 	TLoopType	type;
 	TIntermTyped* cond;  // loop exit condition, could be 0 for for-loops
@@ -379,15 +403,16 @@ class TIntermBranch : public TIntermNode
 {
 public:
    TIntermBranch(TOperator op, TIntermTyped* e) :
+   TIntermNode(EIntermBranch),
    flowOp(op),
    expression(e)
    {
    }
-   virtual void traverse(TIntermTraverser*);
 
    TOperator getFlowOp() { return flowOp; }
    TIntermTyped* getExpression() { return expression; }
 protected:
+	friend class TIntermNode;
 	~TIntermBranch() {}
    TOperator flowOp;
    TIntermTyped* expression;  // non-zero except for "return exp;" statements
@@ -403,12 +428,12 @@ public:
 	// per process globalpoolallocator, then it causes increased memory usage per compile
 	// it is essential to use "symbol = sym" to assign to symbol
 	TIntermSymbol(int i, const TString& sym, const TType& t) : 
-		TIntermTyped(t), id(i), info(0), global(false)
+		TIntermTyped(EIntermSymbol, t), id(i), info(0), global(false)
 	{
 		symbol = sym;
 	} 
 	TIntermSymbol(int i, const TString& sym, const TTypeInfo *inf, const TType& t) : 
-		TIntermTyped(t), id(i), info(inf), global(false)
+		TIntermTyped(EIntermSymbol, t), id(i), info(inf), global(false)
 	{
 		symbol = sym;
 	} 
@@ -418,16 +443,12 @@ public:
 	bool isGlobal() const { return global; }
 	void setGlobal(bool g) { global = g; }
 
-	virtual const TTypeInfo* getInfo() const
+	const TTypeInfo* getInfo() const
 	{
 		return info;
 	}
-	virtual void traverse(TIntermTraverser*);
-	virtual TIntermSymbol* getAsSymbolNode()
-	{
-		return this;
-	}
 protected:
+	friend class TIntermNode;
 	~TIntermSymbol() {}
 	int id;
 	bool global;
@@ -437,11 +458,9 @@ protected:
 
 class TIntermDeclaration : public TIntermTyped {
 public:
-	TIntermDeclaration(const TType& type) : TIntermTyped(type), _declaration(NULL) {
+	TIntermDeclaration(const TType& type) : TIntermTyped(EIntermDeclaration, type), _declaration(NULL) {
 		
 	}
-	virtual void traverse(TIntermTraverser*);
-	virtual TIntermDeclaration* getAsDeclaration() { return this; }
 	
 	bool isSingleDeclaration() const { return _declaration->getAsSymbolNode() != NULL || _declaration->getAsBinaryNode() != NULL; }
 	bool isSingleInitialization() const { return _declaration->getAsBinaryNode() != NULL; }
@@ -466,6 +485,7 @@ public:
 	}
 	
 private:
+	friend class TIntermNode;
 	~TIntermDeclaration() {}
 	TIntermTyped* _declaration;
 };
@@ -473,16 +493,11 @@ private:
 class TIntermConstant : public TIntermTyped
 {
 public:
-	TIntermConstant(const TType& t) : TIntermTyped(t)
+	TIntermConstant(const TType& t) : TIntermTyped(EIntermConstant, t)
 	{
 		grow(t.getObjectSize() - 1);
 	}
 
-	virtual TIntermConstant* getAsConstant()
-	{
-		return this;
-	}
-
 	struct Value {
 		TBasicType type;
 		union {
@@ -513,8 +528,8 @@ public:
 		return values.size();
 	}
 
-	virtual void traverse(TIntermTraverser* );
 protected:
+	friend class TIntermNode;
 	~TIntermConstant() {}
 	void grow(unsigned ix) {
 		if (values.size() <= ix)
@@ -534,18 +549,15 @@ public:
    TOperator getOp() const { return op; }
    bool modifiesState() const;
    bool isConstructor() const;
-   virtual bool promote(TInfoSink&)
+   bool promote(TInfoSink&)
    {
       return true;
    }
-   virtual TIntermOperator* getAsOperatorNode()
-   {
-      return this;
-   }
 protected:
+	friend class TIntermNode;
 	~TIntermOperator() {}
-   TIntermOperator(TOperator o) : TIntermTyped(TType(EbtFloat, EbpUndefined)), op(o) {}
-   TIntermOperator(TOperator o, TType& t) : TIntermTyped(t), op(o) {}   
+   TIntermOperator(TIntermNodeKind k, TOperator o) : TIntermTyped(k, TType(EbtFloat, EbpUndefined)), op(o) {}
+   TIntermOperator(TIntermNodeKind k, TOperator o, TType& t) : TIntermTyped(k, t), op(o) {}   
    TOperator op;
 };
 
@@ -555,22 +567,18 @@ protected:
 class TIntermBinary : public TIntermOperator
 {
 public:
-   TIntermBinary(TOperator o) : TIntermOperator(o)
+   TIntermBinary(TOperator o) : TIntermOperator(EIntermBinary, o)
    {
    }
-   virtual void traverse(TIntermTraverser*);
 
    void setLeft(TIntermTyped* n) { left = n; }
    void setRight(TIntermTyped* n) { right = n; }
    TIntermTyped* getLeft() const { return left; }
    TIntermTyped* getRight() const { return right; }
 
-   virtual TIntermBinary* getAsBinaryNode()
-   {
-      return this;
-   }
-   virtual bool promote(TInfoSink&);
+   bool promote(TInfoSink&);
 protected:
+	friend class TIntermNode;
 	~TIntermBinary() {}
    TIntermTyped* left;
    TIntermTyped* right;
@@ -582,19 +590,19 @@ protected:
 class TIntermUnary : public TIntermOperator
 {
 public:
-   TIntermUnary(TOperator o, TType& t) : TIntermOperator(o, t), operand(0)
+   TIntermUnary(TOperator o, TType& t) : TIntermOperator(EIntermUnary, o, t), operand(0)
    {
    }
-   TIntermUnary(TOperator o) : TIntermOperator(o), operand(0)
+   TIntermUnary(TOperator o) : TIntermOperator(EIntermUnary, o), operand(0)
    {
    }
-   virtual void traverse(TIntermTraverser*);
 
    void setOperand(TIntermTyped* o) { operand = o; }
    TIntermTyped* getOperand() { return operand; }
 
-   virtual bool promote(TInfoSink&);
+   bool promote(TInfoSink&);
 protected:
+	friend class TIntermNode;
 	~TIntermUnary() {}
    TIntermTyped* operand;
 };
@@ -607,16 +615,11 @@ typedef TVector<TIntermNode*> TIntermSequence;
 class TIntermAggregate : public TIntermOperator
 {
 public:
-   TIntermAggregate() : TIntermOperator(EOpNull)
-   {
-   }
-   TIntermAggregate(TOperator o) : TIntermOperator(o)
+   TIntermAggregate() : TIntermOperator(EIntermAggregate, EOpNull)
    {
    }
-
-   virtual TIntermAggregate* getAsAggregate()
+   TIntermAggregate(TOperator o) : TIntermOperator(EIntermAggregate, o)
    {
-      return this;
    }
 
    void setOperator(TOperator o) { op = o; }
@@ -628,9 +631,9 @@ public:
    const TString& getPlainName() const { return plainName; }
    const TString& getSemantic() const { return semantic; }
 
-   virtual void traverse(TIntermTraverser*);
 
 protected:
+   friend class TIntermNode;
    ~TIntermAggregate() { }
 
    TIntermAggregate(const TIntermAggregate&); // disallow copy constructor
@@ -648,18 +651,17 @@ class TIntermSelection : public TIntermTyped
 {
 public:
    TIntermSelection(TIntermTyped* cond, TIntermNode* trueB, TIntermNode* falseB) :
-	  TIntermTyped(TType(EbtVoid,EbpUndefined)), condition(cond), trueBlock(trueB), falseBlock(falseB) { }
+	  TIntermTyped(EIntermSelection, TType(EbtVoid,EbpUndefined)), condition(cond), trueBlock(trueB), falseBlock(falseB) { }
    TIntermSelection(TIntermTyped* cond, TIntermNode* trueB, TIntermNode* falseB, const TType& type) :
-	  TIntermTyped(type), condition(cond), trueBlock(trueB), falseBlock(falseB) { }
-   virtual void traverse(TIntermTraverser*);
+	  TIntermTyped(EIntermSelection, type), condition(cond), trueBlock(trueB), falseBlock(falseB) { }
 
    TIntermNode* getCondition() const { return condition; }
    TIntermNode* getTrueBlock() const { return trueBlock; }
    TIntermNode* getFalseBlock() const { return falseBlock; }
-   TIntermSelection* getAsSelectionNode() { return this; }
 
 	bool promoteTernary(TInfoSink&);
 protected:
+	friend class TIntermNode;
 	~TIntermSelection() {}
    TIntermTyped* condition;
    TIntermNode* trueBlock;
@@ -710,5 +712,39 @@ public:
 	bool postVisit;
 };
 
+
+inline TIntermTyped* TIntermNode::getAsTyped()
+{
+	return kind < EIntermLoop ? static_cast<TIntermTyped*>(this) : 0;
+}
+inline TIntermOperator* TIntermNode::getAsOperatorNode()
+{
+	return kind >= EIntermBinary && kind <= EIntermAggregate ? static_cast<TIntermOperator*>(this) : 0;
+}
+inline TIntermConstant* TIntermNode::getAsConstant()
+{
+	return kind == EIntermConstant ? static_cast<TIntermConstant*>(this) : 0;
+}
+inline TIntermAggregate* TIntermNode::getAsAggregate()
+{
+	return kind == EIntermAggregate ? static_cast<TIntermAggregate*>(this) : 0;
+}
+inline TIntermBinary* TIntermNode::getAsBinaryNode()
+{
+	return kind == EIntermBinary ? static_cast<TIntermBinary*>(this) : 0;
+}
+inline TIntermSelection* TIntermNode::getAsSelectionNode()
+{
+	return kind == EIntermSelection ? static_cast<TIntermSelection*>(this) : 0;
+}
+inline TIntermSymbol* TIntermNode::getAsSymbolNode()
+{
+	return kind == EIntermSymbol ? static_cast<TIntermSymbol*>(this) : 0;
+}
+inline TIntermDeclaration* TIntermNode::getAsDeclaration()
+{
+	return kind == EIntermDeclaration ? static_cast<TIntermDeclaration*>(this) : 0;
+}
+
 #endif // __INTERMEDIATE_H
 
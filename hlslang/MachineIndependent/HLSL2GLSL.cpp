@@ -6,14 +6,21 @@
 #include "ParseHelper.h"
 
 #include "InitializeDll.h"
+#include "osinclude.h"
 
 #include "../../include/hlsl2glsl.h"
 #include "Initialize.h"
+#include "ResultCache.h"
+#include "Trace.h"
+#include "WorkPool.h"
 #include "../GLSLCodeGen/hlslSupportLib.h"
 
 #include "../GLSLCodeGen/hlslCrossCompiler.h"
 #include "../GLSLCodeGen/hlslLinker.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 
 // A symbol table for each language.  Each has a different set of built-ins, and we want to preserve that 
 // from compile to compile.
@@ -23,12 +30,12 @@ TSymbolTable SymbolTables[EShLangCount];
 // Global pool allocator (per process)
 TPoolAllocator* PerProcessGPA = 0;
 
+// Types of the built-in symbol tables, in PerProcessGPA; the parent of each compile's types
+static TTypeContext* PerProcessTypes = 0;
 
-// add support for non square matrix
-static void initFullSource(std::string &fullSource)
-{
-	{
-	fullSource = 
+
+// add support for non square matrix; scanned ahead of shaders that use them
+static const char* nonSquareMatrixSource =
 	"//-----------------float--------------------\n\
 	struct float3x2\n\
 	{\n\
@@ -317,11 +324,7 @@ static void initFullSource(std::string &fullSource)
 						 float2( m[2]),\n\
 						 float2( m[3]));\n\
 	}\n\
-	\n";
-	}
-
-	{
-	fullSource += 
+	\n"
 	"//---------get matrix rows-----------------\n\
 	void getRows(float4x3 m, out float3 row[4])\n\
 	{\n\
@@ -617,10 +620,7 @@ static void initFullSource(std::string &fullSource)
 		return vec;\n\
 	}\n\
 	\n\
-	";
-	}
-	{
-	fullSource +=
+	"
 	"//---------vector mul matrix---------------\n\
 	float2 mul (float2x3 m, float3 v)\n\
 	{\n\
@@ -1278,10 +1278,7 @@ static void initFullSource(std::string &fullSource)
 						dot(m1[1], row[2] ));\n\
 						\n\
 		return result;\n\
-	}\n";
-	}
-	{
-	fullSource += 
+	}\n"
 #if 1
 		"#define half3x2 float3x2\n\
 		#define half2x3 float2x3\n\
@@ -1937,8 +1934,6 @@ static void initFullSource(std::string &fullSource)
 	\n\
 	#line 1\n";
 #endif
-	}
-}
 
 
 /// Initializize the symbol table
@@ -1971,8 +1966,6 @@ static bool InitializeSymbolTable( TBuiltInStrings* BuiltInStrings, EShLanguage
 
    GlobalParseContext = &parseContext;
 
-   setInitialState();
-
    assert(symbolTable->isEmpty() || symbolTable->atSharedBuiltInLevel());
 
    //
@@ -2000,7 +1993,7 @@ static bool InitializeSymbolTable( TBuiltInStrings* BuiltInStrings, EShLanguage
    {
       const char* builtInShaders = (*i).c_str();
 
-      if (PaParseString(const_cast<char*>(builtInShaders), parseContext) != 0)
+      if (PaParseString(builtInShaders, parseContext) != 0)
       {
          infoSink.info.message(EPrefixInternalError, "Unable to parse built-ins");
          return false;
@@ -2068,6 +2061,8 @@ int C_DECL Hlsl2Glsl_Initialize(GlobalAllocateFunction alloc, GlobalFreeFunction
       builtInPoolAllocator->push();
       TPoolAllocator* gPoolAllocator = &GlobalPoolAllocator;
       SetGlobalPoolAllocatorPtr(builtInPoolAllocator);
+      TTypeContext* builtInTypes = new TTypeContext();
+      GlobalTypeContext = builtInTypes;
 
       TSymbolTable symTables[EShLangCount];
       GenerateBuiltInSymbolTable(infoSink, symTables, EShLangCount, "");
@@ -2075,11 +2070,15 @@ int C_DECL Hlsl2Glsl_Initialize(GlobalAllocateFunction alloc, GlobalFreeFunction
       PerProcessGPA = new TPoolAllocator(true);
       PerProcessGPA->push();
       SetGlobalPoolAllocatorPtr(PerProcessGPA);
+      PerProcessTypes = new TTypeContext();
+      GlobalTypeContext = PerProcessTypes;
 
       SymbolTables[EShLangVertex].copyTable(symTables[EShLangVertex]);
       SymbolTables[EShLangFragment].copyTable(symTables[EShLangFragment]);
 
       SetGlobalPoolAllocatorPtr(gPoolAllocator);
+      GlobalTypeContext = 0;
+      delete builtInTypes;
 
       symTables[EShLangVertex].pop();
       symTables[EShLangFragment].pop();
@@ -2091,26 +2090,40 @@ int C_DECL Hlsl2Glsl_Initialize(GlobalAllocateFunction alloc, GlobalFreeFunction
 
    }
 
+   const char* tracePath = getenv("HLSL2GLSL_TRACE");
+   if (tracePath && *tracePath && !TraceEnabled())
+      TraceStart(tracePath);
+
    return ret ? 1 : 0;
 }
 
 int C_DECL Hlsl2Glsl_Shutdown()
 {
+   TraceStop();
    return DetachProcess();
 }
 
 int C_DECL Hlsl2Glsl_Finalize()
 {
+   // Work still running uses the built-in symbol tables.
+   StopJobQueue();
+
    if (PerProcessGPA)
    {
       SymbolTables[EShLangVertex].pop();
       SymbolTables[EShLangFragment].pop();
 
+      delete PerProcessTypes;
+      PerProcessTypes = NULL;
       PerProcessGPA->popAll();
       delete PerProcessGPA;
       PerProcessGPA = NULL;
       finalizeHLSLSupportLibrary();
    }
+   FreeIncludeCache();
+   SetResultCacheLimit(0);
+   SetResultCacheDirectory(0, 0, false);
+   TraceStop();
    return 1;
 }
 
@@ -2129,9 +2142,19 @@ void C_DECL Hlsl2Glsl_DestructCompiler( ShHandle handle )
    if (handle == 0)
       return;
 
+   CancelJobs(handle);
+   WaitForJobs(handle);
    delete handle;
 }
 
+void C_DECL Hlsl2Glsl_ResetCompiler( ShHandle handle )
+{
+   if (handle == 0)
+      return;
+
+   handle->reset();
+}
+
 
 int C_DECL Hlsl2Glsl_Parse(
 	const ShHandle handle,
@@ -2140,33 +2163,103 @@ int C_DECL Hlsl2Glsl_Parse(
 	ETargetVersion targetVersion,
 	unsigned options)
 {
-   if (!InitThread())
-      return 0;
+   return Hlsl2Glsl_ParseWithDefines(handle, shaderString, 0, 0, cgProfile, targetVersion, options);
+}
 
-   if (handle == 0)
-      return 0;
 
-   HlslCrossCompiler* compiler = handle;
-   compiler->cgProfile = cgProfile != NULL? cgProfile : "";
+//
+// Quick check if there is any reference to non square matrix.
+//
+static bool UsesNonSquareMatrices(const char* shaderString)
+{
+   if (!shaderString)
+      return false;
+
+   return strstr(shaderString, "float2x3") != NULL ||
+	   strstr(shaderString, "float3x2") != NULL ||
+	   strstr(shaderString, "float3x4") != NULL ||
+	   strstr(shaderString, "float4x3") != NULL ||
+	   strstr(shaderString, "float2x4") != NULL ||
+	   strstr(shaderString, "float4x2") != NULL ||
+
+	   strstr(shaderString, "half2x3") != NULL ||
+	   strstr(shaderString, "half3x2") != NULL ||
+	   strstr(shaderString, "half3x4") != NULL ||
+	   strstr(shaderString, "half4x3") != NULL ||
+	   strstr(shaderString, "half2x4") != NULL ||
+	   strstr(shaderString, "half4x2") != NULL ||
+
+	   strstr(shaderString, "fixed2x3") != NULL ||
+	   strstr(shaderString, "fixed3x2") != NULL ||
+	   strstr(shaderString, "fixed3x4") != NULL ||
+	   strstr(shaderString, "fixed4x3") != NULL ||
+	   strstr(shaderString, "fixed2x4") != NULL ||
+	   strstr(shaderString, "fixed4x2") != NULL;
+}
+
+static bool UsesNonSquareMatrices(const char* shaderString, const ShMacroDefine* defines, int defineCount)
+{
+   if (UsesNonSquareMatrices(shaderString))
+      return true;
+   for (int i = 0; i < defineCount; ++i)
+   {
+      if (UsesNonSquareMatrices(defines[i].value))
+         return true;
+   }
+   return false;
+}
+
+
+//
+// Parse a shader into the compiler, whose cgProfile is already set.  The
+// parse stops after maxErrors errors, unless it is 0.  A shader that is only
+// validated is checked but not walked into the compiler's code lists.  If the
+// shader was already preprocessed, its tokens are parsed instead of the source.
+//
+static int ParseShader(
+	HlslCrossCompiler* compiler,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	ETargetVersion targetVersion,
+	unsigned options,
+	int maxErrors,
+	bool validateOnly,
+	const TPreprocessedShader* preprocessed = 0)
+{
+   TPoolAllocator& pool = GlobalPoolAllocator;
+   size_t poolBytes = pool.getInUseBytes();
+   int poolCalls = pool.getAllocationCount();
+   size_t poolRequested = pool.getAllocatedBytes();
+   pool.resetPeakBytes();
+   double parseStart = OS_GetTime();
 
    GlobalPoolAllocator.push();
    compiler->infoSink.info.erase();
    compiler->infoSink.debug.erase();
 
-   if (!shaderString)
+   if (!shaderString && !preprocessed)
 	   return 1;
 
+   ShCompileStats& stats = compiler->stats;
+   TTypeContext types(PerProcessTypes);
+   GlobalTypeContext = &types;
+
    TIntermediate intermediate(compiler->infoSink);
    TSymbolTable symbolTable(SymbolTables[compiler->getLanguage()]);
 
    GenerateBuiltInSymbolTable(compiler->infoSink, &symbolTable, compiler->getLanguage(), compiler->cgProfile);
 
    TParseContext parseContext(symbolTable, intermediate, compiler->getLanguage(), targetVersion, compiler->cgProfile, options, compiler->infoSink);
+   parseContext.includeOpen = compiler->includeOpen;
+   parseContext.includeClose = compiler->includeClose;
+   parseContext.includeUserData = compiler->includeUserData;
+   parseContext.maxErrors = maxErrors;
+   parseContext.defines = defines;
+   parseContext.defineCount = defineCount;
 
    GlobalParseContext = &parseContext;
 
-   setInitialState();
-
    InitPreprocessor();    
    //
    // Parse the application's shaders.  All the following symbol table
@@ -2179,55 +2272,46 @@ int C_DECL Hlsl2Glsl_Parse(
    if (!symbolTable.atGlobalLevel())
       parseContext.infoSink.info.message(EPrefixInternalError, "Wrong symbol table level");
 
-
-   std::string fullSource ;
-   //quick check if there is any reference to non square matrix
-   if (strstr(shaderString, "float2x3") != NULL ||
-	   strstr(shaderString, "float3x2") != NULL ||
-	   strstr(shaderString, "float3x4") != NULL ||
-	   strstr(shaderString, "float4x3") != NULL ||
-	   strstr(shaderString, "float2x4") != NULL ||
-	   strstr(shaderString, "float4x2") != NULL ||
-
-	   strstr(shaderString, "half2x3") != NULL ||
-	   strstr(shaderString, "half3x2") != NULL ||
-	   strstr(shaderString, "half3x4") != NULL ||
-	   strstr(shaderString, "half4x3") != NULL ||
-	   strstr(shaderString, "half2x4") != NULL ||
-	   strstr(shaderString, "half4x2") != NULL ||
-
-	   
-	   strstr(shaderString, "fixed2x3") != NULL ||
-	   strstr(shaderString, "fixed3x2") != NULL ||
-	   strstr(shaderString, "fixed3x4") != NULL ||
-	   strstr(shaderString, "fixed4x3") != NULL ||
-	   strstr(shaderString, "fixed2x4") != NULL ||
-	   strstr(shaderString, "fixed4x2") != NULL 
-	   )
-	 //add support for non square matrix
-		initFullSource(fullSource);
-
-   fullSource += shaderString;
-
-   int ret = PaParseString(const_cast<char*>(fullSource.c_str()), parseContext);
+   // The support for non square matrices goes ahead of the macros, which are
+   // only entered once it is scanned, so that it stays as written.  If neither
+   // the source nor the defines name such a type, one can still come from an
+   // #include, so the preprocessed shader decides.
+   int ret;
+   if (preprocessed)
+      ret = PaParseTokens(*preprocessed, parseContext);
+   else
+   {
+      bool nonSquare = UsesNonSquareMatrices(shaderString, defines, defineCount);
+      ret = PaParseString(shaderString, parseContext, nonSquareMatrixSource, !nonSquare);
+   }
    if (ret)
       success = false;
 
-   if (success && parseContext.treeRoot)
+   double parseEnd = OS_GetTime();
+   stats.preprocessTime += parseContext.preprocessTime;
+   stats.parseTime = parseEnd - parseStart - parseContext.preprocessTime;
+
+   // The parse event holds the preprocessing, unless that already ran.
+   if (TraceEnabled())
+   {
+      TTraceArg sourceArgs[] = { { "sourceBytes", preprocessed ? preprocessed->sourceBytes : (int)strlen(shaderString) } };
+      TraceEvent("Parse", parseStart, parseEnd, compiler->traceName, sourceArgs, 1);
+      if (!preprocessed)
+         TraceEvent("Preprocess", parseContext.preprocessStart, parseContext.preprocessStart + parseContext.preprocessTime,
+                    compiler->traceName, sourceArgs, 1);
+   }
+
+   if (success && parseContext.treeRoot && !validateOnly)
    {
 		TIntermAggregate* aggRoot = parseContext.treeRoot->getAsAggregate();
 		if (aggRoot && aggRoot->getOp() == EOpNull)
 			aggRoot->setOperator(EOpSequence);
 
-		if (options & ETranslateOpIntermediate)
-			intermediate.outputTree(parseContext.treeRoot);
-
-		compiler->TransformAST (parseContext.treeRoot);
-		compiler->ProduceGLSL (&parseContext, targetVersion, options);
+		compiler->RunPasses (&parseContext, targetVersion, options);
    }
    else if (!success)
    {
-      parseContext.infoSink.info.prefix(EPrefixError);
+      parseContext.infoSink.info.summaryPrefix(EPrefixError);
       parseContext.infoSink.info << parseContext.numErrors << " compilation errors.  No code generated.\n\n";
       success = false;
 	  if (options & ETranslateOpIntermediate)
@@ -2244,15 +2328,309 @@ int C_DECL Hlsl2Glsl_Parse(
       symbolTable.pop();
 
    FinalizePreprocessor();
+
+   stats.peakPoolBytes = (unsigned)(pool.getPeakBytes() - poolBytes);
+   stats.allocationCount = (unsigned)(pool.getAllocationCount() - poolCalls);
+   stats.allocatedBytes = (unsigned)(pool.getAllocatedBytes() - poolRequested);
+
    //
    // Throw away all the temporary memory used by the compilation process.
    //
+   GlobalTypeContext = 0;
    GlobalPoolAllocator.pop();
 
    return success ? 1 : 0;
 }
 
 
+//
+// Run the preprocessor over a shader, reporting to the compiler's info log.
+//
+static bool PreprocessShader(
+	HlslCrossCompiler* compiler,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	unsigned options,
+	TPreprocessSink& sink)
+{
+   GlobalPoolAllocator.push();
+
+   // Nothing is parsed, so the context only collects preprocessor errors.
+   TIntermediate intermediate(compiler->infoSink);
+   TSymbolTable symbolTable;
+   TParseContext parseContext(symbolTable, intermediate, compiler->getLanguage(), ETargetGLSL_110, compiler->cgProfile, options, compiler->infoSink);
+   parseContext.includeOpen = compiler->includeOpen;
+   parseContext.includeClose = compiler->includeClose;
+   parseContext.includeUserData = compiler->includeUserData;
+   parseContext.defines = defines;
+   parseContext.defineCount = defineCount;
+
+   GlobalParseContext = &parseContext;
+
+   InitPreprocessor();
+
+   bool success = PaPreprocessString(shaderString, parseContext, sink) == 0;
+
+   if (!success)
+   {
+      parseContext.infoSink.info.summaryPrefix(EPrefixError);
+      parseContext.infoSink.info << parseContext.numErrors << " preprocessing errors.\n\n";
+   }
+
+   FinalizePreprocessor();
+   GlobalPoolAllocator.pop();
+
+   return success;
+}
+
+
+//
+// Preprocess a shader the way ParseShader() would, for it to parse the tokens
+// later.  Nothing is reported yet; the messages are kept with the tokens.
+//
+static void PreprocessForParse(
+	HlslCrossCompiler* compiler,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	unsigned options,
+	TPreprocessedShader& shader)
+{
+   GlobalPoolAllocator.push();
+
+   TIntermediate intermediate(compiler->infoSink);
+   TSymbolTable symbolTable;
+   TParseContext parseContext(symbolTable, intermediate, compiler->getLanguage(), ETargetGLSL_110, compiler->cgProfile, options, compiler->infoSink);
+   parseContext.includeOpen = compiler->includeOpen;
+   parseContext.includeClose = compiler->includeClose;
+   parseContext.includeUserData = compiler->includeUserData;
+   parseContext.defines = defines;
+   parseContext.defineCount = defineCount;
+
+   GlobalParseContext = &parseContext;
+
+   InitPreprocessor();
+
+   bool nonSquare = UsesNonSquareMatrices(shaderString, defines, defineCount);
+   PaPreprocessShader(shaderString, parseContext, nonSquareMatrixSource, !nonSquare, shader);
+
+   FinalizePreprocessor();
+   GlobalPoolAllocator.pop();
+}
+
+
+//
+// Collects preprocessed tokens as text and as indices into a table of spellings.
+//
+class TPreprocessedSource : public TPreprocessSink {
+public:
+	TPreprocessedSource(std::string& t, std::vector<int>& tok, std::vector<std::string>& sp)
+	: text(t), tokens(tok), spellings(sp), lastLine(-1), lastFile(0)
+	{
+	}
+
+	virtual void token(const char* str, int length, const TSourceLoc& line)
+	{
+		std::string spelling(str, length);
+
+		if (lastLine >= 0)
+			text += (line.line != lastLine || line.file != lastFile) ? '\n' : ' ';
+		text += spelling;
+		lastLine = line.line;
+		lastFile = line.file;
+
+		std::map<std::string, int>::iterator it = index.find(spelling);
+		if (it == index.end())
+		{
+			it = index.insert(std::make_pair(spelling, (int)spellings.size())).first;
+			spellings.push_back(spelling);
+		}
+		tokens.push_back(it->second);
+	}
+
+	void finish()
+	{
+		if (lastLine >= 0)
+			text += '\n';
+	}
+
+private:
+	std::string& text;
+	std::vector<int>& tokens;
+	std::vector<std::string>& spellings;
+	std::map<std::string, int> index;
+	int lastLine;
+	const char* lastFile;
+};
+
+
+int C_DECL Hlsl2Glsl_ParseWithDefines(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	const char *cgProfile,
+	ETargetVersion targetVersion,
+	unsigned options)
+{
+   if (!InitThread())
+      return 0;
+
+   if (handle == 0)
+      return 0;
+
+   HlslCrossCompiler* compiler = handle;
+   compiler->cgProfile = cgProfile != NULL? cgProfile : "";
+   compiler->resultKey.clear();
+   compiler->parseDeferred = false;
+   delete compiler->deferredShader;
+   compiler->deferredShader = 0;
+   memset(&compiler->stats, 0, sizeof(compiler->stats));
+   compiler->passStats.clear();
+
+   //
+   // With the result cache on, key the shader by its preprocessed tokens.  If
+   // a result translated from the same tokens and settings is cached, this
+   // parse has succeeded before, so it is put off until Hlsl2Glsl_Translate
+   // misses the cache and actually needs it.  Either way the tokens are kept
+   // for the parse, so the preprocessor only runs once.
+   //
+   if (shaderString && ResultCacheEnabled() && !(options & ETranslateOpIntermediate))
+   {
+      TPreprocessedShader* shader = new TPreprocessedShader();
+      double preprocessStart = OS_GetTime();
+      PreprocessForParse(compiler, shaderString, defines, defineCount, options, *shader);
+      double preprocessEnd = OS_GetTime();
+      compiler->stats.preprocessTime = preprocessEnd - preprocessStart;
+      if (TraceEnabled())
+      {
+         TTraceArg args[] = { { "sourceBytes", shader->sourceBytes } };
+         TraceEvent("Preprocess", preprocessStart, preprocessEnd, compiler->traceName, args, 1);
+      }
+      if (shader->heldErrors == 0 && !shader->compileError)
+      {
+         // Only the shader's own tokens; the prefix is keyed by the flag.
+         TTokenHasher hasher;
+         for (size_t i = shader->sourceToken; i < shader->tokens.size(); ++i)
+         {
+            const TPreprocessedShader::Token& token = shader->tokens[i];
+            TSourceLoc line = { token.file < 0 ? NULL : shader->files[token.file].c_str(), token.line };
+            hasher.token(shader->text.data() + token.offset, token.length, line);
+         }
+
+         std::string& key = compiler->resultKey;
+         hasher.appendDigest(key);
+         ResultCacheAppendUInt(key, compiler->getLanguage());
+         ResultCacheAppendUInt(key, targetVersion);
+         ResultCacheAppendUInt(key, options);
+         ResultCacheAppendUInt(key, shader->sourceToken > 0 ? 1 : 0);
+         key += compiler->cgProfile.c_str();
+         key += '\0';
+
+         if (ResultCacheHasParse(key))
+         {
+            compiler->infoSink.info.erase();
+            compiler->infoSink.debug.erase();
+            compiler->parseDeferred = true;
+            compiler->deferredShader = shader;
+            compiler->deferredVersion = targetVersion;
+            compiler->deferredOptions = options;
+            return 1;
+         }
+      }
+
+      int ret = ParseShader(compiler, shaderString, defines, defineCount, targetVersion, options, 0, false, shader);
+      delete shader;
+      return ret;
+   }
+
+   return ParseShader(compiler, shaderString, defines, defineCount, targetVersion, options, 0, false);
+}
+
+
+int C_DECL Hlsl2Glsl_Validate(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	const char *cgProfile,
+	ETargetVersion targetVersion,
+	int maxErrors)
+{
+   if (!InitThread())
+      return 0;
+
+   if (handle == 0)
+      return 0;
+
+   // Whatever the compiler held is gone, so a Translate after this fails
+   // rather than translating an earlier shader.
+   HlslCrossCompiler* compiler = handle;
+   compiler->reset();
+   compiler->cgProfile = cgProfile != NULL? cgProfile : "";
+
+   return ParseShader(compiler, shaderString, defines, defineCount, targetVersion, 0, maxErrors, true);
+}
+
+
+int C_DECL Hlsl2Glsl_Preprocess(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	unsigned options)
+{
+   if (!InitThread())
+      return 0;
+
+   if (handle == 0)
+      return 0;
+
+   HlslCrossCompiler* compiler = handle;
+   compiler->infoSink.info.erase();
+   compiler->infoSink.debug.erase();
+   compiler->preprocessedText.clear();
+   compiler->preprocessedTokens.clear();
+   compiler->preprocessedSpellings.clear();
+
+   if (!shaderString)
+      return 1;
+
+   TPreprocessedSource output(compiler->preprocessedText, compiler->preprocessedTokens, compiler->preprocessedSpellings);
+   bool success = PreprocessShader(compiler, shaderString, defines, defineCount, options, output);
+   output.finish();
+
+   return success ? 1 : 0;
+}
+
+
+const char* C_DECL Hlsl2Glsl_GetPreprocessedSource( const ShHandle handle )
+{
+	if (!handle)
+		return 0;
+	return handle->preprocessedText.c_str();
+}
+
+
+const int* C_DECL Hlsl2Glsl_GetPreprocessedTokens( const ShHandle handle, int* count )
+{
+	if (count)
+		*count = handle ? (int)handle->preprocessedTokens.size() : 0;
+	if (!handle || handle->preprocessedTokens.empty())
+		return 0;
+	return &handle->preprocessedTokens[0];
+}
+
+
+const char* C_DECL Hlsl2Glsl_GetPreprocessedTokenSpelling( const ShHandle handle, int token )
+{
+	if (!handle || token < 0 || token >= (int)handle->preprocessedSpellings.size())
+		return 0;
+	return handle->preprocessedSpellings[token].c_str();
+}
+
+
 int C_DECL Hlsl2Glsl_Translate(
 	const ShHandle handle,
 	const char* entry,
@@ -2263,14 +2641,64 @@ int C_DECL Hlsl2Glsl_Translate(
       return 0;
 
    HlslCrossCompiler* compiler = handle;
+   HlslLinker* linker = compiler->GetLinker();
    compiler->infoSink.info.erase();
+   compiler->stats.linkTime = 0;
+
+   std::string key;
+   if (!compiler->resultKey.empty() && ResultCacheEnabled())
+   {
+      key = compiler->resultKey;
+      key += entry ? entry : "";
+      key += '\0';
+      ResultCacheAppendUInt(key, targetVersion);
+      ResultCacheAppendUInt(key, options);
+      ResultCacheAppendUInt(key, linker->getUseUserVaryings() ? 1 : 0);
+      for (int i = 0; i < EAttrSemCount; ++i)
+      {
+         key += linker->getUserAttribName((EAttribSemantic)i);
+         key += '\0';
+      }
+
+      TCachedResult result;
+      if (ResultCacheFind(key, result))
+      {
+         linker->setResult(result.text, result.uniforms.empty() ? 0 : &result.uniforms[0], (int)result.uniforms.size());
+         return 1;
+      }
+   }
+
+   // Missed the cache, or it was turned off since the parse was put off.
+   if (compiler->parseDeferred)
+   {
+      TPreprocessedShader* shader = compiler->deferredShader;
+      compiler->parseDeferred = false;
+      compiler->deferredShader = 0;
+      int parsed = ParseShader(compiler, NULL, 0, 0, compiler->deferredVersion, compiler->deferredOptions, 0, false, shader);
+      delete shader;
+      if (!parsed)
+         return 0;
+      compiler->infoSink.info.erase();
+   }
+
 	if (!compiler->IsASTTransformed() || !compiler->IsGlslProduced())
 	{
 		compiler->infoSink.info.message(EPrefixError, "Shader does not have valid object code.");
 		return 0;
 	}
 
-	bool ret = compiler->GetLinker()->link(compiler, entry, compiler->cgProfile.c_str(), targetVersion, options);
+	double linkStart = OS_GetTime();
+	bool ret = linker->link(compiler, entry, compiler->cgProfile.c_str(), targetVersion, options);
+	double linkEnd = OS_GetTime();
+	compiler->stats.linkTime = linkEnd - linkStart;
+	if (TraceEnabled())
+	{
+		TTraceArg args[] = { { "functions", (int)compiler->functionList.size() }, { "uniforms", linker->getUniformCount() } };
+		TraceEvent("Link", linkStart, linkEnd, compiler->traceName, args, 2);
+	}
+
+	if (ret && !key.empty())
+		ResultCacheInsert(key, compiler->resultKey.size(), linker->getShaderText(), linker->getShaderTextLength(), linker->getUniformInfo(), linker->getUniformCount());
 
    return ret ? 1 : 0;
 }
@@ -2284,16 +2712,108 @@ const char* C_DECL Hlsl2Glsl_GetShader( const ShHandle handle )
 }
 
 
+int C_DECL Hlsl2Glsl_GetShaderLength( const ShHandle handle )
+{
+	if (!handle)
+		return 0;
+	return handle->GetLinker()->getShaderTextLength();
+}
+
+
+int C_DECL Hlsl2Glsl_CopyShader( const ShHandle handle, char* buffer, int bufferSize )
+{
+	if (!handle)
+		return 0;
+	const HlslLinker* linker = handle->GetLinker();
+	const char* text = linker->getShaderText();
+	int length = linker->getShaderTextLength();
+	if (buffer && bufferSize > 0)
+	{
+		int n = length < bufferSize ? length : bufferSize - 1;
+		memcpy (buffer, text, n);
+		buffer[n] = 0;
+	}
+	return length;
+}
+
+
+//
+// Moves the debug output to the end of the info log.  Done once rather than
+// on every call, so the log neither grows each time it is asked for nor
+// moves under the diagnostics pointing into it.
+//
+static const TInfoSinkBase& FoldInfoLog(HlslCrossCompiler* compiler)
+{
+   TInfoSink& infoSink = compiler->getInfoSink();
+   if (*infoSink.debug.c_str())
+   {
+      infoSink.info << infoSink.debug.c_str();
+      infoSink.debug.erase();
+   }
+   return infoSink.info;
+}
+
+
 const char* C_DECL Hlsl2Glsl_GetInfoLog( const ShHandle handle )
 {
    if (!InitThread())
       return 0;
    if (handle == 0)
       return 0;
-   HlslCrossCompiler* base = static_cast<HlslCrossCompiler*>(handle);
-   TInfoSink* infoSink = &(base->getInfoSink());
-   infoSink->info << infoSink->debug.c_str();
-   return infoSink->info.c_str();
+   return FoldInfoLog(handle).c_str();
+}
+
+
+int C_DECL Hlsl2Glsl_GetDiagnostics( const ShHandle handle, const ShDiagnostic** diagnostics, int* droppedCount )
+{
+   if (diagnostics)
+      *diagnostics = 0;
+   if (droppedCount)
+      *droppedCount = 0;
+   if (!InitThread())
+      return 0;
+   if (handle == 0 || diagnostics == 0)
+      return 0;
+
+   const TInfoSinkBase& info = FoldInfoLog(handle);
+   const std::vector<TDiagnostic>& found = info.getDiagnostics();
+   std::vector<ShDiagnostic>& result = handle->diagnostics;
+   result.resize(found.size());
+   for (size_t i = 0; i < found.size(); ++i)
+   {
+      ShDiagnostic& d = result[i];
+      switch (found[i].severity)
+      {
+      case EPrefixWarning: d.severity = EShSeverityWarning; break;
+      case EPrefixError:   d.severity = EShSeverityError; break;
+      default:             d.severity = EShSeverityInternalError; break;
+      }
+      d.file = found[i].file;
+      d.line = found[i].line;
+      // The text runs to the end of its line, less the spaces messages end in.
+      d.text = info.c_str() + found[i].start;
+      const char* end = strchr(d.text, '\n');
+      if (!end)
+         end = d.text + strlen(d.text);
+      while (end > d.text && end[-1] == ' ')
+         --end;
+      d.textLength = (int)(end - d.text);
+   }
+
+   if (!result.empty())
+      *diagnostics = &result[0];
+   if (droppedCount)
+      *droppedCount = info.getDropped();
+   return (int)result.size();
+}
+
+
+int C_DECL Hlsl2Glsl_SetDiagnosticLimit( ShHandle handle, int limit )
+{
+   if (handle == 0)
+      return 0;
+   handle->getInfoSink().info.setLimit(limit > 0 ? limit : 0);
+   return 1;
 }
 
 
@@ -2319,6 +2839,22 @@ const ShUniformInfo* C_DECL Hlsl2Glsl_GetUniformInfo( const ShHandle handle )
 }
 
 
+int C_DECL Hlsl2Glsl_GetCompileStats( const ShHandle handle, ShCompileStats* stats )
+{
+   if (!handle || !stats)
+      return 0;
+
+   // Asking for the length builds the text, which is the cleanup phase.
+   const HlslLinker* linker = handle->GetLinker();
+   *stats = handle->stats;
+   stats->outputLength = linker->getShaderTextLength();
+   stats->cleanupTime = linker->getShaderTextTime();
+   stats->passCount = (int)handle->passStats.size();
+   stats->passes = handle->passStats.empty() ? 0 : &handle->passStats[0];
+   return 1;
+}
+
+
 int C_DECL Hlsl2Glsl_SetUserAttributeNames ( ShHandle handle, 
                                              const EAttribSemantic *pSemanticEnums, 
                                              const char *pSemanticNames[], 
@@ -2340,6 +2876,225 @@ int C_DECL Hlsl2Glsl_SetUserAttributeNames ( ShHandle handle,
 }
 
 
+int C_DECL Hlsl2Glsl_SetIncludeHandler ( ShHandle handle,
+                                         IncludeOpenFunction openFunc,
+                                         IncludeCloseFunction closeFunc,
+                                         void* userData )
+{
+	if (!handle)
+		return 0;
+   handle->includeOpen = openFunc;
+   handle->includeClose = closeFunc;
+   handle->includeUserData = userData;
+   return 1;
+}
+
+
+int C_DECL Hlsl2Glsl_SetTraceFile ( const char* path )
+{
+   if (!path)
+   {
+      TraceStop();
+      return 1;
+   }
+   return TraceStart(path) ? 1 : 0;
+}
+
+
+int C_DECL Hlsl2Glsl_SetShaderName ( ShHandle handle, const char* name )
+{
+   if (!handle)
+      return 0;
+   handle->traceName = name ? name : "";
+   return 1;
+}
+
+
+void C_DECL Hlsl2Glsl_SetResultCacheSize ( unsigned maxBytes )
+{
+   SetResultCacheLimit(maxBytes);
+}
+
+
+int C_DECL Hlsl2Glsl_SetResultCacheDirectory ( const char* path, unsigned maxBytes, bool readOnly )
+{
+   return SetResultCacheDirectory(path, maxBytes, readOnly) ? 1 : 0;
+}
+
+
+static void CompileJob(int index, void* data)
+{
+   ShCompileJob& job = ((ShCompileJob*)data)[index];
+
+   job.result = 0;
+   job.compiler = Hlsl2Glsl_ConstructCompiler(job.language);
+   if (!job.compiler)
+      return;
+
+   Hlsl2Glsl_SetIncludeHandler(job.compiler, job.includeOpen, job.includeClose, job.includeUserData);
+   Hlsl2Glsl_SetShaderName(job.compiler, job.name);
+   if (!Hlsl2Glsl_ParseWithDefines(job.compiler, job.source, job.defines, job.defineCount, job.cgProfile, job.targetVersion, job.options))
+      return;
+   job.result = Hlsl2Glsl_Translate(job.compiler, job.entry, job.targetVersion, job.options);
+}
+
+
+int C_DECL Hlsl2Glsl_CompileBatch ( ShCompileJob* jobs, int count, int threads )
+{
+   if (!InitThread())
+      return 0;
+
+   if (count < 0 || (count > 0 && !jobs))
+      return 0;
+
+   RunWorkStealing(count, threads, CompileJob, jobs);
+
+   for (int i = 0; i < count; ++i)
+   {
+      if (!jobs[i].result)
+         return 0;
+   }
+   return 1;
+}
+
+
+struct TAsyncJob
+{
+   ShHandle handle;
+   bool translate;
+   std::string text;                     // source to parse, or entry point
+   bool hasEntry;
+   std::string cgProfile;
+   std::vector<std::string> defines;     // name and value pairs
+   ETargetVersion targetVersion;
+   unsigned options;
+   AsyncCallbackFunction callback;
+   void* userData;
+};
+
+
+static void AsyncJob(void* data, bool cancelled)
+{
+   TAsyncJob* job = (TAsyncJob*)data;
+   EShAsyncResult result = EShAsyncCancelled;
+
+   if (!cancelled)
+   {
+      int ok;
+      if (job->translate)
+      {
+         // Translating after a failed parse would only replace its errors.
+         ok = !job->handle->asyncParseFailed &&
+              Hlsl2Glsl_Translate(job->handle, job->hasEntry ? job->text.c_str() : 0, job->targetVersion, job->options);
+      }
+      else
+      {
+         std::vector<ShMacroDefine> defines(job->defines.size() / 2);
+         for (size_t i = 0; i < defines.size(); ++i)
+         {
+            defines[i].name = job->defines[2*i].c_str();
+            defines[i].value = job->defines[2*i+1].c_str();
+         }
+         // A preview queues a parse each time the source is edited, on the
+         // compiler that parsed the last version.
+         job->handle->reset();
+         ok = Hlsl2Glsl_ParseWithDefines(job->handle, job->text.c_str(), defines.empty() ? 0 : &defines[0], (int)defines.size(),
+                                         job->cgProfile.c_str(), job->targetVersion, job->options);
+         job->handle->asyncParseFailed = !ok;
+      }
+      result = ok ? EShAsyncSucceeded : EShAsyncFailed;
+   }
+
+   if (job->callback)
+      job->callback(job->handle, result, job->userData);
+   delete job;
+}
+
+
+static int QueueAsyncJob(TAsyncJob* job)
+{
+   if (!QueueJob(job->handle, AsyncJob, job))
+   {
+      delete job;
+      return 0;
+   }
+   return 1;
+}
+
+
+int C_DECL Hlsl2Glsl_ParseAsync(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	const char* cgProfile,
+	ETargetVersion targetVersion,
+	unsigned options,
+	AsyncCallbackFunction callback,
+	void* userData)
+{
+   if (handle == 0 || shaderString == 0 || defineCount < 0 || (defineCount > 0 && !defines))
+      return 0;
+
+   TAsyncJob* job = new TAsyncJob;
+   job->handle = handle;
+   job->translate = false;
+   job->text = shaderString;
+   job->hasEntry = false;
+   job->cgProfile = cgProfile ? cgProfile : "";
+   for (int i = 0; i < defineCount; ++i)
+   {
+      job->defines.push_back(defines[i].name ? defines[i].name : "");
+      job->defines.push_back(defines[i].value ? defines[i].value : "");
+   }
+   job->targetVersion = targetVersion;
+   job->options = options;
+   job->callback = callback;
+   job->userData = userData;
+   return QueueAsyncJob(job);
+}
+
+
+int C_DECL Hlsl2Glsl_TranslateAsync(
+	const ShHandle handle,
+	const char* entry,
+	ETargetVersion targetVersion,
+	unsigned options,
+	AsyncCallbackFunction callback,
+	void* userData)
+{
+   if (handle == 0)
+      return 0;
+
+   TAsyncJob* job = new TAsyncJob;
+   job->handle = handle;
+   job->translate = true;
+   job->text = entry ? entry : "";
+   job->hasEntry = entry != 0;
+   job->targetVersion = targetVersion;
+   job->options = options;
+   job->callback = callback;
+   job->userData = userData;
+   return QueueAsyncJob(job);
+}
+
+
+int C_DECL Hlsl2Glsl_CancelAsync( ShHandle handle )
+{
+   if (handle == 0)
+      return 0;
+   return CancelJobs(handle);
+}
+
+
+void C_DECL Hlsl2Glsl_WaitAsync( ShHandle handle )
+{
+   if (handle == 0)
+      return;
+   WaitForJobs(handle);
+}
+
+
 int C_DECL Hlsl2Glsl_UseUserVaryings ( ShHandle handle, bool bUseUserVaryings )
 {
 	if (!handle)
@@ -5,27 +5,84 @@
 #include "../Include/InfoSink.h"
 #include <string.h>
 
+//
+// Records a diagnostic about to be written with the given severity.  Returns
+// false if it is past the limit, in which case its location is taken back
+// out and the rest of its line is left out too.
+//
+bool TInfoSinkBase::beginDiagnostic(TPrefixType severity)
+{
+   bool located = hasPending;
+   hasPending = false;
+   dropping = false;
+
+   if (limit > 0 && (int)diagnostics.size() >= limit)
+   {
+      if (located)
+         sink.erase(pendingStart);
+      ++dropped;
+      dropping = true;
+      return false;
+   }
+
+   TDiagnostic diagnostic;
+   diagnostic.severity = severity;
+   diagnostic.file = 0;
+   diagnostic.line = located ? pendingLine : 0;
+   if (located && pendingFile)
+      diagnostic.file = files.insert(pendingFile).first->c_str();
+   diagnostic.start = sink.size();     // moved past the prefix once it is written
+   diagnostics.push_back(diagnostic);
+   return true;
+}
+
+//
+// While a diagnostic past the limit is being left out, text up to the end
+// of its line is skipped.  Returns how much of s to skip.
+//
+static size_t SkipDropped(bool& dropping, const char* s, size_t length)
+{
+   if (!dropping)
+      return 0;
+   const char* end = (const char*)memchr(s, '\n', length);
+   if (!end)
+      return length;
+   dropping = false;
+   return end - s + 1;
+}
+
 void TInfoSinkBase::append(const char *s)           
 {
-   checkMem(strlen(s)); 
-   sink.append(s); 
+   size_t length = strlen(s);
+   size_t skip = SkipDropped(dropping, s, length);
+   checkMem(length - skip); 
+   sink.append(s + skip); 
 }
 
 void TInfoSinkBase::append(int count, char c)       
 {
+   if (dropping)
+   {
+      if (c != '\n')
+         return;
+      dropping = false;
+      --count;
+   }
    checkMem(count);         
    sink.append(count, c); 
 }
 
 void TInfoSinkBase::append(const TPersistString& t) 
 {
-   checkMem(t.size());  
-   sink.append(t); 
+   size_t skip = SkipDropped(dropping, t.c_str(), t.size());
+   checkMem(t.size() - skip);  
+   sink.append(t, skip, TPersistString::npos); 
 }
 
 void TInfoSinkBase::append(const TString& t)
 {
-   checkMem(t.size());  
-   sink.append(t.c_str()); 
+   size_t skip = SkipDropped(dropping, t.c_str(), t.size());
+   checkMem(t.size() - skip);  
+   sink.append(t.c_str() + skip); 
 }
 
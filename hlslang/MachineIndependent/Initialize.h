@@ -30,6 +30,7 @@ private:
 void IdentifyBuiltIns(EShLanguage, TSymbolTable&);
 extern "C" int InitPreprocessor(void);
 extern "C" int FinalizePreprocessor(void);
+extern "C" void FreeIncludeCache(void);
 
 #endif // _INITIALIZE_INCLUDED_
 
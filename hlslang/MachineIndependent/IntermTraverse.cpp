@@ -8,7 +8,6 @@
 //
 // Traverse the intermediate representation tree, and
 // call a node type specific function for each node.
-// Done recursively through the member function Traverse().
 // Node types can be skipped if their function to call is 0,
 // but their subtree will still be traversed.
 // Nodes with children can have their whole subtree skipped
@@ -18,182 +17,286 @@
 // preVisit, postVisit control what order
 // nodes are visited in.
 //
-
-//
-// Traversal functions for terminals are straighforward....
+// The walk keeps its own stack of the nodes it is inside instead of
+// recursing, so how deep a tree goes costs no native stack, and a long
+// a+b+c+... chain is as cheap per node as a flat one.  A node's children are
+// read from it one at a time, just before each is visited, so a visit
+// function may still replace the children that come after the current one.
+// Visit functions may start a traversal of their own from inside one.
 //
-void TIntermSymbol::traverse(TIntermTraverser* it)
-{
-   if (it->visitSymbol)
-      it->visitSymbol(this, it);
-}
 
-void TIntermDeclaration::traverse(TIntermTraverser* it)
-{	
-	if (it->preVisit && it->visitDeclaration && !it->visitDeclaration(true, this, it))
-		return;
-	
-	if (_declaration)
-		_declaration->traverse(it);
-	
-	if (it->postVisit && it->visitDeclaration)
-		it->visitDeclaration(false, this, it);
-}
-
-void TIntermConstant::traverse(TIntermTraverser* it)
-{
-   if (it->visitConstant)
-      it->visitConstant(this, it);
-}
 
 //
-// Traverse a binary node.
+// Calls the node's visit function ahead of its children, and returns
+// whether its children should be visited.  Terminals are visited here and
+// have no children.
 //
-void TIntermBinary::traverse(TIntermTraverser* it)
+static inline bool PreVisit(TIntermNode* node, TIntermTraverser* it)
 {
-   bool visit = true;
-
-   //
-   // visit the node before children if pre-visiting.
-   //
-   if (it->preVisit && it->visitBinary)
-      visit = it->visitBinary(true, this, it);
-
-   //
-   // Visit the children, in the right order.
-   //
-   if (visit)
+   switch (node->getKind())
    {
-      ++it->depth;
-      if (left)
-         left->traverse(it);
-      if (right)
-         right->traverse(it);
-      --it->depth;
+   case EIntermSymbol:
+      if (it->visitSymbol)
+         it->visitSymbol(static_cast<TIntermSymbol*>(node), it);
+      return false;
+   case EIntermConstant:
+      if (it->visitConstant)
+         it->visitConstant(static_cast<TIntermConstant*>(node), it);
+      return false;
+   default:
+      break;
    }
 
-   //
-   // Visit the node after the children, if requested and the traversal
-   // hasn't been cancelled yet.
-   //
-   if (visit && it->postVisit && it->visitBinary)
-      it->visitBinary(false, this, it);
+   if (!it->preVisit)
+      return true;
+
+   switch (node->getKind())
+   {
+   case EIntermDeclaration:
+      return !it->visitDeclaration || it->visitDeclaration(true, static_cast<TIntermDeclaration*>(node), it);
+   case EIntermSelection:
+      return !it->visitSelection || it->visitSelection(true, static_cast<TIntermSelection*>(node), it);
+   case EIntermBinary:
+      return !it->visitBinary || it->visitBinary(true, static_cast<TIntermBinary*>(node), it);
+   case EIntermUnary:
+      return !it->visitUnary || it->visitUnary(true, static_cast<TIntermUnary*>(node), it);
+   case EIntermAggregate:
+      return !it->visitAggregate || it->visitAggregate(true, static_cast<TIntermAggregate*>(node), it);
+   case EIntermLoop:
+      return !it->visitLoop || it->visitLoop(true, static_cast<TIntermLoop*>(node), it);
+   case EIntermBranch:
+      return !it->visitBranch || it->visitBranch(true, static_cast<TIntermBranch*>(node), it);
+   default:
+      return false;
+   }
 }
 
 //
-// Traverse a unary node.  Same comments in binary node apply here.
+// Calls the node's visit function after its children, if requested.
 //
-void TIntermUnary::traverse(TIntermTraverser* it)
+static void PostVisit(TIntermNode* node, TIntermTraverser* it)
 {
-   bool visit = true;
-
-   if (it->preVisit && it->visitUnary)
-      visit = it->visitUnary(true, this, it);
+   if (!it->postVisit)
+      return;
 
-   if (visit)
+   switch (node->getKind())
    {
-      ++it->depth;
-      operand->traverse(it);
-      --it->depth;
+   case EIntermDeclaration:
+      if (it->visitDeclaration)
+         it->visitDeclaration(false, static_cast<TIntermDeclaration*>(node), it);
+      break;
+   case EIntermSelection:
+      if (it->visitSelection)
+         it->visitSelection(false, static_cast<TIntermSelection*>(node), it);
+      break;
+   case EIntermBinary:
+      if (it->visitBinary)
+         it->visitBinary(false, static_cast<TIntermBinary*>(node), it);
+      break;
+   case EIntermUnary:
+      if (it->visitUnary)
+         it->visitUnary(false, static_cast<TIntermUnary*>(node), it);
+      break;
+   case EIntermAggregate:
+      if (it->visitAggregate)
+         it->visitAggregate(false, static_cast<TIntermAggregate*>(node), it);
+      break;
+   case EIntermLoop:
+      if (it->visitLoop)
+         it->visitLoop(false, static_cast<TIntermLoop*>(node), it);
+      break;
+   case EIntermBranch:
+      if (it->visitBranch)
+         it->visitBranch(false, static_cast<TIntermBranch*>(node), it);
+      break;
+   default:
+      break;
    }
-
-   if (visit && it->postVisit && it->visitUnary)
-      it->visitUnary(false, this, it);
 }
 
 //
-// Traverse an aggregate node.  Same comments in binary node apply here.
+// Returns the first child of node at or after position index, in the order
+// the children are visited, and moves index past it.  Returns 0 once there
+// are no more.
 //
-void TIntermAggregate::traverse(TIntermTraverser* it)
+static TIntermNode* NextChild(TIntermNode* node, int& index)
 {
-   bool visit = true;
-
-   if (it->preVisit && it->visitAggregate)
-      visit = it->visitAggregate(true, this, it);
-
-   if (visit)
+   for (;;)
    {
-      ++it->depth;
-
-      TIntermSequence::iterator sit;
-      for (sit = sequence.begin(); sit != sequence.end(); ++sit)
-         (*sit)->traverse(it);
-
-      --it->depth;
+      TIntermNode* child;
+      switch (node->getKind())
+      {
+      case EIntermDeclaration:
+         if (index > 0)
+            return 0;
+         child = static_cast<TIntermDeclaration*>(node)->getDeclaration();
+         break;
+      case EIntermSelection:
+         {
+            TIntermSelection* selection = static_cast<TIntermSelection*>(node);
+            if (index == 0)
+               child = selection->getCondition();
+            else if (index == 1)
+               child = selection->getTrueBlock();
+            else if (index == 2)
+               child = selection->getFalseBlock();
+            else
+               return 0;
+         }
+         break;
+      case EIntermBinary:
+         if (index == 0)
+            child = static_cast<TIntermBinary*>(node)->getLeft();
+         else if (index == 1)
+            child = static_cast<TIntermBinary*>(node)->getRight();
+         else
+            return 0;
+         break;
+      case EIntermUnary:
+         if (index > 0)
+            return 0;
+         child = static_cast<TIntermUnary*>(node)->getOperand();
+         break;
+      case EIntermAggregate:
+         {
+            TIntermSequence& sequence = static_cast<TIntermAggregate*>(node)->getSequence();
+            if (index >= (int)sequence.size())
+               return 0;
+            child = sequence[index];
+         }
+         break;
+      case EIntermLoop:
+         {
+            // The condition comes first even for do-while loops, as it always has.
+            TIntermLoop* loop = static_cast<TIntermLoop*>(node);
+            if (index == 0)
+               child = loop->getCondition();
+            else if (index == 1)
+               child = loop->getBody();
+            else if (index == 2)
+               child = loop->getExpression();
+            else
+               return 0;
+         }
+         break;
+      case EIntermBranch:
+         if (index > 0)
+            return 0;
+         child = static_cast<TIntermBranch*>(node)->getExpression();
+         break;
+      default:
+         return 0;
+      }
+      ++index;
+      if (child)
+         return child;
    }
-
-   if (visit && it->postVisit && it->visitAggregate)
-      it->visitAggregate(false, this, it);
 }
 
+
 //
-// Traverse a selection node.  Same comments in binary node apply here.
+// A node the walk is inside, and the position of the next child to visit.
 //
-void TIntermSelection::traverse(TIntermTraverser* it)
-{
-   bool visit = true;
-
-   if (it->preVisit && it->visitSelection)
-      visit = it->visitSelection(true, this, it);
+struct TTraverseFrame {
+   TIntermNode* node;
+   int child;
+};
 
-   if (visit)
+//
+// The walk's stack.  The first few frames live in the object itself; deeper
+// ones move to the heap, doubling as they go.  The GLSL output calls
+// traverse() again from inside its visits, once per level of an expression,
+// so the part kept on the native stack has to stay small.
+//
+class TTraverseStack {
+public:
+   TTraverseStack() : frames(local), count(0), capacity(LocalFrames) { }
+   ~TTraverseStack()
    {
-      ++it->depth;
-      condition->traverse(it);
-      if (trueBlock)
-         trueBlock->traverse(it);
-      if (falseBlock)
-         falseBlock->traverse(it);
-      --it->depth;
+      if (frames != local)
+         delete [] frames;
    }
 
-   if (visit && it->postVisit && it->visitSelection)
-      it->visitSelection(false, this, it);
-}
-
-// Traverse a loop node.  Same comments in binary node apply here.
-void TIntermLoop::traverse(TIntermTraverser* it)
-{
-   bool visit = true;
+   bool empty() const { return count == 0; }
+   TTraverseFrame& top() { return frames[count - 1]; }
+   void pop() { --count; }
+   void push(TIntermNode* node)
+   {
+      if (count == capacity)
+         grow();
+      frames[count].node = node;
+      frames[count].child = 0;
+      ++count;
+   }
 
-   if (it->preVisit && it->visitLoop)
-      visit = it->visitLoop(true, this, it);
+private:
+   TTraverseStack(const TTraverseStack&);
+   TTraverseStack& operator=(const TTraverseStack&);
 
-   if (visit)
+   void grow()
    {
-      ++it->depth;
-      if (cond)
-         cond->traverse(it);
-      if (body)
-         body->traverse(it);
-      if (expr)
-         expr->traverse(it);
-      --it->depth;
+      TTraverseFrame* larger = new TTraverseFrame[capacity * 2];
+      for (int i = 0; i < count; ++i)
+         larger[i] = frames[i];
+      if (frames != local)
+         delete [] frames;
+      frames = larger;
+      capacity *= 2;
    }
 
-   if (visit && it->postVisit && it->visitLoop)
-      it->visitLoop(false, this, it);
-}
+   enum { LocalFrames = 4 };
+   TTraverseFrame local[LocalFrames];
+   TTraverseFrame* frames;
+   int count;
+   int capacity;
+};
 
-//
-// Traverse a branch node.  Same comments in binary node apply here.
-//
-void TIntermBranch::traverse(TIntermTraverser* it)
-{
-   bool visit = true;
 
-   if (it->preVisit && it->visitBranch)
-      visit = it->visitBranch(true, this, it);
+// Below the node, whose pre-visit has let the walk go on.  Kept out of
+// traverse(), which the GLSL output calls from inside its pre-visits, so
+// that those nested calls do not each hold a stack on the native one.
+#if defined(_MSC_VER)
+#define TRAVERSE_NOINLINE __declspec(noinline)
+#else
+#define TRAVERSE_NOINLINE __attribute__((noinline))
+#endif
 
-   if (visit && expression)
-   {
+static TRAVERSE_NOINLINE void TraverseChildren(TIntermNode* root, TIntermTraverser* it)
+{
+   // Declarations do not count towards the depth.
+   TTraverseStack stack;
+   stack.push(root);
+   if (root->getKind() != EIntermDeclaration)
       ++it->depth;
-      expression->traverse(it);
-      --it->depth;
-   }
 
-   if (visit && it->postVisit && it->visitBranch)
-      it->visitBranch(false, this, it);
+   while (!stack.empty())
+   {
+      TTraverseFrame& frame = stack.top();
+      TIntermNode* child = NextChild(frame.node, frame.child);
+      if (child)
+      {
+         if (PreVisit(child, it))
+         {
+            stack.push(child);
+            if (child->getKind() != EIntermDeclaration)
+               ++it->depth;
+         }
+         continue;
+      }
+
+      // Every child has been visited.  The frame goes before the visit
+      // function runs, since that may release the node.
+      TIntermNode* node = frame.node;
+      stack.pop();
+      if (node->getKind() != EIntermDeclaration)
+         --it->depth;
+      PostVisit(node, it);
+   }
 }
 
 
+void TIntermNode::traverse(TIntermTraverser* it)
+{
+   if (PreVisit(this, it))
+      TraverseChildren(this, it);
+}
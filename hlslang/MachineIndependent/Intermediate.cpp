@@ -1010,7 +1010,7 @@ TIntermNode* TIntermediate::addLoop(TLoopType type, TIntermTyped* cond, TIntermT
 {
    if (expr != NULL)//move expr to the end of loop body
    {
-	   if (body->getAsAggregate())//statement list
+	   if (body && body->getAsAggregate())//statement list
 	   {
 		   if (expr->getAsAggregate())
 		   {
@@ -1026,7 +1026,8 @@ TIntermNode* TIntermediate::addLoop(TLoopType type, TIntermTyped* cond, TIntermT
 	   {
 		   //make new aggregate node
 		   TIntermAggregate *aggre = setAggregateOperator(NULL, EOpSequence, line);
-		   aggre->getSequence().push_back(body);
+		   if (body)//an empty body has no statement
+			   aggre->getSequence().push_back(body);
 		  
 		   if (expr->getAsAggregate())
 		   {
@@ -1079,6 +1080,27 @@ void TIntermediate::remove(TIntermNode* root)
 // Member functions of the nodes used for building the tree.
 
 
+//
+// Called by Release when the last reference goes.  The destructors are not
+// virtual, so this picks the one for the node's kind.
+//
+void TIntermNode::destroy()
+{
+   switch (kind)
+   {
+   case EIntermSymbol:      delete static_cast<TIntermSymbol*>(this); break;
+   case EIntermConstant:    delete static_cast<TIntermConstant*>(this); break;
+   case EIntermDeclaration: delete static_cast<TIntermDeclaration*>(this); break;
+   case EIntermSelection:   delete static_cast<TIntermSelection*>(this); break;
+   case EIntermBinary:      delete static_cast<TIntermBinary*>(this); break;
+   case EIntermUnary:       delete static_cast<TIntermUnary*>(this); break;
+   case EIntermAggregate:   delete static_cast<TIntermAggregate*>(this); break;
+   case EIntermLoop:        delete static_cast<TIntermLoop*>(this); break;
+   case EIntermBranch:      delete static_cast<TIntermBranch*>(this); break;
+   }
+}
+
+
 //
 // Say whether or not an operation node changes the value of a variable.
 //
@@ -1243,8 +1265,8 @@ bool TIntermBinary::promote(TInfoSink& infoSink)
          // Set array information.
          //
       case EOpAssign:
-         getType().setArraySize(left->getType().getArraySize());
-         getType().setArrayInformationType(left->getType().getArrayInformationType());
+         getTypePointer()->setArraySize(left->getType().getArraySize());
+         getTypePointer()->setArrayInformationType(left->getType().getArrayInformationType());
          break;
 
       default:
@@ -318,6 +318,11 @@ void TParseContext::recover()
 void C_DECL TParseContext::error(TSourceLoc nLine, const char *szReason, const char *szToken, 
                                  const char *szExtraInfoFormat, ...)
 {
+   // Past the limit the parse is being cut short, and what it runs into on
+   // the way out is not worth reporting.
+   if (errorLimitReached())
+      return;
+
    char szExtraInfo[400];
    va_list marker;
 
@@ -1961,6 +1966,7 @@ bool InitializeGlobalParseContext()
    }
 
    lpThreadData->lpGlobalParseContext = 0;
+   lpThreadData->lpGlobalTypeContext = 0;
    OS_SetTLSValue(GlobalParseContextIndex, lpThreadData);
 
    return true;
@@ -1977,6 +1983,13 @@ TParseContextPointer& GetGlobalParseContext()
    return lpParseContext->lpGlobalParseContext;
 }
 
+TTypeContext*& GetGlobalTypeContext()
+{
+   TThreadParseContext *lpParseContext = static_cast<TThreadParseContext *>(OS_GetTLSValue(GlobalParseContextIndex));
+
+   return lpParseContext->lpGlobalTypeContext;
+}
+
 bool FreeParseContext()
 {
    if (GlobalParseContextIndex == OS_INVALID_TLS_INDEX)
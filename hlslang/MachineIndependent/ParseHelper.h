@@ -26,12 +26,21 @@ struct TParseContext
 	, treeRoot(0)
 	, recoveredFromError(false)
 	, numErrors(0)
+	, maxErrors(0)
 	, lexAfterType(false)
 	, loopNestingLevel(0)
 	, inTypeParen(false)
+	, includeOpen(0)
+	, includeClose(0)
+	, includeUserData(0)
+	, defines(0)
+	, defineCount(0)
+	, preprocessStart(0)
+	, preprocessTime(0)
 	{
 	}
 	
+	bool errorLimitReached() const { return maxErrors > 0 && numErrors >= maxErrors; }
 	void C_DECL error(TSourceLoc, const char *szReason, const char *szToken, 
 					 const char *szExtraInfoFormat, ...);
 	bool reservedErrorCheck(const TSourceLoc& line, const TString& identifier);
@@ -96,6 +105,7 @@ public:
 	TIntermNode* treeRoot;       // root of parse tree being created
 	bool recoveredFromError;     // true if a parse error has occurred, but we continue to parse
 	int numErrors;
+	int maxErrors;               // errors after which the parse stops, and further ones are dropped; 0 for no limit
 	bool lexAfterType;           // true if we've recognized a type, so can only be looking for an identifier
 	int loopNestingLevel;        // 0 if outside all loops
 	bool inTypeParen;            // true if in parentheses, looking only for an identifier
@@ -103,15 +113,70 @@ public:
 	bool functionReturnsValue;   // true if a non-void function has a return
 	TString HashErrMsg; 
 	bool AfterEOF;
+	IncludeOpenFunction includeOpen;    // resolves #include; null if there is no handler
+	IncludeCloseFunction includeClose;
+	void* includeUserData;
+	const ShMacroDefine* defines;       // predefined by the caller, after any prefix PaPreprocessShader scans
+	int defineCount;
+	double preprocessStart;      // OS_GetTime when PaPreprocessShader started
+	double preprocessTime;       // seconds PaPreprocessShader took
 
 	std::map<TString, TIntermAggregate*> inlineFuncList;
 };
 
-int PaParseString(char* source, TParseContext&);
-void PaReservedWord();
+// Receives the output of PaPreprocessString one token at a time.
+class TPreprocessSink {
+public:
+	virtual ~TPreprocessSink() {}
+	virtual void token(const char* text, int length, const TSourceLoc& line) = 0;
+};
+
+// The preprocessor's output for a shader, which PaParseTokens() parses.  It
+// holds no pointers into the compile's pool, so it can be kept and parsed by
+// a later compile.
+struct TPreprocessedShader
+{
+	TPreprocessedShader()
+	: heldErrors(0), endFile(-1), endLine(1), sourceToken(0), sourceBytes(0)
+	, compileError(false), tokensBeforeEOF(false)
+	{ }
+
+	struct Token {
+		size_t offset;          // of the text in text
+		int length;
+		int file;               // index into files; -1 for the main shader
+		int line;
+		bool floatValid;        // a float constant, already converted
+		float floatValue;
+	};
+	struct Message {
+		size_t token;           // reported before this token was produced
+		int kind;
+		int file;
+		int line;
+		std::string text;
+	};
+
+	std::string text;
+	std::vector<Token> tokens;
+	std::vector<Message> messages;
+	std::vector<std::string> files;     // #included file names
+	int heldErrors;             // error messages among messages
+	int endFile, endLine;       // location once the preprocessor is done
+	size_t sourceToken;         // first token after any prefix
+	int sourceBytes;
+	bool compileError;
+	bool tokensBeforeEOF;
+};
+
+void PaPreprocessShader(const char* source, TParseContext&, const char* prefix, bool prefixOptional, TPreprocessedShader&);
+int PaParseTokens(const TPreprocessedShader&, TParseContext&);
+int PaParseString(const char* source, TParseContext&, const char* prefix = 0, bool prefixOptional = false);
+int PaPreprocessString(const char* source, TParseContext&, TPreprocessSink&);
+void PaReservedWord(const char* text);
 int PaIdentOrType(TString& id, TParseContext&, TSymbol*&);
-int PaParseComment(TSourceLoc &lineno, TParseContext&);
-void setInitialState();
+int PaParseComment(TSourceLoc &lineno, TParseContext&, void* scanner);
+float PaFloatConstant(const char* text);
 
 typedef TParseContext* TParseContextPointer;
 extern TParseContextPointer& GetGlobalParseContext();
@@ -120,6 +185,7 @@ extern TParseContextPointer& GetGlobalParseContext();
 typedef struct TThreadParseContextRec
 {
    TParseContext *lpGlobalParseContext;
+   TTypeContext *lpGlobalTypeContext;
 } TThreadParseContext;
 
 #endif // _PARSER_HELPER_INCLUDED_
@@ -0,0 +1,308 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#include "PassManager.h"
+#include "Trace.h"
+#include "osinclude.h"
+
+#include <algorithm>
+
+
+//
+// Counts the nodes of the tree and notes which inputs of passes it has.
+//
+class TInputFinder : public TIntermTraverser {
+public:
+	TInputFinder() : count(0), inputs(0)
+	{
+		visitSymbol = FindInSymbol;
+		visitConstant = CountConstant;
+		visitBinary = FindInNode<TIntermBinary>;
+		visitUnary = FindInNode<TIntermUnary>;
+		visitSelection = FindInNode<TIntermSelection>;
+		visitAggregate = FindInNode<TIntermAggregate>;
+		visitDeclaration = FindInNode<TIntermDeclaration>;
+		visitLoop = FindInNode<TIntermLoop>;
+		visitBranch = FindInNode<TIntermBranch>;
+	}
+
+	int count;
+	unsigned inputs;
+
+private:
+	void find(TIntermNode* node)
+	{
+		++count;
+		TIntermTyped* typed = node->getAsTyped();
+		if (typed && IsSampler(typed->getBasicType()))
+			inputs |= EPassInputSamplers;
+	}
+
+	static void FindInSymbol(TIntermSymbol* node, TIntermTraverser* it)
+	{
+		TInputFinder* fit = static_cast<TInputFinder*>(it);
+		fit->find(node);
+		if (node->getQualifier() == EvqMutableUniform)
+			fit->inputs |= EPassInputMutableUniforms;
+	}
+	static void CountConstant(TIntermConstant*, TIntermTraverser* it)
+	{
+		++static_cast<TInputFinder*>(it)->count;
+	}
+	template<class T> static bool FindInNode(bool, T* node, TIntermTraverser* it)
+	{
+		static_cast<TInputFinder*>(it)->find(node);
+		return true;
+	}
+};
+
+
+//
+// A traverser that stands in for several in one walk.  Each node goes to
+// each of them, with the depth they would have seen walking on their own,
+// except those skipping a subtree the node is in.  Children are visited
+// while any of them wants them.
+//
+struct TFusedMember {
+	TIntermTraverser* traverser;
+	TIntermNode* skipping;		// root of the subtree it is skipping, if any
+	int nodeCount;
+};
+
+class TFusedTraverser : public TIntermTraverser {
+public:
+	TFusedTraverser()
+	{
+		visitSymbol = VisitLeaf<TIntermSymbol, &TIntermTraverser::visitSymbol>;
+		visitConstant = VisitLeaf<TIntermConstant, &TIntermTraverser::visitConstant>;
+		visitBinary = Visit<TIntermBinary, &TIntermTraverser::visitBinary>;
+		visitUnary = Visit<TIntermUnary, &TIntermTraverser::visitUnary>;
+		visitSelection = Visit<TIntermSelection, &TIntermTraverser::visitSelection>;
+		visitAggregate = Visit<TIntermAggregate, &TIntermTraverser::visitAggregate>;
+		visitDeclaration = Visit<TIntermDeclaration, &TIntermTraverser::visitDeclaration>;
+		visitLoop = Visit<TIntermLoop, &TIntermTraverser::visitLoop>;
+		visitBranch = Visit<TIntermBranch, &TIntermTraverser::visitBranch>;
+		preVisit = true;
+		postVisit = true;
+	}
+
+	void add(TIntermTraverser* traverser)
+	{
+		TFusedMember member = { traverser, 0, 0 };
+		members.push_back(member);
+	}
+
+	std::vector<TFusedMember> members;
+
+private:
+	template<class T, void (*TIntermTraverser::*Function)(T*, TIntermTraverser*)>
+	static void VisitLeaf(T* node, TIntermTraverser* it)
+	{
+		std::vector<TFusedMember>& members = static_cast<TFusedTraverser*>(it)->members;
+		for (size_t i = 0; i < members.size(); ++i)
+		{
+			TFusedMember& member = members[i];
+			if (member.skipping)
+				continue;
+			++member.nodeCount;
+			TIntermTraverser* traverser = member.traverser;
+			if (traverser->*Function)
+			{
+				traverser->depth = it->depth;
+				(traverser->*Function)(node, traverser);
+			}
+		}
+	}
+
+	template<class T, bool (*TIntermTraverser::*Function)(bool, T*, TIntermTraverser*)>
+	static bool Visit(bool preVisit, T* node, TIntermTraverser* it)
+	{
+		std::vector<TFusedMember>& members = static_cast<TFusedTraverser*>(it)->members;
+		if (!preVisit)
+		{
+			for (size_t i = 0; i < members.size(); ++i)
+			{
+				TFusedMember& member = members[i];
+				TIntermTraverser* traverser = member.traverser;
+				if (member.skipping == node)
+					member.skipping = 0;
+				else if (!member.skipping && traverser->postVisit && traverser->*Function)
+				{
+					traverser->depth = it->depth;
+					(traverser->*Function)(false, node, traverser);
+				}
+			}
+			return true;
+		}
+
+		bool descend = false;
+		for (size_t i = 0; i < members.size(); ++i)
+		{
+			TFusedMember& member = members[i];
+			if (member.skipping)
+				continue;
+			++member.nodeCount;
+			TIntermTraverser* traverser = member.traverser;
+			if (traverser->preVisit && traverser->*Function)
+			{
+				traverser->depth = it->depth;
+				if (!(traverser->*Function)(true, node, traverser))
+				{
+					member.skipping = node;
+					continue;
+				}
+			}
+			descend = true;
+		}
+
+		// With no children walked there is no visit after them to end the
+		// skips at.
+		if (!descend)
+		{
+			for (size_t i = 0; i < members.size(); ++i)
+			{
+				if (members[i].skipping == node)
+					members[i].skipping = 0;
+			}
+		}
+		return descend;
+	}
+};
+
+
+TPassManager::~TPassManager()
+{
+	for (size_t i = 0; i < passes.size(); ++i)
+		delete passes[i];
+}
+
+
+void TPassManager::addPass(TPass* pass)
+{
+	passes.push_back(pass);
+}
+
+
+bool TPassManager::ready(const TPass* pass) const
+{
+	for (size_t i = 0; i < pass->dependencies.size(); ++i)
+	{
+		for (size_t j = 0; j < passes.size(); ++j)
+		{
+			if (passes[j] == pass->dependencies[i] && !finished[j])
+				return false;
+		}
+	}
+	return true;
+}
+
+
+void TPassManager::run(TIntermNode* root, const std::string& shader)
+{
+	double start = OS_GetTime();
+
+	finished.assign(passes.size(), false);
+	stats.clear();
+	ShPassStats entry = { "FindInputs", 0, 0, 0, 0 };
+	stats.push_back(entry);
+	for (size_t i = 0; i < passes.size(); ++i)
+	{
+		entry.name = passes[i]->getName();
+		stats.push_back(entry);
+	}
+
+	TInputFinder finder;
+	bool first = true;
+	bool tracing = TraceEnabled();
+	for (;;)
+	{
+		TFusedTraverser fused;
+		if (first)
+			fused.add(&finder);
+
+		// Passes finishing or being skipped can make others ready, so look
+		// until nothing changes.
+		std::vector<size_t> walking;
+		std::vector<bool> inWalk(passes.size(), false);
+		bool changed;
+		do
+		{
+			changed = false;
+			for (size_t i = 0; i < passes.size(); ++i)
+			{
+				TPass* pass = passes[i];
+				if (finished[i] || inWalk[i] || !ready(pass))
+					continue;
+				if (pass->inputs)
+				{
+					if (first)
+						continue;
+					if (!(pass->inputs & finder.inputs))
+					{
+						stats[i + 1].skipped = 1;
+						finished[i] = true;
+						changed = true;
+						continue;
+					}
+				}
+
+				TIntermTraverser* traverser = pass->beginWalk();
+				if (!traverser)
+				{
+					finished[i] = true;
+					changed = true;
+					continue;
+				}
+				walking.push_back(i);
+				inWalk[i] = true;
+				fused.add(traverser);
+			}
+		} while (changed);
+
+		if (fused.members.empty())
+			break;
+
+		double walkStart = OS_GetTime();
+		root->traverse(&fused);
+		double walkEnd = OS_GetTime();
+		double walkTime = walkEnd - walkStart;
+
+		if (tracing)
+		{
+			std::string name = first ? "FindInputs" : "";
+			int nodes = first ? finder.count : 0;
+			for (size_t i = 0; i < walking.size(); ++i)
+			{
+				if (!name.empty())
+					name += " + ";
+				name += passes[walking[i]]->getName();
+				nodes = std::max(nodes, fused.members[i + (first ? 1 : 0)].nodeCount);
+			}
+			TTraceArg args[] = { { "nodes", nodes } };
+			TraceEvent(name.c_str(), walkStart, walkEnd, shader, args, 1);
+		}
+
+		size_t member = 0;
+		if (first)
+		{
+			stats[0].time = walkTime;
+			stats[0].walkCount = 1;
+			stats[0].nodeCount = finder.count;
+			nodeCount = finder.count;
+			first = false;
+			++member;
+		}
+		for (size_t i = 0; i < walking.size(); ++i, ++member)
+		{
+			ShPassStats& passStats = stats[walking[i] + 1];
+			passStats.time += walkTime;
+			passStats.walkCount++;
+			passStats.nodeCount += fused.members[member].nodeCount;
+			passes[walking[i]]->endWalk();
+		}
+	}
+
+	time = OS_GetTime() - start;
+}
@@ -0,0 +1,110 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#ifndef _PASS_MANAGER_INCLUDED_
+#define _PASS_MANAGER_INCLUDED_
+
+#include "localintermediate.h"
+#include <string>
+#include <vector>
+
+//
+// Runs passes over the syntax tree in as few walks of it as it can.  Passes
+// that are ready at the same time share a walk: one traverser stands in for
+// all of them and hands each node to each of them in turn, keeping track of
+// which have chosen to skip the subtree they are in.
+//
+// The first walk also counts the nodes and notes which TPassInputs the tree
+// has.  A pass that needs inputs waits for that walk, and is skipped if none
+// of them turned up; a pass that needs none can share the first walk.
+//
+
+enum TPassInput {
+	EPassInputSamplers = 1 << 0,			// a node of sampler type
+	EPassInputMutableUniforms = 1 << 1,		// a symbol qualified as a mutable uniform
+};
+
+//
+// A pass is made of one or more walks of the tree.
+//
+class TPass {
+public:
+	TPass(const char* name, unsigned inputs = 0) : name(name), inputs(inputs) { }
+	virtual ~TPass() { }
+
+	const char* getName() const { return name; }
+	unsigned getInputs() const { return inputs; }
+
+	// Makes this pass wait until pass has finished or been skipped.
+	void runAfter(TPass* pass) { dependencies.push_back(pass); }
+
+	// Called before each walk; returns the traverser to walk with, or 0 once
+	// the pass has done its work.
+	virtual TIntermTraverser* beginWalk() = 0;
+
+	// Called after each walk beginWalk gave a traverser for.
+	virtual void endWalk() { }
+
+private:
+	friend class TPassManager;
+
+	const char* name;
+	unsigned inputs;
+	std::vector<TPass*> dependencies;
+};
+
+//
+// A pass of a single walk with a traverser the caller owns.
+//
+class TWalkPass : public TPass {
+public:
+	TWalkPass(const char* name, TIntermTraverser& traverser, unsigned inputs = 0) :
+		TPass(name, inputs), traverser(traverser), walked(false) { }
+
+	virtual TIntermTraverser* beginWalk() { return walked ? 0 : &traverser; }
+	virtual void endWalk() { walked = true; }
+
+private:
+	TIntermTraverser& traverser;
+	bool walked;
+};
+
+class TPassManager {
+public:
+	TPassManager() : nodeCount(0), time(0) { }
+	~TPassManager();
+
+	// The manager deletes the pass when it is done with it.
+	void addPass(TPass* pass);
+
+	// Runs every pass; each runs after those it was told to wait for, and
+	// otherwise in the order they were added.  With a trace open, each walk
+	// is traced under the names of the passes sharing it, for shader.
+	void run(TIntermNode* root, const std::string& shader);
+
+	// Nodes in the tree before any pass changed it.
+	int getNodeCount() const { return nodeCount; }
+
+	// Seconds run took.
+	double getTime() const { return time; }
+
+	// One for the first walk and then one per pass, in the order they were
+	// added.  The time of a walk counts for each pass that shared it.
+	const std::vector<ShPassStats>& getStats() const { return stats; }
+
+private:
+	TPassManager(const TPassManager&);
+	TPassManager& operator=(const TPassManager&);
+
+	bool ready(const TPass* pass) const;
+
+	std::vector<TPass*> passes;
+	std::vector<bool> finished;
+	std::vector<ShPassStats> stats;
+	int nodeCount;
+	double time;
+};
+
+#endif // _PASS_MANAGER_INCLUDED_
@@ -103,7 +103,10 @@ pageSize(growthIncrement),
 alignment(allocationAlignment),
 freeList(0),
 inUseList(0),
-numCalls(0)
+numCalls(0),
+totalBytes(0),
+inUseBytes(0),
+peakBytes(0)
 {
    //
    // Don't allow page sizes we know are smaller than all common
@@ -207,6 +210,7 @@ void TPoolAllocator::pop()
       inUseList->~tHeader();
 
       tHeader* nextInUse = inUseList->nextPage;
+      inUseBytes -= inUseList->pageCount * pageSize;
       if (inUseList->pageCount > 1)
          delete [] reinterpret_cast<char*>(inUseList);
       else
@@ -270,6 +274,7 @@ void* TPoolAllocator::allocate(size_t numBytes)
       // Use placement-new to initialize header
       new(memory) tHeader(inUseList, (numBytesToAlloc + pageSize - 1) / pageSize);
       inUseList = memory;
+      addInUseBytes(memory->pageCount * pageSize);
 
       currentPageOffset = pageSize;  // make next allocation come from a new page
 
@@ -295,6 +300,7 @@ void* TPoolAllocator::allocate(size_t numBytes)
    // Use placement-new to initialize header
    new(memory) tHeader(inUseList, 1);
    inUseList = memory;
+   addInUseBytes(pageSize);
 
    unsigned char* ret = reinterpret_cast<unsigned char *>(inUseList) + headerSkip;
    currentPageOffset = (headerSkip + allocationSize + alignmentMask) & ~alignmentMask;
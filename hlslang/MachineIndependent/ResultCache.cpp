@@ -0,0 +1,846 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#include "ResultCache.h"
+#include "osinclude.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+// Rough per-entry cost of the bookkeeping, on top of the strings it holds.
+static const size_t kEntryOverhead = 128;
+
+typedef std::list<TCachedResult> TResultList;
+typedef std::map<std::string, TResultList::iterator> TResultIndex;
+
+static TResultList resultList;      // most recently used first
+static TResultIndex resultIndex;
+static size_t resultBytes = 0;
+static size_t resultLimit = 0;
+
+// Compiles on different threads share the cache.  The entries in memory are
+// guarded by resultMutex and the files by diskMutex, which is held over file
+// I/O and waits for other processes, so lookups in memory never wait for the
+// disk.  Neither is taken while holding the other.
+static OS_Mutex resultMutex = OS_MUTEX_INITIALIZER;
+static OS_Mutex diskMutex = OS_MUTEX_INITIALIZER;
+
+class TResultCacheLock {
+public:
+	TResultCacheLock(OS_Mutex& m) : mutex(m) { OS_LockMutex(mutex); }
+	~TResultCacheLock() { OS_UnlockMutex(mutex); }
+private:
+	OS_Mutex& mutex;
+};
+
+
+TTokenHasher::TTokenHasher()
+: h1(14695981039346656037ULL)
+, h2(0x9e3779b97f4a7c15ULL)
+, lastFile(0)
+{
+}
+
+
+void TTokenHasher::add(const char* data, int length)
+{
+	for (int i = 0; i < length; ++i)
+	{
+		unsigned char ch = (unsigned char)data[i];
+		h1 = (h1 ^ ch) * 1099511628211ULL;
+		h2 = (h2 + ch + 1) * 0xff51afd7ed558ccdULL;
+		h2 ^= h2 >> 29;
+	}
+}
+
+
+void TTokenHasher::add(unsigned int value)
+{
+	char bytes[4] = { (char)value, (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+	add(bytes, 4);
+}
+
+
+void TTokenHasher::token(const char* text, int length, const TSourceLoc& line)
+{
+	if (line.file != lastFile)
+	{
+		const char* file = line.file ? line.file : "";
+		int fileLength = (int)strlen(file);
+		add(0xffffffffu);
+		add((unsigned int)fileLength);
+		add(file, fileLength);
+		lastFile = line.file;
+	}
+	add((unsigned int)line.line);
+	add((unsigned int)length);
+	add(text, length);
+}
+
+
+void TTokenHasher::appendDigest(std::string& key) const
+{
+	ResultCacheAppendUInt(key, (unsigned int)h1);
+	ResultCacheAppendUInt(key, (unsigned int)(h1 >> 32));
+	ResultCacheAppendUInt(key, (unsigned int)h2);
+	ResultCacheAppendUInt(key, (unsigned int)(h2 >> 32));
+}
+
+
+void ResultCacheAppendUInt(std::string& key, unsigned int value)
+{
+	key += (char)value;
+	key += (char)(value >> 8);
+	key += (char)(value >> 16);
+	key += (char)(value >> 24);
+}
+
+
+static size_t EntrySize(const TCachedResult& r)
+{
+	size_t size = kEntryOverhead + r.key.size() + r.text.size();
+	for (size_t i = 0; i < r.names.size(); ++i)
+		size += r.names[i].size() + r.semantics[i].size() + sizeof(ShUniformInfo);
+	return size;
+}
+
+
+static void EvictTo(size_t limit)
+{
+	while (resultBytes > limit && !resultList.empty())
+	{
+		TCachedResult& oldest = resultList.back();
+		resultBytes -= EntrySize(oldest);
+		resultIndex.erase(oldest.key);
+		resultList.pop_back();
+	}
+}
+
+
+// Points the uniform infos of r at its own name and semantic strings.
+static void LinkUniforms(TCachedResult& r)
+{
+	for (size_t i = 0; i < r.uniforms.size(); ++i)
+	{
+		r.uniforms[i].name = const_cast<char*>(r.names[i].c_str());
+		if (r.uniforms[i].semantic)
+			r.uniforms[i].semantic = const_cast<char*>(r.semantics[i].c_str());
+		r.uniforms[i].init = 0;
+	}
+}
+
+
+static void SetResult(TCachedResult& r, const std::string& key, const char* text, int textLength,
+                      const ShUniformInfo* uniforms, int uniformCount)
+{
+	r.key = key;
+	r.text.assign(text, textLength);
+	r.names.resize(uniformCount);
+	r.semantics.resize(uniformCount);
+	r.uniforms.assign(uniforms, uniforms + uniformCount);
+	for (int i = 0; i < uniformCount; ++i)
+	{
+		r.names[i] = uniforms[i].name;
+		r.semantics[i] = uniforms[i].semantic ? uniforms[i].semantic : "";
+	}
+	LinkUniforms(r);
+}
+
+
+// Takes the contents of r, leaving it empty.
+static void MemoryInsert(TCachedResult& r)
+{
+	resultList.push_front(TCachedResult());
+	TCachedResult& entry = resultList.front();
+	entry.key.swap(r.key);
+	entry.text.swap(r.text);
+	entry.names.swap(r.names);
+	entry.semantics.swap(r.semantics);
+	entry.uniforms.swap(r.uniforms);
+	LinkUniforms(entry);
+
+	resultIndex[entry.key] = resultList.begin();
+	resultBytes += EntrySize(entry);
+	EvictTo(resultLimit);
+}
+
+
+// --------------------------------------------------------------------------
+// On-disk cache
+//
+// results.dat holds records appended one after another.  results.idx is a
+// header followed by an open-addressed table of slots, each holding the
+// 128-bit hash of a key, where its record lives and when it was last used.
+// Every successful translation also gets a slot for the key of its parse,
+// with no record, so that ResultCacheHasParse works across processes.
+//
+// Writers serialize on a lock of the index file.  Readers take no lock and
+// instead check everything they read against the key they asked for, so a
+// torn read is only a miss.  Once the data file is over its cap or the table
+// is half full, a writer copies the most recently used records into fresh
+// files, marks the old index stale and renames the new files into place;
+// every process drops and reopens a stale index before its next lookup.
+// --------------------------------------------------------------------------
+
+static const unsigned int kIndexMagic = 0x43473248;   // "H2GC"
+static const unsigned int kRecordMagic = 0x52473248;  // "H2GR"
+static const unsigned int kIndexVersion = 1;
+static const unsigned int kMinSlots = 1024;
+static const unsigned long long kParseOnly = ~0ULL;
+
+struct TIndexHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int slotCount;      // a power of two
+	unsigned int used;
+	unsigned long long dataEnd;  // bytes of results.dat in use
+	unsigned int clock;          // last lastUse handed out
+	unsigned int stale;          // set once the files have been replaced
+	unsigned int reserved[8];
+};
+
+struct TIndexSlot {
+	unsigned long long h1, h2;   // both 0 for an empty slot
+	unsigned long long offset;   // of the record, or kParseOnly
+	unsigned int length;
+	unsigned int lastUse;
+};
+
+// Fixed part of a record; the key, text and uniforms follow.
+struct TRecordHeader {
+	unsigned int magic;
+	unsigned int checksum[2];      // of everything after the header
+	unsigned int parseKeyLength;
+	unsigned int keyLength;
+	unsigned int textLength;
+	unsigned int uniformCount;
+};
+
+// Per uniform, followed by its name and semantic.
+struct TRecordUniform {
+	unsigned int type;
+	int arraySize;
+	unsigned int nameLength;
+	unsigned int semanticLength;  // plus one; 0 when there is no semantic
+};
+
+static std::string diskDir;        // empty when there is no disk cache
+static size_t diskLimit = 0;
+static bool diskReadOnly = false;
+static OS_MappedFile diskIndex;
+static FILE* diskData = 0;
+
+
+static std::string DiskPath(const char* name)
+{
+	return diskDir + "/" + name;
+}
+
+
+static TIndexHeader* IndexHeader()
+{
+	return (TIndexHeader*)diskIndex.data;
+}
+
+
+static TIndexSlot* IndexSlots()
+{
+	return (TIndexSlot*)(IndexHeader() + 1);
+}
+
+
+static size_t IndexSize(unsigned int slotCount)
+{
+	return sizeof(TIndexHeader) + slotCount * sizeof(TIndexSlot);
+}
+
+
+static void HashKey(const char* key, size_t length, unsigned long long& h1, unsigned long long& h2)
+{
+	TTokenHasher hasher;
+	hasher.add(key, (int)length);
+	hasher.digest(h1, h2);
+	if (!h1 && !h2)
+		h1 = 1;
+}
+
+
+// Returns the slot holding the hash, or the empty slot where it would go;
+// 0 if the table is full, which only a damaged index can be.
+static TIndexSlot* FindSlot(TIndexSlot* slots, unsigned int slotCount, unsigned long long h1, unsigned long long h2)
+{
+	unsigned int mask = slotCount - 1;
+	unsigned int i = (unsigned int)h1 & mask;
+	for (unsigned int n = 0; n < slotCount; ++n, i = (i + 1) & mask)
+	{
+		TIndexSlot& slot = slots[i];
+		if ((slot.h1 == h1 && slot.h2 == h2) || (!slot.h1 && !slot.h2))
+			return &slot;
+	}
+	return 0;
+}
+
+
+static bool AddSlot(TIndexSlot* slots, unsigned int slotCount, const char* key, size_t keyLength,
+                    unsigned long long offset, unsigned int length, unsigned int lastUse)
+{
+	unsigned long long h1, h2;
+	HashKey(key, keyLength, h1, h2);
+	TIndexSlot* slot = FindSlot(slots, slotCount, h1, h2);
+	if (!slot || slot->h1 || slot->h2)
+		return false;
+	slot->offset = offset;
+	slot->length = length;
+	slot->lastUse = lastUse;
+	// Readers treat a slot as present once it has a hash, so set that last.
+	slot->h2 = h2;
+	slot->h1 = h1;
+	return true;
+}
+
+
+static void DiskDetach()
+{
+	if (diskIndex.data)
+		OS_UnmapFile(diskIndex);
+	if (diskData)
+		fclose(diskData);
+	diskData = 0;
+}
+
+
+static void InitIndex(unsigned int slotCount)
+{
+	TIndexHeader* header = IndexHeader();
+	memset(header, 0, IndexSize(slotCount));
+	header->magic = kIndexMagic;
+	header->version = kIndexVersion;
+	header->slotCount = slotCount;
+}
+
+
+static bool DiskAttach()
+{
+	std::string indexPath = DiskPath("results.idx");
+	std::string dataPath = DiskPath("results.dat");
+
+	if (diskReadOnly)
+	{
+		if (!OS_MapFile(diskIndex, indexPath.c_str(), 0, false))
+			return false;
+		TIndexHeader* header = IndexHeader();
+		if (diskIndex.size < sizeof(TIndexHeader) || header->magic != kIndexMagic || header->version != kIndexVersion
+			|| !header->slotCount || (header->slotCount & (header->slotCount - 1))
+			|| diskIndex.size < IndexSize(header->slotCount) || header->stale)
+		{
+			DiskDetach();
+			return false;
+		}
+		diskData = fopen(dataPath.c_str(), "rb");
+		if (!diskData)
+		{
+			DiskDetach();
+			return false;
+		}
+		// Another process appends to the file, so do not buffer stale reads.
+		setvbuf(diskData, 0, _IONBF, 0);
+		return true;
+	}
+
+	// Another writer may replace the files between their opening and the
+	// locking; the index is stale then, and the new one is opened instead.
+	// One still stale after a few tries was left by a writer that died
+	// before renaming the new files in, and nothing will ever replace it.
+	bool abandoned = false;
+	for (int attempt = 0; ; ++attempt)
+	{
+		if (!OS_MapFile(diskIndex, indexPath.c_str(), IndexSize(kMinSlots), true))
+			return false;
+		if (!OS_LockFile(diskIndex))
+		{
+			DiskDetach();
+			return false;
+		}
+		if (!IndexHeader()->stale)
+			break;
+		if (attempt == 3)
+		{
+			abandoned = true;
+			break;
+		}
+		OS_UnlockFile(diskIndex);
+		DiskDetach();
+	}
+	// A new index file comes back zeroed; one from another version, or an
+	// abandoned one, is discarded along with its data.
+	TIndexHeader* header = IndexHeader();
+	bool fresh = abandoned || header->magic != kIndexMagic || header->version != kIndexVersion
+		|| diskIndex.size != IndexSize(header->slotCount);
+	if (fresh && diskIndex.size != IndexSize(kMinSlots))
+	{
+		DiskDetach();
+		remove(indexPath.c_str());
+		if (!OS_MapFile(diskIndex, indexPath.c_str(), IndexSize(kMinSlots), true) || !OS_LockFile(diskIndex))
+		{
+			DiskDetach();
+			return false;
+		}
+		header = IndexHeader();
+	}
+	if (fresh)
+		InitIndex(kMinSlots);
+
+	diskData = fopen(dataPath.c_str(), fresh ? "w+b" : "r+b");
+	if (!diskData && !fresh)
+		diskData = fopen(dataPath.c_str(), "w+b");
+	if (diskData && !fresh && header->dataEnd)
+	{
+		// The data file may have gone missing under an existing index.
+		OS_SeekFile(diskData, 0, SEEK_END);
+		if (OS_TellFile(diskData) < header->dataEnd)
+		{
+			InitIndex(header->slotCount);
+		}
+	}
+	OS_UnlockFile(diskIndex);
+
+	if (!diskData)
+	{
+		DiskDetach();
+		return false;
+	}
+	return true;
+}
+
+
+// Reopens the files if another process has replaced them.  A reader that
+// finds the new ones not yet in place tries again on its next lookup.
+static bool DiskRefresh()
+{
+	if (diskDir.empty())
+		return false;
+	if (diskIndex.data && !IndexHeader()->stale)
+		return true;
+	DiskDetach();
+	return DiskAttach();
+}
+
+
+static void RecordChecksum(const std::string& bytes, unsigned int checksum[2])
+{
+	unsigned long long h1, h2;
+	TTokenHasher hasher;
+	hasher.add(bytes.data() + sizeof(TRecordHeader), (int)(bytes.size() - sizeof(TRecordHeader)));
+	hasher.digest(h1, h2);
+	checksum[0] = (unsigned int)h1;
+	checksum[1] = (unsigned int)h2;
+}
+
+
+// Reads a record and checks that it is intact, though not which key it holds.
+static bool ReadRecord(unsigned long long offset, unsigned int length, std::string& bytes, TRecordHeader& header)
+{
+	if (offset == kParseOnly || length < sizeof(TRecordHeader) || !OS_SeekFile(diskData, offset, SEEK_SET))
+		return false;
+	bytes.resize(length);
+	if (fread(&bytes[0], 1, length, diskData) != length)
+		return false;
+
+	unsigned int checksum[2];
+	RecordChecksum(bytes, checksum);
+	memcpy(&header, bytes.data(), sizeof(header));
+	return header.magic == kRecordMagic && header.checksum[0] == checksum[0] && header.checksum[1] == checksum[1]
+		&& header.parseKeyLength <= header.keyLength && length - sizeof(header) >= header.keyLength;
+}
+
+
+// Checks a record against the key it should hold, and unpacks it into r.
+static bool ParseRecord(const std::string& bytes, const TRecordHeader& header, const char* key, size_t keyLength, TCachedResult& r)
+{
+	size_t pos = sizeof(header);
+	if (header.keyLength != keyLength || memcmp(bytes.data() + pos, key, keyLength) != 0)
+		return false;
+	pos += keyLength;
+	if (bytes.size() - pos < header.textLength)
+		return false;
+
+	r.key.assign(key, keyLength);
+	r.text.assign(bytes, pos, header.textLength);
+	pos += header.textLength;
+
+	r.names.clear();
+	r.semantics.clear();
+	r.uniforms.clear();
+	for (unsigned int i = 0; i < header.uniformCount; ++i)
+	{
+		TRecordUniform u;
+		if (bytes.size() - pos < sizeof(u))
+			return false;
+		memcpy(&u, bytes.data() + pos, sizeof(u));
+		pos += sizeof(u);
+		size_t semanticLength = u.semanticLength ? u.semanticLength - 1 : 0;
+		if (bytes.size() - pos < (size_t)u.nameLength + semanticLength)
+			return false;
+
+		ShUniformInfo info;
+		info.name = 0;
+		info.semantic = u.semanticLength ? (char*)"" : 0;
+		info.type = (EShType)u.type;
+		info.arraySize = u.arraySize;
+		info.init = 0;
+		r.uniforms.push_back(info);
+		r.names.push_back(bytes.substr(pos, u.nameLength));
+		pos += u.nameLength;
+		r.semantics.push_back(bytes.substr(pos, semanticLength));
+		pos += semanticLength;
+	}
+	return pos == bytes.size();
+}
+
+
+static void AppendBytes(std::string& bytes, const void* data, size_t length)
+{
+	bytes.append((const char*)data, length);
+}
+
+
+static std::string MakeRecord(const std::string& key, size_t parseKeyLength, const char* text, int textLength,
+                              const ShUniformInfo* uniforms, int uniformCount)
+{
+	TRecordHeader header;
+	header.magic = kRecordMagic;
+	header.checksum[0] = header.checksum[1] = 0;
+	header.parseKeyLength = (unsigned int)parseKeyLength;
+	header.keyLength = (unsigned int)key.size();
+	header.textLength = (unsigned int)textLength;
+	header.uniformCount = (unsigned int)uniformCount;
+
+	std::string bytes;
+	AppendBytes(bytes, &header, sizeof(header));
+	bytes += key;
+	bytes.append(text, textLength);
+	for (int i = 0; i < uniformCount; ++i)
+	{
+		const char* semantic = uniforms[i].semantic;
+		TRecordUniform u;
+		u.type = uniforms[i].type;
+		u.arraySize = uniforms[i].arraySize;
+		u.nameLength = (unsigned int)strlen(uniforms[i].name);
+		u.semanticLength = semantic ? (unsigned int)strlen(semantic) + 1 : 0;
+		AppendBytes(bytes, &u, sizeof(u));
+		bytes += uniforms[i].name;
+		if (semantic)
+			bytes += semantic;
+	}
+	RecordChecksum(bytes, header.checksum);
+	memcpy(&bytes[0], &header, sizeof(header));
+	return bytes;
+}
+
+
+static bool DiskFind(const std::string& key, TCachedResult& r)
+{
+	if (!DiskRefresh())
+		return false;
+
+	unsigned long long h1, h2;
+	HashKey(key.data(), key.size(), h1, h2);
+	TIndexSlot* slot = FindSlot(IndexSlots(), IndexHeader()->slotCount, h1, h2);
+	if (!slot || (!slot->h1 && !slot->h2))
+		return false;
+	std::string bytes;
+	TRecordHeader header;
+	if (!ReadRecord(slot->offset, slot->length, bytes, header) || !ParseRecord(bytes, header, key.data(), key.size(), r))
+		return false;
+
+	if (!diskReadOnly)
+		slot->lastUse = ++IndexHeader()->clock;
+	return true;
+}
+
+
+static bool DiskHasParse(const std::string& parseKey)
+{
+	if (!DiskRefresh())
+		return false;
+
+	unsigned long long h1, h2;
+	HashKey(parseKey.data(), parseKey.size(), h1, h2);
+	TIndexSlot* slot = FindSlot(IndexSlots(), IndexHeader()->slotCount, h1, h2);
+	return slot && (slot->h1 || slot->h2);
+}
+
+
+static bool SlotMoreRecent(const TIndexSlot& a, const TIndexSlot& b)
+{
+	return a.lastUse > b.lastUse;
+}
+
+
+// Rewrites the cache keeping the most recently used records that fit in
+// half the cap, leaving room for another reserve bytes.  Called locked.
+static bool DiskCompact(size_t reserve)
+{
+	TIndexHeader* header = IndexHeader();
+	std::vector<TIndexSlot> live;
+	for (unsigned int i = 0; i < header->slotCount; ++i)
+	{
+		const TIndexSlot& slot = IndexSlots()[i];
+		if ((slot.h1 || slot.h2) && slot.offset != kParseOnly)
+			live.push_back(slot);
+	}
+	std::sort(live.begin(), live.end(), SlotMoreRecent);
+
+	size_t budget = diskLimit / 2 > reserve ? diskLimit / 2 - reserve : 0;
+	size_t kept = 0, bytes = 0;
+	while (kept < live.size() && bytes + live[kept].length <= budget)
+		bytes += live[kept++].length;
+	live.resize(kept);
+
+	// Each record brings a parse slot at most; stay a quarter full.
+	unsigned int slotCount = kMinSlots;
+	while (slotCount < (kept * 2 + 2) * 4)
+		slotCount *= 2;
+
+	std::string indexTemp = DiskPath("results.idx.tmp");
+	std::string dataTemp = DiskPath("results.dat.tmp");
+	OS_MappedFile index;
+	remove(indexTemp.c_str());
+	FILE* data = fopen(dataTemp.c_str(), "wb");
+	if (!data || !OS_MapFile(index, indexTemp.c_str(), IndexSize(slotCount), true) || index.size != IndexSize(slotCount))
+	{
+		if (data)
+			fclose(data);
+		OS_UnmapFile(index);
+		remove(dataTemp.c_str());
+		remove(indexTemp.c_str());
+		return false;
+	}
+
+	TIndexHeader* newHeader = (TIndexHeader*)index.data;
+	TIndexSlot* newSlots = (TIndexSlot*)(newHeader + 1);
+	memset(newHeader, 0, index.size);
+	newHeader->magic = kIndexMagic;
+	newHeader->version = kIndexVersion;
+	newHeader->slotCount = slotCount;
+	newHeader->clock = header->clock;
+
+	bool ok = true;
+	unsigned long long offset = 0;
+	std::string record;
+	for (size_t i = 0; i < live.size() && ok; ++i)
+	{
+		TRecordHeader recordHeader;
+		if (!ReadRecord(live[i].offset, live[i].length, record, recordHeader))
+			continue;
+		const char* key = record.data() + sizeof(recordHeader);
+		if (!AddSlot(newSlots, slotCount, key, recordHeader.keyLength, offset, live[i].length, live[i].lastUse))
+			continue;
+		if (AddSlot(newSlots, slotCount, key, recordHeader.parseKeyLength, kParseOnly, 0, 0))
+			++newHeader->used;
+		++newHeader->used;
+		ok = fwrite(record.data(), 1, record.size(), data) == record.size();
+		offset += record.size();
+	}
+	newHeader->dataEnd = offset;
+	ok = fclose(data) == 0 && ok;
+	OS_UnmapFile(index);
+
+	if (ok)
+	{
+		fflush(diskData);
+		header->stale = 1;
+		bool dataReplaced = OS_ReplaceFile(dataTemp.c_str(), DiskPath("results.dat").c_str());
+		ok = dataReplaced && OS_ReplaceFile(indexTemp.c_str(), DiskPath("results.idx").c_str());
+		// Without the new index the old one no longer matches the data.
+		if (dataReplaced && !ok)
+			InitIndex(header->slotCount);
+		else if (!ok)
+			header->stale = 0;
+	}
+	remove(dataTemp.c_str());
+	remove(indexTemp.c_str());
+	return ok;
+}
+
+
+static void DiskInsert(const std::string& key, size_t parseKeyLength, const char* text, int textLength,
+                       const ShUniformInfo* uniforms, int uniformCount)
+{
+	if (diskReadOnly || !DiskRefresh())
+		return;
+
+	std::string record = MakeRecord(key, parseKeyLength, text, textLength, uniforms, uniformCount);
+	if (record.size() > diskLimit / 2)
+		return;
+
+	// Another writer may replace the files while this one waits for the lock.
+	for (int attempt = 0; ; ++attempt)
+	{
+		if (attempt == 2 || !OS_LockFile(diskIndex))
+			return;
+		if (!IndexHeader()->stale)
+			break;
+		OS_UnlockFile(diskIndex);
+		if (!DiskRefresh())
+			return;
+	}
+
+	TIndexHeader* header = IndexHeader();
+	if (header->dataEnd + record.size() > diskLimit || (header->used + 2) * 2 > header->slotCount)
+	{
+		bool compacted = DiskCompact(record.size());
+		OS_UnlockFile(diskIndex);
+		if (!compacted || !DiskRefresh() || !OS_LockFile(diskIndex))
+			return;
+		header = IndexHeader();
+		if (header->stale || header->dataEnd + record.size() > diskLimit || (header->used + 2) * 2 > header->slotCount)
+		{
+			OS_UnlockFile(diskIndex);
+			return;
+		}
+	}
+
+	unsigned long long h1, h2;
+	HashKey(key.data(), key.size(), h1, h2);
+	TIndexSlot* slot = FindSlot(IndexSlots(), header->slotCount, h1, h2);
+	bool present = slot && (slot->h1 || slot->h2);
+	if (present)
+	{
+		// A record that does not read back, such as one torn by a crash, is
+		// written again rather than leaving its key a miss until compaction.
+		std::string bytes;
+		TRecordHeader recordHeader;
+		TCachedResult existing;
+		if (ReadRecord(slot->offset, slot->length, bytes, recordHeader)
+			&& ParseRecord(bytes, recordHeader, key.data(), key.size(), existing))
+			slot = 0;
+	}
+	if (slot && OS_SeekFile(diskData, header->dataEnd, SEEK_SET)
+		&& fwrite(record.data(), 1, record.size(), diskData) == record.size() && fflush(diskData) == 0)
+	{
+		unsigned long long offset = header->dataEnd;
+		header->dataEnd += record.size();
+		if (present)
+		{
+			// Readers check what they read against the key, so one that sees
+			// the slot half rewritten only misses.
+			slot->offset = offset;
+			slot->length = (unsigned int)record.size();
+			slot->lastUse = ++header->clock;
+		}
+		else if (AddSlot(IndexSlots(), header->slotCount, key.data(), key.size(), offset, (unsigned int)record.size(), ++header->clock))
+			++header->used;
+		if (AddSlot(IndexSlots(), header->slotCount, key.data(), parseKeyLength, kParseOnly, 0, 0))
+			++header->used;
+	}
+	OS_UnlockFile(diskIndex);
+}
+
+
+bool SetResultCacheDirectory(const char* dir, size_t maxBytes, bool readOnly)
+{
+	TResultCacheLock lock(diskMutex);
+	DiskDetach();
+	diskDir.clear();
+	if (!dir)
+		return true;
+
+	diskDir = dir;
+	diskLimit = maxBytes;
+	diskReadOnly = readOnly;
+	if (DiskAttach())
+		return true;
+	diskDir.clear();
+	return false;
+}
+
+
+// --------------------------------------------------------------------------
+
+
+void SetResultCacheLimit(size_t bytes)
+{
+	TResultCacheLock lock(resultMutex);
+	resultLimit = bytes;
+	EvictTo(resultLimit);
+}
+
+
+bool ResultCacheEnabled()
+{
+	{
+		TResultCacheLock lock(resultMutex);
+		if (resultLimit != 0)
+			return true;
+	}
+	TResultCacheLock lock(diskMutex);
+	return !diskDir.empty();
+}
+
+
+bool ResultCacheHasParse(const std::string& parseKey)
+{
+	{
+		TResultCacheLock lock(resultMutex);
+		TResultIndex::const_iterator it = resultIndex.lower_bound(parseKey);
+		if (it != resultIndex.end() && it->first.compare(0, parseKey.size(), parseKey) == 0)
+			return true;
+	}
+	TResultCacheLock lock(diskMutex);
+	return DiskHasParse(parseKey);
+}
+
+
+bool ResultCacheFind(const std::string& key, TCachedResult& result)
+{
+	{
+		TResultCacheLock lock(resultMutex);
+		TResultIndex::iterator it = resultIndex.find(key);
+		if (it != resultIndex.end())
+		{
+			resultList.splice(resultList.begin(), resultList, it->second);
+			result = *it->second;
+			LinkUniforms(result);
+			return true;
+		}
+	}
+
+	{
+		TResultCacheLock lock(diskMutex);
+		if (!DiskFind(key, result))
+			return false;
+	}
+	LinkUniforms(result);
+	// Keep it in memory too, unless it would be evicted straight away.  Another
+	// thread may have put it there meanwhile.
+	TResultCacheLock lock(resultMutex);
+	if (EntrySize(result) <= resultLimit && resultIndex.find(key) == resultIndex.end())
+	{
+		TCachedResult entry = result;
+		MemoryInsert(entry);
+	}
+	return true;
+}
+
+
+void ResultCacheInsert(const std::string& key, size_t parseKeyLength, const char* text, int textLength,
+                       const ShUniformInfo* uniforms, int uniformCount)
+{
+	{
+		TResultCacheLock lock(diskMutex);
+		DiskInsert(key, parseKeyLength, text, textLength, uniforms, uniformCount);
+	}
+
+	TResultCacheLock lock(resultMutex);
+	if (!resultLimit || resultIndex.find(key) != resultIndex.end())
+		return;
+	TCachedResult r;
+	SetResult(r, key, text, textLength, uniforms, uniformCount);
+	MemoryInsert(r);
+}
@@ -0,0 +1,72 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#ifndef _RESULT_CACHE_INCLUDED_
+#define _RESULT_CACHE_INCLUDED_
+
+#include "ParseHelper.h"
+
+//
+// Process-wide cache of translation results, keyed by the preprocessed
+// token stream of a shader plus every setting that affects its translation.
+// Disabled until given a size; least recently used results are dropped
+// first once it is full.
+//
+// It can also be backed by a directory holding an append-only data file and
+// a memory-mapped hash index, shared by every process that opens it.  Memory
+// is checked first, then the directory.
+//
+
+// Hashes the preprocessed tokens of a shader, with the line and file of each,
+// since those end up in the #line directives of the output.
+class TTokenHasher : public TPreprocessSink {
+public:
+	TTokenHasher();
+	virtual void token(const char* text, int length, const TSourceLoc& line);
+
+	// Appends the 128-bit digest to key.
+	void appendDigest(std::string& key) const;
+
+	void add(const char* data, int length);
+	void add(unsigned int value);
+	void digest(unsigned long long& a, unsigned long long& b) const { a = h1; b = h2; }
+
+private:
+
+	unsigned long long h1, h2;
+	const char* lastFile;
+};
+
+struct TCachedResult {
+	std::string key;
+	std::string text;
+	std::vector<std::string> names;
+	std::vector<std::string> semantics;
+	std::vector<ShUniformInfo> uniforms;   // name and semantic point into the strings above
+};
+
+void SetResultCacheLimit(size_t bytes);
+
+// Opens the on-disk cache in dir, which must exist; maxBytes caps its data
+// file.  A read-only cache is only looked up and never written.  A null dir
+// closes it.
+bool SetResultCacheDirectory(const char* dir, size_t maxBytes, bool readOnly);
+
+bool ResultCacheEnabled();
+
+// True if some cached result was translated from the given parse key; every
+// result key starts with the key of the parse it came from.
+bool ResultCacheHasParse(const std::string& parseKey);
+
+// Copies the result for key into result; false if there is none.
+bool ResultCacheFind(const std::string& key, TCachedResult& result);
+
+// The first parseKeyLength bytes of key are the key of the parse.
+void ResultCacheInsert(const std::string& key, size_t parseKeyLength, const char* text, int textLength,
+                       const ShUniformInfo* uniforms, int uniformCount);
+
+void ResultCacheAppendUInt(std::string& key, unsigned int value);
+
+#endif // _RESULT_CACHE_INCLUDED_
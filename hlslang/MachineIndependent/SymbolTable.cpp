@@ -20,14 +20,14 @@ bool TSymbolTableLevel::insert(TSymbol& symbol)
 }
 
 // Recursively generate mangled names.
-void TType::buildMangledName(TString& mangledName) const
+static void BuildMangledName(const TTypeData& type, TString& mangledName)
 {
-	if (isMatrix())
+	if (type.matrix)
 		mangledName += 'm';
-	else if (isVector())
+	else if (type.size > 1)
 		mangledName += 'v';
 	
-	switch (type)
+	switch (type.type)
 	{
 		case EbtFloat:              mangledName += 'f';      break;
 		case EbtInt:                mangledName += 'i';      break;
@@ -43,81 +43,189 @@ void TType::buildMangledName(TString& mangledName) const
 		case EbtSamplerRectShadow:  mangledName += "sSR2";   break;  // ARB_texture_rectangle
 		case EbtStruct:
 			mangledName += "struct-";
-			if (typeName)
-				mangledName += *typeName;
-		{// support MSVC++6.0
-			for (unsigned int i = 0; i < structure->size(); ++i)
+			if (type.typeName)
+				mangledName += *type.typeName;
+			if (type.structure)
 			{
-				mangledName += '-';
-				(*structure)[i].type->buildMangledName(mangledName);
+				for (unsigned int i = 0; i < type.structure->size(); ++i)
+				{
+					mangledName += '-';
+					(*type.structure)[i].type->buildMangledName(mangledName);
+				}
 			}
-		}
 		default: 
 			break;
 	}
 	
-	mangledName += static_cast<char>('0' + getNominalSize());
-	if (isArray())
+	mangledName += static_cast<char>('0' + type.size);
+	if (type.array)
 	{
 		char buf[10];
-		sprintf(buf, "%d", arraySize);
+		sprintf(buf, "%d", type.arraySize);
 		mangledName += '[';
 		mangledName += buf;
 		mangledName += ']';
 	}
 }
 
-int TType::getStructSize() const
+static bool IsNonSquareMatrix(const TTypeData& type)
 {
-	if (!getStruct())
+	if (type.structure == NULL || type.typeName == NULL)
+		return false;
+	
+	const TString& l_typeName = *type.typeName;
+	return l_typeName.compare ("float2x3") == 0 ||
+	   l_typeName.compare ( "float3x2") == 0 ||
+	   l_typeName.compare ( "float3x4") == 0 ||
+	   l_typeName.compare ( "float4x3") == 0 ||
+	   l_typeName.compare ( "float2x4") == 0 ||
+	   l_typeName.compare ( "float4x2") == 0 ||
+
+	   l_typeName.compare ( "half2x3") == 0 ||
+	   l_typeName.compare ( "half3x2") == 0 ||
+	   l_typeName.compare ( "half3x4") == 0 ||
+	   l_typeName.compare ( "half4x3") == 0 ||
+	   l_typeName.compare ( "half2x4") == 0 ||
+	   l_typeName.compare ( "half4x2") == 0 ||
+
+	   
+	   l_typeName.compare ( "fixed2x3") == 0 ||
+	   l_typeName.compare ( "fixed3x2") == 0 ||
+	   l_typeName.compare ( "fixed3x4") == 0 ||
+	   l_typeName.compare ( "fixed4x3") == 0 ||
+	   l_typeName.compare ( "fixed2x4") == 0 ||
+	   l_typeName.compare ( "fixed4x2") == 0;
+}
+
+static unsigned HashType(const TTypeData& type)
+{
+	unsigned hash = 2166136261u;
+	unsigned fields[6] = { (unsigned)type.type, (unsigned)type.size, type.matrix, type.array,
+	                       (unsigned)type.arraySize, (unsigned)(UINT_PTR)type.structure };
+	for (int i = 0; i < 6; ++i)
+		hash = (hash ^ fields[i]) * 16777619u;
+	if (type.typeName)
 	{
-		assert(false && "Not a struct");
-		return 0;
+		for (TString::const_iterator c = type.typeName->begin(); c != type.typeName->end(); ++c)
+			hash = (hash ^ (unsigned char)*c) * 16777619u;
 	}
-	
-	if (structureSize == 0)
-		for (TTypeList::iterator tl = getStruct()->begin(); tl != getStruct()->end(); tl++)
-			structureSize += ((*tl).type)->getObjectSize();
-	
-	return structureSize;
+	return hash;
 }
 
-bool TType::isNonSquareMatrix() const
+static bool SameType(const TTypeData& a, const TTypeData& b)
 {
-	if (getStruct() == NULL)
+	if (a.hash != b.hash || a.type != b.type || a.size != b.size || a.matrix != b.matrix ||
+	    a.array != b.array || a.arraySize != b.arraySize || a.structure != b.structure)
 		return false;
-	
-	if (nonSquareMatrix == - 1)
+	if (!a.typeName || !b.typeName)
+		return a.typeName == b.typeName;
+	return *a.typeName == *b.typeName;
+}
+
+// Allocates interned data and works out what depends on it alone.
+static const TTypeData* NewTypeData(const TTypeData& key)
+{
+	void* memory = GlobalPoolAllocator.allocate(sizeof(TTypeData));
+	TTypeData* data = new(memory) TTypeData(key);
+
+	if (key.typeName)
+		data->typeName = NewPoolTString(key.typeName->c_str());
+
+	TString* mangled = NewPoolTString("");
+	BuildMangledName(*data, *mangled);
+	*mangled += ';';
+	data->mangled = mangled;
+
+	data->structureSize = 0;
+	if (data->structure)
+		for (TTypeList::iterator tl = data->structure->begin(); tl != data->structure->end(); tl++)
+			data->structureSize += ((*tl).type)->getObjectSize();
+
+	data->nonSquareMatrix = IsNonSquareMatrix(*data);
+	return data;
+}
+
+
+TTypeContext::TTypeContext(const TTypeContext* p) : parent(p), count(0)
+{
+	table.resize(64, 0);
+}
+
+const TTypeData* TTypeContext::find(const TTypeData& key) const
+{
+	size_t mask = table.size() - 1;
+	for (size_t i = key.hash & mask; table[i]; i = (i + 1) & mask)
+	{
+		if (SameType(*table[i], key))
+			return table[i];
+	}
+	return 0;
+}
+
+void TTypeContext::insert(const TTypeData* data)
+{
+	size_t mask = table.size() - 1;
+	size_t i = data->hash & mask;
+	while (table[i])
+		i = (i + 1) & mask;
+	table[i] = data;
+}
+
+const TTypeData* TTypeContext::intern(const TTypeData& shape)
+{
+	TTypeData key = shape;
+	if (!key.array)
+		key.arraySize = 0;
+	key.hash = HashType(key);
+
+	for (const TTypeContext* context = this; context; context = context->parent)
 	{
-		const TString& l_typeName = getTypeName();
-		if (l_typeName.compare ("float2x3") == 0 ||
-		   l_typeName.compare ( "float3x2") == 0 ||
-		   l_typeName.compare ( "float3x4") == 0 ||
-		   l_typeName.compare ( "float4x3") == 0 ||
-		   l_typeName.compare ( "float2x4") == 0 ||
-		   l_typeName.compare ( "float4x2") == 0 ||
-
-		   l_typeName.compare ( "half2x3") == 0 ||
-		   l_typeName.compare ( "half3x2") == 0 ||
-		   l_typeName.compare ( "half3x4") == 0 ||
-		   l_typeName.compare ( "half4x3") == 0 ||
-		   l_typeName.compare ( "half2x4") == 0 ||
-		   l_typeName.compare ( "half4x2") == 0 ||
-
-		   
-		   l_typeName.compare ( "fixed2x3") == 0 ||
-		   l_typeName.compare ( "fixed3x2") == 0 ||
-		   l_typeName.compare ( "fixed3x4") == 0 ||
-		   l_typeName.compare ( "fixed4x3") == 0 ||
-		   l_typeName.compare ( "fixed2x4") == 0 ||
-		   l_typeName.compare ( "fixed4x2") == 0 
-		   )
-			nonSquareMatrix = 1;
-		else
-			nonSquareMatrix = 0;
+		const TTypeData* found = context->find(key);
+		if (found)
+			return found;
+	}
+
+	// Keep the table at most half full.
+	if (2 * (count + 1) > (int)table.size())
+	{
+		TVector<const TTypeData*> old(table);
+		table.assign(2 * old.size(), 0);
+		for (size_t i = 0; i < old.size(); ++i)
+		{
+			if (old[i])
+				insert(old[i]);
+		}
 	}
 
-	return nonSquareMatrix == 1;
+	const TTypeData* data = NewTypeData(key);
+	insert(data);
+	++count;
+	return data;
+}
+
+const TTypeData* InternType(const TTypeData& key)
+{
+	TTypeContext* context = GlobalTypeContext;
+	if (context)
+		return context->intern(key);
+
+	assert(0 && "InternType(): no type context");
+	TTypeData shape = key;
+	if (!shape.array)
+		shape.arraySize = 0;
+	shape.hash = HashType(shape);
+	return NewTypeData(shape);
+}
+
+int TType::getStructSize() const
+{
+	if (!getStruct())
+	{
+		assert(false && "Not a struct");
+		return 0;
+	}
+	
+	return data->structureSize;
 }
 
 int TType::getNonSquareRows() const
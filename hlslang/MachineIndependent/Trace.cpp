@@ -0,0 +1,123 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#include "Trace.h"
+#include "osinclude.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+	#define snprintf _snprintf
+#endif
+
+static FILE* traceFile = 0;
+static double traceStart = 0;       // OS_GetTime of the trace's time 0
+static bool traceFirst = true;      // no event written yet, so none needs a comma
+
+// Compiles on every thread write to the one file.
+static OS_Mutex traceMutex = OS_MUTEX_INITIALIZER;
+
+class TTraceLock {
+public:
+	TTraceLock() { OS_LockMutex(traceMutex); }
+	~TTraceLock() { OS_UnlockMutex(traceMutex); }
+};
+
+
+static void Stop()
+{
+	if (!traceFile)
+		return;
+	fputs("\n]\n", traceFile);
+	fclose(traceFile);
+	traceFile = 0;
+}
+
+
+bool TraceStart(const char* path)
+{
+	TTraceLock lock;
+	Stop();
+	traceFile = fopen(path, "w");
+	if (!traceFile)
+		return false;
+	fputs("[\n", traceFile);
+	traceStart = OS_GetTime();
+	traceFirst = true;
+	return true;
+}
+
+
+void TraceStop()
+{
+	TTraceLock lock;
+	Stop();
+}
+
+
+bool TraceEnabled()
+{
+	TTraceLock lock;
+	return traceFile != 0;
+}
+
+
+static void AppendJsonString(std::string& out, const std::string& text)
+{
+	out += '"';
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		unsigned char c = (unsigned char)text[i];
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += (char)c;
+		}
+		else if (c < 0x20)
+		{
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			out += escape;
+		}
+		else
+			out += (char)c;
+	}
+	out += '"';
+}
+
+
+void TraceEvent(const char* name, double start, double end, const std::string& shader,
+                const TTraceArg* args, int argCount)
+{
+	// Format outside the lock, so other threads only wait for the write.
+	char buffer[128];
+	std::string event = "{\"name\":";
+	AppendJsonString(event, name);
+	snprintf(buffer, sizeof(buffer), ",\"cat\":\"hlsl2glsl\",\"ph\":\"X\",\"pid\":1,\"tid\":%u", OS_GetThreadId());
+	event += buffer;
+
+	event += ",\"args\":{";
+	bool first = true;
+	if (!shader.empty())
+	{
+		event += "\"shader\":";
+		AppendJsonString(event, shader);
+		first = false;
+	}
+	for (int i = 0; i < argCount; ++i)
+	{
+		snprintf(buffer, sizeof(buffer), "%s\"%s\":%d", first ? "" : ",", args[i].name, args[i].value);
+		event += buffer;
+		first = false;
+	}
+	event += "}";
+
+	TTraceLock lock;
+	if (!traceFile)
+		return;
+	fprintf(traceFile, "%s%s,\"ts\":%.3f,\"dur\":%.3f}", traceFirst ? "" : ",\n", event.c_str(),
+	        (start - traceStart) * 1e6, (end - start) * 1e6);
+	traceFirst = false;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#ifndef _TRACE_INCLUDED_
+#define _TRACE_INCLUDED_
+
+#include <string>
+
+//
+// Process-wide trace of compile phases in the Chrome trace event format,
+// which chrome://tracing and Perfetto load.  While a trace is open, each
+// phase becomes a complete ("X") event on the thread that ran it, carrying
+// the name of the shader and the sizes of what the phase worked on.
+//
+// Events go to the file as they finish, in the JSON array format; viewers
+// read it even when the closing bracket is missing because the process never
+// stopped the trace.
+//
+
+// A number attached to an event, such as the bytes of source it read.
+struct TTraceArg {
+	const char* name;
+	int value;
+};
+
+// Starts writing a trace to path, ending any trace already open.  Returns
+// false if the file cannot be created.
+bool TraceStart(const char* path);
+
+// Finishes and closes the trace, if one is open.
+void TraceStop();
+
+// Whether a trace is open, so phases can skip gathering their arguments.
+bool TraceEnabled();
+
+// Writes an event for a phase that ran on this thread from start to end, in
+// OS_GetTime seconds.  shader can be empty.
+void TraceEvent(const char* name, double start, double end, const std::string& shader,
+                const TTraceArg* args = 0, int argCount = 0);
+
+#endif // _TRACE_INCLUDED_
@@ -0,0 +1,332 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#include "WorkPool.h"
+#include "InitializeDll.h"
+#include "osinclude.h"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+
+struct TWorkQueue {
+	OS_Mutex mutex;
+	std::deque<int> items;
+};
+
+struct TWorkPool {
+	TWorkQueue* queues;
+	int queueCount;
+	TWorkFunction function;
+	void* data;
+};
+
+struct TWorker {
+	TWorkPool* pool;
+	int queue;
+};
+
+
+static bool PopFront(TWorkQueue& queue, int& item)
+{
+	OS_LockMutex(queue.mutex);
+	bool found = !queue.items.empty();
+	if (found)
+	{
+		item = queue.items.front();
+		queue.items.pop_front();
+	}
+	OS_UnlockMutex(queue.mutex);
+	return found;
+}
+
+
+static bool PopBack(TWorkQueue& queue, int& item)
+{
+	OS_LockMutex(queue.mutex);
+	bool found = !queue.items.empty();
+	if (found)
+	{
+		item = queue.items.back();
+		queue.items.pop_back();
+	}
+	OS_UnlockMutex(queue.mutex);
+	return found;
+}
+
+
+// Nothing is queued once the threads are running, so a thread that finds
+// every queue empty is done.
+static void Work(TWorkPool& pool, int self)
+{
+	int item;
+	for (;;)
+	{
+		bool found = PopFront(pool.queues[self], item);
+		for (int i = 1; !found && i < pool.queueCount; ++i)
+			found = PopBack(pool.queues[(self + i) % pool.queueCount], item);
+		if (!found)
+			return;
+		pool.function(item, pool.data);
+	}
+}
+
+
+static void WorkerThread(void* arg)
+{
+	TWorker* worker = (TWorker*)arg;
+
+	// If this thread cannot be set up, the others steal its share.
+	if (InitThread())
+		Work(*worker->pool, worker->queue);
+	DetachThread();
+}
+
+
+void RunWorkStealing(int count, int threads, TWorkFunction function, void* data)
+{
+	if (count <= 0)
+		return;
+	if (threads <= 0)
+		threads = OS_GetProcessorCount();
+	if (threads > count)
+		threads = count;
+
+	TWorkPool pool;
+	pool.queues = new TWorkQueue[threads];
+	pool.queueCount = threads;
+	pool.function = function;
+	pool.data = data;
+	for (int i = 0; i < threads; ++i)
+	{
+		OS_InitMutex(pool.queues[i].mutex);
+		int begin = (int)((long long)count * i / threads);
+		int end = (int)((long long)count * (i + 1) / threads);
+		for (int item = begin; item < end; ++item)
+			pool.queues[i].items.push_back(item);
+	}
+
+	// The calling thread works the first queue.
+	std::vector<TWorker> workers(threads);
+	std::vector<OS_Thread> handles(threads);
+	std::vector<bool> started(threads, false);
+	for (int i = 1; i < threads; ++i)
+	{
+		workers[i].pool = &pool;
+		workers[i].queue = i;
+		started[i] = OS_CreateThread(handles[i], WorkerThread, &workers[i]);
+	}
+
+	Work(pool, 0);
+
+	for (int i = 1; i < threads; ++i)
+	{
+		if (started[i])
+			OS_JoinThread(handles[i]);
+	}
+	for (int i = 0; i < threads; ++i)
+		OS_DestroyMutex(pool.queues[i].mutex);
+	delete [] pool.queues;
+}
+
+
+struct TQueuedJob {
+	void* key;
+	TJobFunction function;
+	void* job;
+};
+
+static OS_Mutex jobMutex = OS_MUTEX_INITIALIZER;
+static OS_Condition jobQueued = OS_CONDITION_INITIALIZER;
+static OS_Condition jobDone = OS_CONDITION_INITIALIZER;
+static std::deque<TQueuedJob> pendingJobs;
+static std::vector<void*> runningKeys;
+static std::vector<OS_Thread> jobThreads;
+static int jobWorkers = 0;          // threads set up to run jobs, or still starting
+static bool stoppingJobs = false;
+
+
+static bool IsRunning(void* key)
+{
+	return std::find(runningKeys.begin(), runningKeys.end(), key) != runningKeys.end();
+}
+
+
+// The first queued job whose key is not busy.  Jobs ahead of it under the
+// same key would have been picked instead, so each key keeps its order.
+static std::deque<TQueuedJob>::iterator NextJob()
+{
+	std::deque<TQueuedJob>::iterator it = pendingJobs.begin();
+	while (it != pendingJobs.end() && IsRunning(it->key))
+		++it;
+	return it;
+}
+
+
+static void CancelQueuedJobs(const std::vector<TQueuedJob>& jobs)
+{
+	for (size_t i = 0; i < jobs.size(); ++i)
+		jobs[i].function(jobs[i].job, true);
+}
+
+
+static void JobThread(void*)
+{
+	// A thread that cannot be set up takes no jobs.  If it was the last one,
+	// nothing would ever run the jobs queued so far, so they are cancelled.
+	// Their keys count as running until then, for WaitForJobs.
+	if (!InitThread())
+	{
+		std::vector<TQueuedJob> cancelled;
+		OS_LockMutex(jobMutex);
+		if (--jobWorkers == 0)
+		{
+			cancelled.assign(pendingJobs.begin(), pendingJobs.end());
+			pendingJobs.clear();
+			for (size_t i = 0; i < cancelled.size(); ++i)
+				runningKeys.push_back(cancelled[i].key);
+		}
+		OS_UnlockMutex(jobMutex);
+
+		CancelQueuedJobs(cancelled);
+
+		OS_LockMutex(jobMutex);
+		for (size_t i = 0; i < cancelled.size(); ++i)
+			runningKeys.erase(std::find(runningKeys.begin(), runningKeys.end(), cancelled[i].key));
+		OS_BroadcastCondition(jobDone);
+		OS_UnlockMutex(jobMutex);
+
+		DetachThread();
+		return;
+	}
+
+	OS_LockMutex(jobMutex);
+	for (;;)
+	{
+		std::deque<TQueuedJob>::iterator it = NextJob();
+		if (it == pendingJobs.end())
+		{
+			if (stoppingJobs)
+				break;
+			OS_WaitCondition(jobQueued, jobMutex);
+			continue;
+		}
+
+		TQueuedJob job = *it;
+		pendingJobs.erase(it);
+		runningKeys.push_back(job.key);
+		OS_UnlockMutex(jobMutex);
+
+		job.function(job.job, false);
+
+		OS_LockMutex(jobMutex);
+		runningKeys.erase(std::find(runningKeys.begin(), runningKeys.end(), job.key));
+		OS_BroadcastCondition(jobDone);
+	}
+	--jobWorkers;
+	OS_UnlockMutex(jobMutex);
+
+	DetachThread();
+}
+
+
+bool QueueJob(void* key, TJobFunction function, void* job)
+{
+	OS_LockMutex(jobMutex);
+	// The threads start with the first job, and again if none could be set
+	// up; those that gave up are joined by StopJobQueue.
+	if (jobWorkers == 0 && !stoppingJobs)
+	{
+		int threads = OS_GetProcessorCount();
+		for (int i = 0; i < threads; ++i)
+		{
+			OS_Thread thread;
+			++jobWorkers;
+			if (OS_CreateThread(thread, JobThread, 0))
+				jobThreads.push_back(thread);
+			else
+				--jobWorkers;
+		}
+	}
+
+	bool queued = jobWorkers > 0 && !stoppingJobs;
+	if (queued)
+	{
+		TQueuedJob entry = { key, function, job };
+		pendingJobs.push_back(entry);
+		OS_SignalCondition(jobQueued);
+	}
+	OS_UnlockMutex(jobMutex);
+	return queued;
+}
+
+
+int CancelJobs(void* key)
+{
+	std::vector<TQueuedJob> cancelled;
+
+	OS_LockMutex(jobMutex);
+	std::deque<TQueuedJob>::iterator it = pendingJobs.begin();
+	while (it != pendingJobs.end())
+	{
+		if (it->key == key)
+		{
+			cancelled.push_back(*it);
+			it = pendingJobs.erase(it);
+		}
+		else
+			++it;
+	}
+	if (!cancelled.empty())
+		OS_BroadcastCondition(jobDone);
+	OS_UnlockMutex(jobMutex);
+
+	CancelQueuedJobs(cancelled);
+	return (int)cancelled.size();
+}
+
+
+void WaitForJobs(void* key)
+{
+	OS_LockMutex(jobMutex);
+	for (;;)
+	{
+		bool pending = IsRunning(key);
+		for (size_t i = 0; !pending && i < pendingJobs.size(); ++i)
+			pending = pendingJobs[i].key == key;
+		if (!pending)
+			break;
+		OS_WaitCondition(jobDone, jobMutex);
+	}
+	OS_UnlockMutex(jobMutex);
+}
+
+
+void StopJobQueue()
+{
+	OS_LockMutex(jobMutex);
+	if (jobThreads.empty() || stoppingJobs)
+	{
+		OS_UnlockMutex(jobMutex);
+		return;
+	}
+	std::vector<TQueuedJob> cancelled(pendingJobs.begin(), pendingJobs.end());
+	pendingJobs.clear();
+	std::vector<OS_Thread> threads;
+	threads.swap(jobThreads);
+	stoppingJobs = true;
+	OS_BroadcastCondition(jobQueued);
+	OS_BroadcastCondition(jobDone);
+	OS_UnlockMutex(jobMutex);
+
+	CancelQueuedJobs(cancelled);
+	for (size_t i = 0; i < threads.size(); ++i)
+		OS_JoinThread(threads[i]);
+
+	OS_LockMutex(jobMutex);
+	stoppingJobs = false;
+	OS_UnlockMutex(jobMutex);
+}
@@ -0,0 +1,55 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+
+#ifndef _WORK_POOL_INCLUDED_
+#define _WORK_POOL_INCLUDED_
+
+//
+// Runs a function over a range of indices on several threads.  Each thread
+// owns a queue that starts out with a contiguous share of the range and is
+// worked from the front; a thread whose queue runs dry steals from the back
+// of another's, so one that draws the slow items does not hold the rest up.
+//
+// Threads started here are set up with InitThread, which gives each its own
+// pool allocator and parse context, and are detached again when done.
+//
+
+typedef void (*TWorkFunction)(int index, void* data);
+
+// Calls function(i, data) once for every i in [0, count), using up to
+// threads threads including the calling one, which must already be set up;
+// 0 or less means one per processor.  Returns once every call has finished.
+void RunWorkStealing(int count, int threads, TWorkFunction function, void* data);
+
+
+//
+// A queue of jobs run in the background by threads the library owns.  The
+// threads, one per processor, are started by the first QueueJob and run
+// until StopJobQueue.  Jobs queued under the same key run one at a time and
+// in the order they were queued, so a key can stand for an object that the
+// jobs share.
+//
+
+// Called with cancelled false to run the job, or with cancelled true, on
+// the cancelling thread, if it was taken off the queue first.
+typedef void (*TJobFunction)(void* job, bool cancelled);
+
+// Returns false if no thread could be started to run the job.  A thread that
+// then fails to be set up runs no jobs; once none is left, the queued jobs
+// are cancelled.
+bool QueueJob(void* key, TJobFunction function, void* job);
+
+// Cancels the jobs queued under key that have not started, and returns how
+// many there were.
+int CancelJobs(void* key);
+
+// Waits until no job queued under key is left, running or not.
+void WaitForJobs(void* key);
+
+// Cancels every job that has not started, waits for the running ones and
+// stops the threads.
+void StopJobQueue();
+
+#endif // _WORK_POOL_INCLUDED_
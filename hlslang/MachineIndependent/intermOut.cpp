@@ -14,19 +14,6 @@
 // 2.  Print out a text based description of the tree.
 //
 
-//
-// Use this class to carry along data from node to node in 
-// the traversal
-//
-class TOutputTraverser : public TIntermTraverser
-{
-public:
-   TOutputTraverser(TInfoSink& i) : infoSink(i)
-   {
-   }
-   TInfoSink& infoSink;
-};
-
 TString TType::getCompleteString() const
 {
    char buf[100];
@@ -36,14 +23,14 @@ TString TType::getCompleteString() const
       p += sprintf(p, "%s ", getQualifierString());
 
    sprintf(p, "%s", getBasicString());
-   if (array)
+   if (isArray())
       p += sprintf(p, " array");
-   if (matrix)
-      p += sprintf(p, "matrix%dX%d", size, size);
+   if (isMatrix())
+      p += sprintf(p, "matrix%dX%d", getNominalSize(), getNominalSize());
    else if (isNonSquareMatrix())
 	   p += sprintf(p, "matrix%dX%d", getNonSquareColumns(), getNonSquareRows());
-   else if (size > 1)
-      p += sprintf(p, "vec%d", size);
+   else if (getNominalSize() > 1)
+      p += sprintf(p, "vec%d", getNominalSize());
 
    return TString(buf);
 }   
@@ -500,16 +487,18 @@ void TIntermediate::outputTree(TIntermNode* root)
       return;
 
    TOutputTraverser it(infoSink);
-
-   it.visitAggregate = OutputAggregate;
-   it.visitBinary = OutputBinary;
-   it.visitConstant = OutputConstant;
-   it.visitSelection = OutputSelection;
-   it.visitSymbol = OutputSymbol;
-   it.visitUnary = OutputUnary;
-   it.visitLoop = OutputLoop;
-   it.visitBranch = OutputBranch;
-
    root->traverse(&it);
 }
 
+TOutputTraverser::TOutputTraverser(TInfoSink& i) : infoSink(i)
+{
+   visitAggregate = OutputAggregate;
+   visitBinary = OutputBinary;
+   visitConstant = OutputConstant;
+   visitSelection = OutputSelection;
+   visitSymbol = OutputSymbol;
+   visitUnary = OutputUnary;
+   visitLoop = OutputLoop;
+   visitBranch = OutputBranch;
+}
+
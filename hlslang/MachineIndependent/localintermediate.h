@@ -62,5 +62,17 @@ private:
 	void operator=(TIntermediate&); // prevent assignments
 };
 
+//
+// Use this class to carry along data from node to node in 
+// the traversal.  Walking a tree with it prints the tree to the
+// debug stream of the info sink, as outputTree does.
+//
+class TOutputTraverser : public TIntermTraverser
+{
+public:
+   TOutputTraverser(TInfoSink& i);
+   TInfoSink& infoSink;
+};
+
 #endif // _LOCAL_INTERMEDIATE_INCLUDED_
 
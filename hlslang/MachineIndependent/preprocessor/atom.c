@@ -240,8 +240,8 @@ struct AtomTable_Rec {
     int size;
 };
 
-static AtomTable latable = { { 0 } };
-AtomTable *atable = &latable;
+static CPP_THREAD_LOCAL AtomTable latable = { { 0 } };
+CPP_THREAD_LOCAL AtomTable *atable = NULL;
 
 static int AddAtomFixed(AtomTable *atable, const char *s, int atom);
 
@@ -547,6 +547,14 @@ int InitAtomTable(AtomTable *atable, int htsize)
     return 1;
 } // InitAtomTable
 
+// Point atable at the calling thread's table and initialize it.
+
+int InitLocalAtomTable(void)
+{
+    atable = &latable;
+    return InitAtomTable(atable, 0);
+} // InitLocalAtomTable
+
 
 
 
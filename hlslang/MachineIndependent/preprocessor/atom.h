@@ -7,9 +7,10 @@
 
 typedef struct AtomTable_Rec AtomTable;
 
-extern AtomTable *atable;
+extern CPP_THREAD_LOCAL AtomTable *atable;
 
 int InitAtomTable(AtomTable *atable, int htsize);
+int InitLocalAtomTable(void);
 void FreeAtomTable(AtomTable *atable);
 int AddAtom(AtomTable *atable, const char *s);
 int LookUpAddString(AtomTable *atable, const char *s);
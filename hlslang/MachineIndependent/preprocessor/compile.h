@@ -21,12 +21,32 @@ struct CPPStruct_Rec {
     int elsetracker;            //#if-#else and #endif constructs...Counter.
     const char *ErrMsg;
     int CompileError;           //Indicate compile error when #error, #else,#elif mismatch.
+    int includeDepth;           //Nesting depth of #include files being read.
 
     //
     // Globals used to communicate between PaParseStrings() and yy_input()and 
     // also across the files.(gen_glslang.cpp and scanner.c)
     //
     unsigned int tokensBeforeEOF : 1;
+
+    //
+    // Value of the float constant last handed to yy_input(), so the lexer
+    // does not convert its text a second time.
+    //
+    unsigned int lastFloatValid : 1;
+    float lastFloatValue;
+
+    //
+    // Per-compile arena for input sources and macro expansion state.
+    // Expansion records are recycled through the free lists, so expanding
+    // a macro does not allocate once the lists are warm.
+    //
+    MemoryPool *pool;
+    InputSrc *freeMacroInputs;      // MacroInputSrc records, linked through prev
+    InputSrc *freeTokenInputs;      // TokenInputSrc records, linked through prev
+    TokenStream *freeArgStreams;    // macro argument streams, linked through next
+    TokenStream *privateIncludes;   // #include streams not in the cache, linked through next
+    struct IncludeInputSrc *cachedIncludes; // #include replays of cached streams, released by FreeCPP
 };
 
 #endif // !defined(__COMPILE_H)
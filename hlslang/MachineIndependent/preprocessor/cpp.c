@@ -15,30 +15,32 @@
 const TSourceLoc gNullSourceLoc = { NULL, 0 };
 
 static int CPPif(yystypepp * yylvalpp);
+static void ReleaseIncludeFiles(void);
 
 /* Don't use memory.c's replacements, as we clean up properly here */
 #undef malloc
 #undef free
 
-static int defineAtom = 0;
-static int definedAtom = 0;
-static int elseAtom = 0;
-static int elifAtom = 0;
-static int endifAtom = 0;
-static int ifAtom = 0;
-static int ifdefAtom = 0;
-static int ifndefAtom = 0;
-static int includeAtom = 0;
-static int lineAtom = 0;
-static int pragmaAtom = 0;
-static int undefAtom = 0;
-static int errorAtom = 0;
-static int __LINE__Atom = 0;
-static int __FILE__Atom = 0;
-
-static Scope *macros = 0;
+static CPP_THREAD_LOCAL int defineAtom = 0;
+static CPP_THREAD_LOCAL int definedAtom = 0;
+static CPP_THREAD_LOCAL int elseAtom = 0;
+static CPP_THREAD_LOCAL int elifAtom = 0;
+static CPP_THREAD_LOCAL int endifAtom = 0;
+static CPP_THREAD_LOCAL int ifAtom = 0;
+static CPP_THREAD_LOCAL int ifdefAtom = 0;
+static CPP_THREAD_LOCAL int ifndefAtom = 0;
+static CPP_THREAD_LOCAL int includeAtom = 0;
+static CPP_THREAD_LOCAL int lineAtom = 0;
+static CPP_THREAD_LOCAL int pragmaAtom = 0;
+static CPP_THREAD_LOCAL int undefAtom = 0;
+static CPP_THREAD_LOCAL int errorAtom = 0;
+static CPP_THREAD_LOCAL int __LINE__Atom = 0;
+static CPP_THREAD_LOCAL int __FILE__Atom = 0;
+
+static CPP_THREAD_LOCAL Scope *macros = 0;
 #define MAX_MACRO_ARGS  64
 #define MAX_IF_NESTING  64
+#define MAX_INCLUDE_DEPTH  32
 
 
 int InitCPP(void)
@@ -60,16 +62,33 @@ int InitCPP(void)
     __LINE__Atom = LookUpAddString(atable, "__LINE__");
     __FILE__Atom = LookUpAddString(atable, "__FILE__");
     macros = NewScopeInPool(mem_CreatePool(0, 0));
+    cpp->pool = mem_CreatePool(0, 0);
     return 1;
 } // InitCPP
 
 int FreeCPP(void)
 {
+    TokenStream *tokens;
+
+    ReleaseIncludeFiles();
+    while (cpp->privateIncludes) {
+        tokens = cpp->privateIncludes;
+        cpp->privateIncludes = tokens->next;
+        DeleteTokenStream(tokens);
+    }
     if (macros)
     {
         mem_FreePool(macros->pool);
         macros = 0;
     }
+    if (cpp->pool)
+    {
+        mem_FreePool(cpp->pool);
+        cpp->pool = NULL;
+        cpp->freeMacroInputs = NULL;
+        cpp->freeTokenInputs = NULL;
+        cpp->freeArgStreams = NULL;
+    }
 	
     return 1;
 }
@@ -190,6 +209,7 @@ static int CPPundef(yystypepp * yylvalpp)
 } // CPPundef
 
 static int CPPline(yystypepp * yylvalpp);
+static int CPPinclude(yystypepp * yylvalpp);
 
 /*
  * CPPgotoEndOfIfBlock: jump to matching #else, #elif or #endif
@@ -636,6 +656,8 @@ int readCPPline(yystypepp * yylvalpp)
 			token = CPPundef(yylvalpp);
         } else if (yylvalpp->sc_ident == errorAtom) {
 			token = CPPerror(yylvalpp);
+        } else if (yylvalpp->sc_ident == includeAtom) {
+			token = CPPinclude(yylvalpp);
         } else {
             StoreStr("Invalid Directive");
             StoreStr(GetStringOfAtom(atable,yylvalpp->sc_ident));
@@ -656,8 +678,7 @@ static int eof_scan(InputSrc *in, yystypepp * yylvalpp) { return -1; }
 static int noop_getch(InputSrc *in) { return -1; }
 static void noop_ungetc(InputSrc *in, int ch) { }
 
-static void PushEofSrc() {
-    InputSrc *in = malloc(sizeof(InputSrc));
+static void PushEofSrc(InputSrc *in) {
     memset(in, 0, sizeof(InputSrc));
     in->scan = eof_scan;
     in->getch = noop_getch;
@@ -666,17 +687,83 @@ static void PushEofSrc() {
     cpp->currentInput = in;
 }
 
-static void PopEofSrc() {
-    if (cpp->currentInput->scan == eof_scan) {
-        InputSrc *in = cpp->currentInput;
-        cpp->currentInput = in->prev;
-        free(in);
+static void PopEofSrc(InputSrc *in) {
+    InputSrc **link;
+    for (link = &cpp->currentInput; *link; link = &(*link)->prev) {
+        if (*link == in) {
+            *link = in->prev;
+            break;
+        }
     }
 }
 
+/* PredefineMacro ---
+ ** define an object-like macro before any source is scanned, as if by
+ ** "#define name value".  A later definition of the same name replaces it.
+ ** Returns 0 if name is not an identifier.
+ */
+int PredefineMacro(const char *name, const char *value)
+{
+    yystypepp lval;
+    InputSrc eof;
+    MacroSymbol mac;
+    Symbol *symb;
+    SourceLoc dummyLoc;
+    TSourceLoc line;
+    const char *p;
+    int atom, token;
+
+    if (!name || !(isalpha((unsigned char) *name) || *name == '_'))
+        return 0;
+    for (p = name + 1; *p; p++)
+        if (!(isalnum((unsigned char) *p) || *p == '_'))
+            return 0;
+    atom = LookUpAddString(atable, name);
+
+    memset(&mac, 0, sizeof(mac));
+    memset(&dummyLoc, 0, sizeof(dummyLoc));
+    mac.body = NewTokenStream(name, macros->pool);
+    if (value && *value) {
+        line = GetLineNumber();
+        PushEofSrc(&eof);
+        ScanFromString(value);
+        while ((token = cpp->currentInput->scan(cpp->currentInput, &lval)) > 0) {
+            if (token != '\n')
+                RecordToken(mac.body, token, &lval);
+        }
+        cpp->currentInput = eof.prev;
+        SetLineNumber(line);
+    }
+
+    symb = LookUpSymbol(macros, atom);
+    if (!symb)
+        symb = AddSymbol(&dummyLoc, macros, atom);
+    symb->mac = mac;
+    return 1;
+} // PredefineMacro
+
+/* NewArgStream, FreeArgStream ---
+ ** macro argument streams are recycled rather than freed, keeping their blocks
+ */
+static TokenStream *NewArgStream(void) {
+    TokenStream *ts = cpp->freeArgStreams;
+    if (!ts)
+        return NewTokenStream("macro arg", cpp->pool);
+    cpp->freeArgStreams = ts->next;
+    ts->next = NULL;
+    ClearTokenStream(ts);
+    return ts;
+}
+
+static void FreeArgStream(TokenStream *ts) {
+    ts->next = cpp->freeArgStreams;
+    cpp->freeArgStreams = ts;
+}
+
 static TokenStream *PrescanMacroArg(TokenStream *a, yystypepp * yylvalpp) {
     int token;
     TokenStream *n;
+    InputSrc eof;
     RewindTokenStream(a);
     do {
         token = ReadToken(a, yylvalpp);
@@ -684,25 +771,46 @@ static TokenStream *PrescanMacroArg(TokenStream *a, yystypepp * yylvalpp) {
             break;
     } while (token > 0);
     if (token <= 0) return a;
-    n = NewTokenStream("macro arg", 0);
-    PushEofSrc();
+    n = NewArgStream();
+    PushEofSrc(&eof);
     ReadFromTokenStream(a, 0);
     while ((token = cpp->currentInput->scan(cpp->currentInput, yylvalpp)) > 0) {
         if (token == CPP_IDENTIFIER && MacroExpand(yylvalpp->sc_ident, yylvalpp))
             continue;
         RecordToken(n, token, yylvalpp);
     }
-    PopEofSrc();
-    DeleteTokenStream(a);
+    PopEofSrc(&eof);
+    FreeArgStream(a);
     return n;
 } // PrescanMacroArg
 
 typedef struct MacroInputSrc {
     InputSrc    base;
     MacroSymbol *mac;
-    TokenStream **args;
+    TokenStream *args[MAX_MACRO_ARGS];
 } MacroInputSrc;
 
+static MacroInputSrc *NewMacroInputSrc(void) {
+    MacroInputSrc *in = (MacroInputSrc *) cpp->freeMacroInputs;
+    if (in)
+        cpp->freeMacroInputs = in->base.prev;
+    else
+        in = mem_Alloc(cpp->pool, sizeof(*in));
+    memset(in, 0, sizeof(*in));
+    return in;
+}
+
+/* FreeMacroInputSrc ---
+ ** recycle an expansion record along with the argument streams it collected
+ */
+static void FreeMacroInputSrc(MacroInputSrc *in) {
+    int i;
+    for (i = 0; i < MAX_MACRO_ARGS && in->args[i]; i++)
+        FreeArgStream(in->args[i]);
+    in->base.prev = cpp->freeMacroInputs;
+    cpp->freeMacroInputs = &in->base;
+}
+
 
 
 static int expand_macro_param(MacroInputSrc* in, yystypepp* yylvalpp)
@@ -722,7 +830,6 @@ static int expand_macro_param(MacroInputSrc* in, yystypepp* yylvalpp)
  ** return the next token for a macro expanion, handling macro args
  */
 static int macro_scan(MacroInputSrc *in, yystypepp * yylvalpp) {
-    int i;
     int token = ReadToken(in->mac->body, yylvalpp);
 	
 
@@ -777,12 +884,7 @@ static int macro_scan(MacroInputSrc *in, yystypepp * yylvalpp) {
     if (token > 0) return token;
     in->mac->busy = 0;
     cpp->currentInput = in->base.prev;
-    if (in->args) {
-        for (i=in->mac->argc-1; i>=0; i--)
-            DeleteTokenStream(in->args[i]);
-        free(in->args);
-    }
-    free(in);
+    FreeMacroInputSrc(in);
     return cpp->currentInput->scan(cpp->currentInput, yylvalpp);
 } // macro_scan
 
@@ -813,21 +915,20 @@ int MacroExpand(int atom, yystypepp * yylvalpp)
     }
     if (!sym || sym->mac.undef) return 0;
     if (sym->mac.busy) return 0;        // no recursive expansions
-    in = malloc(sizeof(*in));
-    memset(in, 0, sizeof(*in));
+    in = NewMacroInputSrc();
     in->base.scan = (void *)macro_scan;
     in->base.line = cpp->currentInput->line;
     in->mac = &sym->mac;
     if (sym->mac.args) {
         token = cpp->currentInput->scan(cpp->currentInput, yylvalpp);
         if (token != '(') {
+            FreeMacroInputSrc(in);
             UngetToken(token, yylvalpp);
             yylvalpp->sc_ident = atom;
             return 0;
         }
-        in->args = malloc(in->mac->argc * sizeof(TokenStream *));
         for (i=0; i<in->mac->argc; i++)
-            in->args[i] = NewTokenStream("macro arg", 0);
+            in->args[i] = NewArgStream();
         i=0;j=0;
         do{
             depth = 0;
@@ -839,6 +940,7 @@ int MacroExpand(int atom, yystypepp * yylvalpp)
                     message=GetStrfromTStr();
                     CPPShInfoLogMsg(message);
                     ResetTString();
+                    FreeMacroInputSrc(in);
                     return 1;
                 }
                 if((in->mac->argc==0) && (token!=')')) break;
@@ -877,6 +979,7 @@ int MacroExpand(int atom, yystypepp * yylvalpp)
                 message=GetStrfromTStr();
                 CPPShInfoLogMsg(message);
                 ResetTString();
+                FreeMacroInputSrc(in);
                 return 1;
             }
             StoreStr("Too many args in Macro ");
@@ -897,3 +1000,346 @@ int MacroExpand(int atom, yystypepp * yylvalpp)
     cpp->currentInput = &in->base;
     return 1;
 } // MacroExpand
+
+
+/*
+ * #include support.
+ *
+ * The text of an included file comes from the include handler set on the
+ * compiler.  It is tokenized once into a TokenStream, which is then replayed
+ * for the include.  Streams are kept in a process-wide cache keyed by the
+ * file name and its contents, which are kept to compare against, so a header
+ * shared by many shaders is only tokenized again when its contents change.  The cache is shared by
+ * compiles running on different threads, so it is only touched while holding
+ * CPPLockIncludeCache().  A cached stream is never changed: each replay reads
+ * it through a cursor of its own, so any number of compiles can replay it at
+ * once.  A stream replaced while compiles still replay it is freed by the
+ * last of them.
+ */
+
+typedef struct IncludeCacheEntry_Rec {
+    struct IncludeCacheEntry_Rec *next;
+    char *name;
+    char *text;                     // the contents the stream was recorded from
+    unsigned int size;
+    unsigned int hash;              // FNV-1a hash of the contents
+    TokenStream *tokens;            // malloc'ed, outlives the compile
+    int users;                      // compiles holding the stream for a replay
+    int retired;                    // out of the cache, freed when users drops to 0
+} IncludeCacheEntry;
+
+static IncludeCacheEntry *includeCache = NULL;
+
+typedef struct IncludeInputSrc {
+    InputSrc            base;
+    TokenStream         *tokens;
+    TokenCursor         cursor;
+    IncludeCacheEntry   *entry;     // NULL if the stream is private to this compile, or released
+    TSourceLoc          includer;   // where to resume in the including file
+    struct IncludeInputSrc *next;   // in cpp->cachedIncludes
+} IncludeInputSrc;
+
+static void DeleteIncludeCacheEntry(IncludeCacheEntry *entry)
+{
+    DeleteTokenStream(entry->tokens);
+    free(entry->text);
+    free(entry->name);
+    free(entry);
+} // DeleteIncludeCacheEntry
+
+/* ReleaseIncludeFile ---
+ ** give a cached stream back once this compile is done replaying it
+ */
+static void ReleaseIncludeFile(IncludeInputSrc *in)
+{
+    IncludeCacheEntry *entry = in->entry;
+    if (!entry)
+        return;
+    CPPLockIncludeCache();
+    if (--entry->users == 0 && entry->retired)
+        DeleteIncludeCacheEntry(entry);
+    CPPUnlockIncludeCache();
+    in->entry = NULL;
+} // ReleaseIncludeFile
+
+/* HoldIncludeFile ---
+ ** replay a cached stream, keeping it until this compile releases it; the
+ ** cache lock is held
+ */
+static void HoldIncludeFile(IncludeInputSrc *in, IncludeCacheEntry *entry)
+{
+    entry->users++;
+    in->tokens = entry->tokens;
+    in->entry = entry;
+    in->next = cpp->cachedIncludes;
+    cpp->cachedIncludes = in;
+} // HoldIncludeFile
+
+/* FindIncludeFile ---
+ ** the cached stream of the given file and contents, if any; the cache lock
+ ** is held
+ */
+static IncludeCacheEntry *FindIncludeFile(const char *name, const char *data, unsigned int size, unsigned int hash)
+{
+    IncludeCacheEntry *entry;
+    for (entry = includeCache; entry; entry = entry->next) {
+        if (entry->size == size && entry->hash == hash && !strcmp(entry->name, name) &&
+            (size == 0 || !memcmp(entry->text, data, size)))
+            return entry;
+    }
+    return NULL;
+} // FindIncludeFile
+
+/* ReleaseIncludeFiles ---
+ ** give back every cached stream this compile holds; one it stopped
+ ** replaying partway through, on an error, was never released
+ */
+static void ReleaseIncludeFiles(void)
+{
+    while (cpp->cachedIncludes) {
+        ReleaseIncludeFile(cpp->cachedIncludes);
+        cpp->cachedIncludes = cpp->cachedIncludes->next;
+    }
+} // ReleaseIncludeFiles
+
+static unsigned int HashIncludeText(const char *data, unsigned int size)
+{
+    unsigned int hash = 2166136261u, ii;
+    for (ii = 0; ii < size; ii++)
+        hash = (hash ^ (unsigned char) data[ii])*16777619u;
+    return hash;
+} // HashIncludeText
+
+/* RecordIncludeFile ---
+ ** tokenize the text of an included file into a TokenStream
+ */
+static void RecordIncludeFile(TokenStream *ts, char *text)
+{
+    yystypepp lval;
+    InputSrc eof, *src;
+    int token, line;
+
+    PushEofSrc(&eof);
+    ScanFromString(text);
+    src = cpp->currentInput;
+    for (;;) {
+        line = src->line;
+        token = cpp->currentInput->scan(cpp->currentInput, &lval);
+        if (token <= 0)
+            break;
+        RecordToken(ts, token, &lval);
+        // A comment spanning lines comes back as a single newline; record
+        // the rest so that replaying keeps the line numbers.
+        if (token == '\n') {
+            for (line++; line < src->line; line++)
+                RecordToken(ts, '\n', &lval);
+        }
+    }
+    // Drop whatever the scan left above the EOF source.
+    cpp->currentInput = eof.prev;
+} // RecordIncludeFile
+
+static int scan_include(IncludeInputSrc *in, yystypepp * yylvalpp)
+{
+    int token = ReadTokenAt(&in->cursor, yylvalpp);
+    if (token == '\n') {
+        in->base.line++;
+        IncLineNumber();
+        return token;
+    }
+    if (token > 0) return token;
+    ReleaseIncludeFile(in);
+    cpp->includeDepth--;
+    SetLineNumber(in->includer);
+    cpp->currentInput = in->base.prev;
+    return cpp->currentInput->scan(cpp->currentInput, yylvalpp);
+} // scan_include
+
+/* LookUpIncludeFile ---
+ ** find the token stream for an included file, recording it if the cache
+ ** has no current copy
+ */
+static IncludeInputSrc *LookUpIncludeFile(const char *name, const char *data, unsigned int size)
+{
+    IncludeInputSrc *in;
+    IncludeCacheEntry *entry, **link;
+    TokenStream *tokens;
+    unsigned int hash;
+    char *text;
+    int errors;
+
+    in = mem_Alloc(cpp->pool, sizeof(IncludeInputSrc));
+    memset(in, 0, sizeof(IncludeInputSrc));
+
+    hash = HashIncludeText(data, size);
+    CPPLockIncludeCache();
+    entry = FindIncludeFile(name, data, size, hash);
+    if (entry)
+        HoldIncludeFile(in, entry);
+    CPPUnlockIncludeCache();
+    if (entry)
+        return in;
+
+    // Tokenize without the lock, so compiles on other threads do not wait
+    // for it.
+    text = mem_Alloc(cpp->pool, size + 1);
+    if (size)
+        memcpy(text, data, size);
+    text[size] = '\0';
+    errors = CPPErrorCount();
+    tokens = NewTokenStream(name, 0);
+    RecordIncludeFile(tokens, text);
+
+    // A file that does not scan cleanly is not cached, so that its errors
+    // are reported again by the next compile that includes it.
+    if (CPPErrorCount() != errors) {
+        in->tokens = tokens;
+        tokens->next = cpp->privateIncludes;
+        cpp->privateIncludes = tokens;
+        return in;
+    }
+
+    CPPLockIncludeCache();
+    // Another compile may have cached the same contents meanwhile.
+    entry = FindIncludeFile(name, data, size, hash);
+    if (entry) {
+        DeleteTokenStream(tokens);
+        HoldIncludeFile(in, entry);
+        CPPUnlockIncludeCache();
+        return in;
+    }
+
+    // Replace the stream of the file's earlier contents, or keep it for the
+    // compiles still replaying it.
+    for (link = &includeCache; *link; link = &(*link)->next) {
+        if (!strcmp((*link)->name, name))
+            break;
+    }
+    entry = *link;
+    if (entry && entry->users) {
+        *link = entry->next;
+        entry->retired = 1;
+        entry = NULL;
+    }
+    if (entry) {
+        DeleteTokenStream(entry->tokens);
+        free(entry->text);
+    } else {
+        entry = malloc(sizeof(IncludeCacheEntry));
+        entry->name = malloc(strlen(name) + 1);
+        strcpy(entry->name, name);
+        entry->users = 0;
+        entry->retired = 0;
+        entry->next = includeCache;
+        includeCache = entry;
+    }
+    entry->text = malloc(size + 1);
+    memcpy(entry->text, text, size + 1);
+    entry->size = size;
+    entry->hash = hash;
+    entry->tokens = tokens;
+    HoldIncludeFile(in, entry);
+    CPPUnlockIncludeCache();
+    return in;
+} // LookUpIncludeFile
+
+void FreeIncludeCache(void)
+{
+    IncludeCacheEntry *entry;
+    CPPLockIncludeCache();
+    while (includeCache) {
+        entry = includeCache;
+        includeCache = entry->next;
+        DeleteIncludeCacheEntry(entry);
+    }
+    CPPUnlockIncludeCache();
+} // FreeIncludeCache
+
+static int CPPinclude(yystypepp * yylvalpp)
+{
+    char name[MAX_STRING_LEN + 1];
+    const char *includer, *data, *message;
+    unsigned int size;
+    int token, len = 0, isSystem = 0, found;
+    IncludeInputSrc *in;
+    TSourceLoc line, resume;
+
+    token = cpp->currentInput->scan(cpp->currentInput, yylvalpp);
+    if (token == CPP_STRCONSTANT) {
+        // The string keeps its quotes.
+        const char *str = GetStringOfAtom(atable, yylvalpp->sc_ident);
+        len = (int) strlen(str) - 2;
+        if (len > 0)
+            memcpy(name, str + 1, len);
+        token = cpp->currentInput->scan(cpp->currentInput, yylvalpp);
+    } else if (token == '<') {
+        // <file> is not a single token; paste the pieces back together.
+        isSystem = 1;
+        token = cpp->currentInput->scan(cpp->currentInput, yylvalpp);
+        while (token != '>' && token != '\n' && token > 0) {
+            const char *str;
+            if (token == CPP_IDENTIFIER || token == CPP_STRCONSTANT)
+                str = GetStringOfAtom(atable, yylvalpp->sc_ident);
+            else if (token == CPP_INTCONSTANT || token == CPP_FLOATCONSTANT)
+                str = yylvalpp->symbol_name;
+            else
+                str = GetStringOfAtom(atable, token);
+            while (*str && len < MAX_STRING_LEN)
+                name[len++] = *str++;
+            token = cpp->currentInput->scan(cpp->currentInput, yylvalpp);
+        }
+        if (token == '>')
+            token = cpp->currentInput->scan(cpp->currentInput, yylvalpp);
+        else
+            len = 0;
+    }
+    name[len > 0 ? len : 0] = '\0';
+    if (len <= 0) {
+        CPPErrorToInfoLog("#include");
+        return token;
+    }
+    if (token != '\n') {
+        CPPWarningToInfoLog("unexpected tokens following #include preprocessor directive - expected a newline");
+        while (token != '\n' && token > 0)
+            token = cpp->currentInput->scan(cpp->currentInput, yylvalpp);
+    }
+    if (token != '\n')
+        return token;
+
+    if (cpp->includeDepth >= MAX_INCLUDE_DEPTH) {
+        CPPErrorToInfoLog("#include nested too deeply");
+        return token;
+    }
+    includer = GetLineNumber().file;
+    found = CPPOpenInclude(isSystem, name, includer, &data, &size);
+    if (found <= 0) {
+        StoreStr(found < 0 ? "#include used without an include handler: " : "Include file not found: ");
+        StoreStr(name);
+        message=GetStrfromTStr();
+        DecLineNumber();
+        CPPShInfoLogMsg(message);
+        IncLineNumber();
+        ResetTString();
+        return token;
+    }
+
+    // The directive's newline has been read, so this is where the including
+    // file picks up again.  Scan errors while recording, and the replay,
+    // are reported against the included file.
+    resume = GetLineNumber();
+    line.file = name;
+    line.line = 1;
+    SetLineNumber(line);
+    in = LookUpIncludeFile(name, data, size);
+    CPPCloseInclude(data);
+    SetLineNumber(line);
+
+    in->includer = resume;
+    in->base.scan = (int (*)(InputSrc *, yystypepp *))scan_include;
+    in->base.line = 1;
+    in->base.prev = cpp->currentInput;
+    RewindTokenCursor(in->tokens, &in->cursor);
+    cpp->currentInput = &in->base;
+    cpp->includeDepth++;
+    return token;
+} // CPPinclude
@@ -12,6 +12,7 @@ int InitCPP(void);
 int FinalCPP(void);
 int  readCPPline(yystypepp * yylvalpp);
 int MacroExpand(int atom, yystypepp * yylvalpp);
+int PredefineMacro(const char *name, const char *value);
 
 typedef struct MacroSymbol {
     int argc;
@@ -30,5 +31,12 @@ void  SetLineNumber(TSourceLoc line);// Set line number.
 const TSourceLoc GetLineNumber(void);// Get the current Line Number. 
 const char* GetStrfromTStr(void);           // Convert TString to String.  
 int   FreeCPP(void);
+void  FreeIncludeCache(void);               // Free token streams cached for #include.
+int   CPPOpenInclude(int isSystem, const char* fileName, const char* includerName,
+                     const char** data, unsigned int* size); // Ask the include handler for a file.
+void  CPPCloseInclude(const char* data);    // Release what CPPOpenInclude returned.
+int   CPPErrorCount(void);                  // Errors reported so far in this compile.
+void  CPPLockIncludeCache(void);            // Serialize access to the #include cache
+void  CPPUnlockIncludeCache(void);          // across threads.
 
 #endif // !(defined(__CPP_H)
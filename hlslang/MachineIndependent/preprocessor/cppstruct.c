@@ -7,7 +7,7 @@
 
 #include "slglobals.h"
 
-CPPStruct  *cpp      = NULL;
+CPP_THREAD_LOCAL CPPStruct  *cpp      = NULL;
 
 int InitPreprocessor(void);
 int FinalizePreprocessor(void);
@@ -23,11 +23,19 @@ static void InitCPPStruct(void)
 
 	cpp->pC=0;
     cpp->CompileError=0; 
+    cpp->includeDepth=0;
 	cpp->ifdepth=0;
     for(cpp->elsetracker=0; cpp->elsetracker<64; cpp->elsetracker++)
 		cpp->elsedepth[cpp->elsetracker]=0; 
 	cpp->elsetracker=0;
     cpp->tokensBeforeEOF = 0;
+    cpp->lastFloatValid = 0;
+    cpp->pool = NULL;
+    cpp->freeMacroInputs = NULL;
+    cpp->freeTokenInputs = NULL;
+    cpp->freeArgStreams = NULL;
+    cpp->privateIncludes = NULL;
+    cpp->cachedIncludes = NULL;
 } // InitCPPStruct
 
 
@@ -35,7 +43,7 @@ static void InitCPPStruct(void)
 int InitPreprocessor(void)
 {
 	InitCPPStruct();
-	if (!InitAtomTable(atable, 0))
+	if (!InitLocalAtomTable())
 		return 1;
 	if (!InitScanner(cpp))
 		return 1;
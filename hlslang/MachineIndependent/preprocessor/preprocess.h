@@ -3,5 +3,7 @@
 // found in the LICENSE.txt file.
 
 # include "slglobals.h"
-extern CPPStruct *cpp;
-int ScanFromString(char *s);
+extern CPP_THREAD_LOCAL CPPStruct *cpp;
+int ScanFromString(const char *s);
+int InitPreprocessor(void);
+int FinalizePreprocessor(void);
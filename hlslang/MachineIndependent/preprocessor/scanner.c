@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE.txt file.
 
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,13 +10,12 @@
 
 #include "slglobals.h"
 
-#define isinff(x) (((*(int *)&(x) & 0x7f800000L)==0x7f800000L) && ((*(int *)&(x) & 0x007fffffL)==0000000000L))
 
 
 
 typedef struct StringInputSrc {
     InputSrc base;
-    char *p;
+    const char *p;
 } StringInputSrc;
 
 static int eof_scan1(InputSrc *is)
@@ -48,17 +48,10 @@ int InitScanner(CPPStruct *cpp)
 
 int FreeScanner(CPPStruct *cpp)
 {
-	//fix memory leak
+	// Input sources still stacked after an error live in cpp->pool,
+	// which FreeCPP releases.
 	if (cpp)
-	{
-		while (cpp->currentInput != &eof_inputsrc)
-		{
-			InputSrc * in = cpp->currentInput;
-			cpp->currentInput = cpp->currentInput->prev;
-			free(in);
-		}
-	}
-	//end
+		cpp->currentInput = &eof_inputsrc;
 		
     return (FreeCPP());
 }
@@ -80,15 +73,16 @@ static int str_getch(InputSrc* arg)
 		return *in->p++;
 	}
 	cpp->currentInput = in->base.prev;
-	free(in);
 	return EOF;
 } // str_getch
 
 static void str_ungetch(InputSrc* arg, int ch) {
 	StringInputSrc* in = (StringInputSrc*)arg;
-    if (in->p[-1] == ch)in->p--;
+    if (ch != EOF && in->p[-1] == ch)in->p--;
 	else {
-		*(in->p)='\0'; //this would take care of shifting to the previous string.
+		// Not from this string: skip to its end so the previous input is
+		// read next.  The text itself is never written.
+		in->p += strlen(in->p);
 	}  
 	if (ch == '\n') {
         in->base.line--;
@@ -96,10 +90,13 @@ static void str_ungetch(InputSrc* arg, int ch) {
     }
 } // str_ungetch
 
-int ScanFromString(char *s)
+/*
+ * ScanFromString()
+ * The text is only read, never written.
+ */
+int ScanFromString(const char *s)
 {
-    
-	StringInputSrc *in = malloc(sizeof(StringInputSrc));
+	StringInputSrc *in = mem_Alloc(cpp->pool, sizeof(StringInputSrc));
     memset(in, 0, sizeof(StringInputSrc));
 	in->p = s;
     in->base.line = 1;
@@ -110,49 +107,290 @@ int ScanFromString(char *s)
     cpp->currentInput = &in->base;
 
     return 1;
-} // ScanFromString;
+} // ScanFromString
 
 // ------------------------------------------------------------------
 // Floating point constants
 
 
 /*
- * lBuildFloatValue() - Quick and dirty conversion to floating point.  Since all
- *         we need is single precision this should be quite precise.
+ * Float constants are converted exactly, rounding to the nearest single
+ * precision value (ties to even) the way a conforming strtof() would.  The
+ * conversion runs once per literal in the scanner; the lexer picks the value
+ * up from cpp->lastFloatValue instead of converting the text again.
+ *
+ * Most literals in shaders have few digits and a small exponent, so they are
+ * computed in double precision, which is exact for those inputs.  The rare
+ * literal whose double lands exactly between two floats, or that has too many
+ * digits or too large an exponent, is settled by comparing it against the
+ * halfway points of its neighbouring floats in big integer arithmetic.
  */
 
-static float lBuildFloatValue(const char *str, int len, int exp)
+#define FLOAT_MAX_DIGITS    120     // more than any halfway point between floats needs
+#define FLOAT_MAX_EXP2      104     // FLT_MAX == (2^24 - 1) * 2^104
+#define FLOAT_MIN_EXP2      -149    // smallest denormal == 1 * 2^-149
+#define FLOAT_HIDDEN_BIT    0x800000UL
+#define BIGNUM_LIMBS        80      // 16 bit limbs; 1280 bits covers every comparison
+
+typedef struct FloatBignum_Rec {
+    unsigned int limb[BIGNUM_LIMBS];
+    int len;
+} FloatBignum;
+
+static void lBigSetSmall(FloatBignum *bn, unsigned long val)
 {
-    double val, expval, ten;
-    int ii, llen, absexp;
-    float rv;
+    bn->len = 0;
+    while (val) {
+        bn->limb[bn->len++] = (unsigned int) (val & 0xffff);
+        val >>= 16;
+    }
+} // lBigSetSmall
 
+static void lBigMulAdd(FloatBignum *bn, unsigned int mul, unsigned int add)
+{
+    unsigned int carry = add;
+    int ii;
+
+    for (ii = 0; ii < bn->len; ii++) {
+        carry += bn->limb[ii]*mul;
+        bn->limb[ii] = carry & 0xffff;
+        carry >>= 16;
+    }
+    if (carry && bn->len < BIGNUM_LIMBS)
+        bn->limb[bn->len++] = carry;
+} // lBigMulAdd
+
+static void lBigMulPow5(FloatBignum *bn, int exp)
+{
+    for (; exp >= 6; exp -= 6)
+        lBigMulAdd(bn, 15625, 0);
+    if (exp > 0)
+        lBigMulAdd(bn, exp == 1 ? 5 : exp == 2 ? 25 : exp == 3 ? 125 : exp == 4 ? 625 : 3125, 0);
+} // lBigMulPow5
+
+static void lBigShiftLeft(FloatBignum *bn, int bits)
+{
+    int words = bits >> 4, ii;
+
+    bits &= 15;
+    if (bn->len == 0)
+        return;
+    if (bits) {
+        unsigned int carry = 0;
+        for (ii = 0; ii < bn->len; ii++) {
+            carry |= bn->limb[ii] << bits;
+            bn->limb[ii] = carry & 0xffff;
+            carry >>= 16;
+        }
+        if (carry && bn->len < BIGNUM_LIMBS)
+            bn->limb[bn->len++] = carry;
+    }
+    if (words) {
+        if (bn->len + words > BIGNUM_LIMBS)
+            words = BIGNUM_LIMBS - bn->len;
+        for (ii = bn->len - 1; ii >= 0; ii--)
+            bn->limb[ii + words] = bn->limb[ii];
+        for (ii = 0; ii < words; ii++)
+            bn->limb[ii] = 0;
+        bn->len += words;
+    }
+} // lBigShiftLeft
+
+static int lBigCompare(const FloatBignum *a, const FloatBignum *b)
+{
+    int ii;
+
+    if (a->len != b->len)
+        return a->len < b->len ? -1 : 1;
+    for (ii = a->len - 1; ii >= 0; ii--) {
+        if (a->limb[ii] != b->limb[ii])
+            return a->limb[ii] < b->limb[ii] ? -1 : 1;
+    }
+    return 0;
+} // lBigCompare
+
+/*
+ * lCompareDecimal() - Compare digits * 10^exp10 against half * 2^exp2.
+ */
+
+static int lCompareDecimal(const char *digits, int ndigits, int exp10, unsigned long half, int exp2)
+{
+    FloatBignum lhs, rhs;
+    int ii, chunk, scale;
+
+    lBigSetSmall(&lhs, 0);
+    for (ii = 0; ii < ndigits; ) {
+        chunk = 0;
+        scale = 1;
+        do {
+            chunk = chunk*10 + digits[ii++];
+            scale *= 10;
+        } while (ii < ndigits && scale < 10000);
+        lBigMulAdd(&lhs, scale, chunk);
+    }
+    lBigSetSmall(&rhs, half);
+
+    // 10^exp10 == 5^exp10 * 2^exp10; keep both sides integral.
+    if (exp10 >= 0)
+        lBigMulPow5(&lhs, exp10);
+    else
+        lBigMulPow5(&rhs, -exp10);
+    if (exp10 > exp2)
+        lBigShiftLeft(&lhs, exp10 - exp2);
+    else
+        lBigShiftLeft(&rhs, exp2 - exp10);
+
+    return lBigCompare(&lhs, &rhs);
+} // lCompareDecimal
+
+/*
+ * CPPStringToFloat() - Convert the text of a float constant, digits with an
+ *         optional '.', exponent and suffix, to the nearest float.  Sets
+ *         *overflow when the value is too large for a float.
+ */
+
+float CPPStringToFloat(const char *str, int *overflow)
+{
+    char digits[FLOAT_MAX_DIGITS + 1];
+    int ndigits = 0, exp10 = 0, exp = 0, ExpSign = 1, truncated = 0;
+    int SeenPoint = 0, exact, exp2, ii, cmp;
+    unsigned long mant;
+    double val, scaled, frac;
+
+    if (overflow)
+        *overflow = 0;
+
+    // Collect significant digits, remembering where the decimal point was.
+    for (; (*str >= '0' && *str <= '9') || (*str == '.' && !SeenPoint); str++) {
+        if (*str == '.') {
+            SeenPoint = 1;
+        } else if (ndigits == 0 && *str == '0') {
+            if (SeenPoint)
+                exp10--;
+        } else if (ndigits < FLOAT_MAX_DIGITS) {
+            digits[ndigits++] = *str - '0';
+            if (SeenPoint)
+                exp10--;
+        } else {
+            if (*str != '0')
+                truncated = 1;
+            if (!SeenPoint)
+                exp10++;
+        }
+    }
+    if (*str == 'e' || *str == 'E') {
+        str++;
+        if (*str == '+') {
+            str++;
+        } else if (*str == '-') {
+            ExpSign = -1;
+            str++;
+        }
+        for (; *str >= '0' && *str <= '9'; str++) {
+            if (exp < 100000)
+                exp = exp*10 + *str - '0';
+        }
+        exp10 += exp*ExpSign;
+    }
+
+    // A nonzero tail beyond FLOAT_MAX_DIGITS only has to break ties.
+    if (truncated) {
+        digits[ndigits++] = 1;
+        exp10--;
+    }
+    while (ndigits > 0 && digits[ndigits - 1] == 0) {
+        ndigits--;
+        exp10++;
+    }
+
+    // Values under 10^-46 round to zero, values of 10^39 and up overflow.
+    if (ndigits == 0 || ndigits + exp10 < -45)
+        return 0.0f;
+    if (ndigits + exp10 > 39) {
+        if (overflow)
+            *overflow = 1;
+        return (float) HUGE_VAL;
+    }
+
+    // Up to 15 digits and 10^22 are exact in a double, so val is correctly
+    // rounded; otherwise it is only a first guess for the loop below.
+    exact = ndigits <= 15 && exp10 >= -22 && exp10 <= 22;
     val = 0.0;
-    llen = len;
-    for (ii = 0; ii < len; ii++)
-        val = val*10.0 + (str[ii] - '0');
+    for (ii = 0; ii < ndigits && ii < 17; ii++)
+        val = val*10.0 + digits[ii];
+    exp = exp10 + ndigits - ii;
     if (exp != 0) {
-        absexp = exp > 0 ? exp : -exp;
-        expval = 1.0f;
-        ten = 10.0;
+        double expval = 1.0, ten = 10.0;
+        int absexp = exp > 0 ? exp : -exp;
         while (absexp) {
             if (absexp & 1)
                 expval *= ten;
             ten *= ten;
             absexp >>= 1;
         }
-        if (exp >= 0) {
-            val *= expval;
-        } else {
-            val /= expval;
-        }
+        val = exp > 0 ? val*expval : val/expval;
+    }
+
+    // Split val into a 24 bit mantissa and a power of two, like a float.
+    frexp(val, &exp2);
+    exp2 -= 24;
+    if (exp2 < FLOAT_MIN_EXP2)
+        exp2 = FLOAT_MIN_EXP2;
+    scaled = ldexp(val, -exp2);
+    mant = (unsigned long) scaled;
+    frac = scaled - (double) mant;
+    if (frac > 0.5 || (frac == 0.5 && !exact))
+        mant++;
+    if (mant == FLOAT_HIDDEN_BIT << 1) {
+        mant = FLOAT_HIDDEN_BIT;
+        exp2++;
     }
-    rv = (float)val;
-    if (isinff(rv)) {
-		CPPErrorToInfoLog(" ERROR___FP_CONST_OVERFLOW");
+    if (exp2 > FLOAT_MAX_EXP2) {
+        mant = (FLOAT_HIDDEN_BIT << 1) - 1;
+        exp2 = FLOAT_MAX_EXP2;
+    }
+
+    // A double exactly halfway between two floats may have been rounded
+    // there, so only then is the exact answer needed in the fast case.
+    if (!exact || frac == 0.5) {
+        for (;;) {
+            // Step up while the value is above the upper halfway point.
+            cmp = lCompareDecimal(digits, ndigits, exp10, 2*mant + 1, exp2 - 1);
+            if (cmp > 0 || (cmp == 0 && (mant & 1))) {
+                mant++;
+                if (mant == FLOAT_HIDDEN_BIT << 1) {
+                    mant = FLOAT_HIDDEN_BIT;
+                    exp2++;
+                    if (exp2 > FLOAT_MAX_EXP2) {
+                        if (overflow)
+                            *overflow = 1;
+                        return (float) HUGE_VAL;
+                    }
+                }
+                continue;
+            }
+            if (mant == 0)
+                break;
+            // Step down while it is below the lower one, which sits closer
+            // when mant is a power of two.
+            if (mant == FLOAT_HIDDEN_BIT && exp2 > FLOAT_MIN_EXP2)
+                cmp = lCompareDecimal(digits, ndigits, exp10, 4*mant - 1, exp2 - 2);
+            else
+                cmp = lCompareDecimal(digits, ndigits, exp10, 2*mant - 1, exp2 - 1);
+            if (cmp < 0 || (cmp == 0 && (mant & 1))) {
+                mant--;
+                if (mant == FLOAT_HIDDEN_BIT - 1 && exp2 > FLOAT_MIN_EXP2) {
+                    mant = (FLOAT_HIDDEN_BIT << 1) - 1;
+                    exp2--;
+                }
+                continue;
+            }
+            break;
+        }
     }
-    return rv;
-} // lBuildFloatValue
+
+    return (float) ldexp((double) mant, exp2);
+} // CPPStringToFloat
 
 
 /*
@@ -163,30 +401,25 @@ static float lBuildFloatValue(const char *str, int len, int exp)
 
 static int lFloatConst(char *str, int len, int ch, yystypepp * yylvalpp)
 {
-    int HasDecimal, declen, exp, ExpSign;
-    int str_len;
+    int HasDecimal, overflow;
     float lval;
     
     HasDecimal = 0;
-    declen = 0;
-    exp = 0;
 	
-    str_len=len;
     if (ch == '.') {
 		str[len++]=ch;
         HasDecimal = 1;
         ch = cpp->currentInput->getch(cpp->currentInput);
         while (ch >= '0' && ch <= '9') {
             if (len < MAX_SYMBOL_NAME_LEN) {
-                declen++;
                 if (len > 0 || ch != '0') {
                     str[len] = ch;
-                    len++;str_len++;
+                    len++;
                 }
                 ch = cpp->currentInput->getch(cpp->currentInput);
             } else {
                 CPPErrorToInfoLog("ERROR___FP_CONST_TOO_LONG");
-                len = 1,str_len=1;
+                len = 1;
             }
         }
     }
@@ -194,27 +427,23 @@ static int lFloatConst(char *str, int len, int ch, yystypepp * yylvalpp)
     // Exponent:
 
     if (ch == 'e' || ch == 'E') {
-        ExpSign = 1;
 		str[len++]=ch;
         ch = cpp->currentInput->getch(cpp->currentInput);
         if (ch == '+') {
             str[len++]=ch;  
 			ch = cpp->currentInput->getch(cpp->currentInput);
         } else if (ch == '-') {
-            ExpSign = -1;
 			str[len++]=ch;
             ch = cpp->currentInput->getch(cpp->currentInput);
         }
         if (ch >= '0' && ch <= '9') {
             while (ch >= '0' && ch <= '9') {
-                exp = exp*10 + ch - '0';
 				str[len++]=ch;
                 ch = cpp->currentInput->getch(cpp->currentInput);
             }
         } else {
             CPPErrorToInfoLog("ERROR___ERROR_IN_EXPONENT");
         }
-        exp *= ExpSign;
     }
       
     if (len == 0) {
@@ -222,7 +451,9 @@ static int lFloatConst(char *str, int len, int ch, yystypepp * yylvalpp)
 		strcpy(str,"0.0");
     } else {
         str[len]='\0';      
-        lval = lBuildFloatValue(str, str_len, exp - declen);
+        lval = CPPStringToFloat(str, &overflow);
+        if (overflow)
+            CPPErrorToInfoLog("ERROR___FP_CONST_OVERFLOW");
     }
     // Suffix:
     if ( ch == 'h' || ch == 'H' || ch == 'f' || ch == 'F' ) {
@@ -687,10 +918,14 @@ int yylex_CPP(char* buf, int maxSize)
         if (tokenString) {
             if ((signed)strlen(tokenString) >= maxSize) {
                 cpp->tokensBeforeEOF = 1;
+                cpp->lastFloatValid = 0;
                 return maxSize;               
             } else  if (strlen(tokenString) > 0) {
 			    strcpy(buf, tokenString);
                 cpp->tokensBeforeEOF = 1;
+                cpp->lastFloatValid = token == CPP_FLOATCONSTANT;
+                if (cpp->lastFloatValid)
+                    cpp->lastFloatValue = yylvalpp.sc_fval;
                 return (int)strlen(tokenString);
             }  
 
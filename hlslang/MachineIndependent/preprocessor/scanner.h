@@ -30,9 +30,10 @@ typedef struct InputSrc {
 } InputSrc;
 
 int InitScanner(CPPStruct *cpp);   // Intialise the cpp scanner. 
-int ScanFromString(char *);      // Start scanning the input from the string mentioned.
+int ScanFromString(const char *);      // Start scanning the input from the string mentioned.
 int check_EOF(int);              // check if we hit a EOF abruptly 
 void CPPErrorToInfoLog(char *);   // sticking the msg,line into the Shader's.Info.log
+float CPPStringToFloat(const char *str, int *overflow); // exact conversion of a float constant's text
 void SetLineNumber(TSourceLoc line);
 void IncLineNumber(void);
 void DecLineNumber(void);
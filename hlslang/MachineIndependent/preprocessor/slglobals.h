@@ -5,9 +5,17 @@
 #if !defined(__SLGLOBALS_H)
 #define __SLGLOBALS_H 1
 
+// The preprocessor keeps its state per thread, so that shaders can be
+// compiled on several threads at once.
+#if defined(_MSC_VER)
+#define CPP_THREAD_LOCAL __declspec(thread)
+#else
+#define CPP_THREAD_LOCAL __thread
+#endif
+
 typedef struct CPPStruct_Rec CPPStruct;
 
-extern CPPStruct *cpp;
+extern CPP_THREAD_LOCAL CPPStruct *cpp;
 
 #include "memory.h"
 #include "atom.h"
@@ -50,7 +50,8 @@ StreamType& operator<<(StreamType& s, const TSourceLoc& l)
     return(s);
 } 
 
-inline void OutputLineDirective(std::stringstream& s, const TSourceLoc& l)
+template<typename StreamType>
+inline void OutputLineDirective(StreamType& s, const TSourceLoc& l)
 {
 	s << "#line " << l.line;
 	
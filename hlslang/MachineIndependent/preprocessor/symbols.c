@@ -11,13 +11,18 @@
 
 
 
+#define SCOPE_INITIAL_SIZE 64
+
 Scope *NewScopeInPool(MemoryPool *pool)
 {
     Scope *lScope;
 
     lScope = mem_Alloc(pool, sizeof(Scope));
     lScope->pool = pool;
-    lScope->symbols = NULL;
+    lScope->size = SCOPE_INITIAL_SIZE;
+    lScope->count = 0;
+    lScope->symbols = mem_Alloc(pool, sizeof(Symbol *)*SCOPE_INITIAL_SIZE);
+    memset(lScope->symbols, 0, sizeof(Symbol *)*SCOPE_INITIAL_SIZE);
     return lScope;
 } // NewScopeInPool
 
@@ -34,8 +39,6 @@ Symbol *NewSymbol(SourceLoc *loc, Scope *fScope, int name)
     int ii;
 
     lSymb = (Symbol *) mem_Alloc(fScope->pool, sizeof(Symbol));
-    lSymb->left = NULL;
-    lSymb->right = NULL;
     lSymb->next = NULL;
     lSymb->name = name;
     lSymb->loc = *loc;
@@ -49,43 +52,44 @@ Symbol *NewSymbol(SourceLoc *loc, Scope *fScope, int name)
 
 
 
-// Using a binary tree is not a good idea for basic atom values because they
-// are generated in order.  We'll fix this later (by reversing the bit pattern).
-static void lAddToTree(Symbol **fSymbols, Symbol *fSymb)
+// Atoms are handed out sequentially, so spread them over the table with a
+// multiplicative hash.
+static int lHashLoc(Scope *fScope, int atom)
 {
-    Symbol *lSymb;
-    int lrev, frev;
-
-    lSymb = *fSymbols;
-    if (lSymb) {
-        frev = GetReversedAtom(atable, fSymb->name);
-        while (lSymb) {
-            lrev = GetReversedAtom(atable, lSymb->name);
-            if (lrev == frev) {
-                CPPErrorToInfoLog("GetAtomString(atable, fSymb->name)");
-                break;
-            } else {
-                if (lrev > frev) {
-                    if (lSymb->left) {
-                        lSymb = lSymb->left;
-                    } else {
-                        lSymb->left = fSymb;
-                        break;
-                    }
-                } else {
-                    if (lSymb->right) {
-                        lSymb = lSymb->right;
-                    } else {
-                        lSymb->right = fSymb;
-                        break;
-                    }
-                }
-            }
-        }
-    } else {
-        *fSymbols = fSymb;
+    return (int) (((unsigned int) atom*2654435761u) & (unsigned int) (fScope->size - 1));
+} // lHashLoc
+
+
+
+// Find the slot holding "atom", or the empty slot where it would go.
+static int lFindLoc(Scope *fScope, int atom)
+{
+    int loc;
+
+    loc = lHashLoc(fScope, atom);
+    while (fScope->symbols[loc] && fScope->symbols[loc]->name != atom)
+        loc = (loc + 1) & (fScope->size - 1);
+    return loc;
+} // lFindLoc
+
+
+
+// Double the table.  The old one stays in the pool until the scope is freed.
+static void lGrowTable(Scope *fScope)
+{
+    Symbol **oldSymbols;
+    int oldSize, ii;
+
+    oldSymbols = fScope->symbols;
+    oldSize = fScope->size;
+    fScope->size = oldSize*2;
+    fScope->symbols = mem_Alloc(fScope->pool, sizeof(Symbol *)*fScope->size);
+    memset(fScope->symbols, 0, sizeof(Symbol *)*fScope->size);
+    for (ii = 0; ii < oldSize; ii++) {
+        if (oldSymbols[ii])
+            fScope->symbols[lFindLoc(fScope, oldSymbols[ii]->name)] = oldSymbols[ii];
     }
-} // lAddToTree
+} // lGrowTable
 
 
 
@@ -93,9 +97,18 @@ static void lAddToTree(Symbol **fSymbols, Symbol *fSymb)
 Symbol *AddSymbol(SourceLoc *loc, Scope *fScope, int atom)
 {
     Symbol *lSymb;
+    int hashloc;
 
     lSymb = NewSymbol(loc, fScope, atom);
-    lAddToTree(&fScope->symbols, lSymb);
+    if (2*(fScope->count + 1) > fScope->size)
+        lGrowTable(fScope);
+    hashloc = lFindLoc(fScope, atom);
+    if (fScope->symbols[hashloc]) {
+        CPPErrorToInfoLog("GetAtomString(atable, fSymb->name)");
+    } else {
+        fScope->symbols[hashloc] = lSymb;
+        fScope->count++;
+    }
     return lSymb;
 } // AddSymbol
 
@@ -103,22 +116,5 @@ Symbol *AddSymbol(SourceLoc *loc, Scope *fScope, int atom)
 
 Symbol *LookUpSymbol(Scope *fScope, int atom)
 {
-    Symbol *lSymb;
-    int rname, ratom;
-
-    ratom = GetReversedAtom(atable, atom);
-    lSymb = fScope->symbols;
-    while (lSymb) {
-        rname = GetReversedAtom(atable, lSymb->name);
-        if (rname == ratom) {
-            return lSymb;
-        } else {
-            if (rname > ratom) {
-                lSymb = lSymb->left;
-            } else {
-                lSymb = lSymb->right;
-            }
-        }
-    }
-    return NULL;
+    return fScope->symbols[lFindLoc(fScope, atom)];
 } // LookUpSymbol
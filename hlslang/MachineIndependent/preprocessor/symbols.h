@@ -19,16 +19,17 @@ typedef struct SymbolList_Rec {
 
 struct Scope_Rec {
     MemoryPool *pool;       // pool used for allocation in this scope
-    Symbol *symbols;
+    Symbol **symbols;       // open addressing hash table keyed by name atom
+    int size;               // number of slots, a power of two
+    int count;              // number of symbols in the table
 };
 
 
-// Symbol table is a simple binary tree.
+// Symbol table is a hash table with linear probing.
 
 #include "cpp.h"        // to get MacroSymbol def
 
 struct Symbol_Rec {
-    Symbol *left, *right;
     Symbol *next;
     int name;       // Name atom
     SourceLoc loc;
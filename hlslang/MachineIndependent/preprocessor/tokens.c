@@ -66,28 +66,34 @@ static void lAddByte(TokenStream *fTok, unsigned char fVal)
 {
     TokenBlockStruct *lBlock;
     lBlock = fTok->current;
-    if (lBlock->count >= lBlock->max)
-        lBlock = lNewBlock(fTok, 0);
+    if (lBlock->count >= lBlock->max) {
+        if (lBlock->next) {
+            // Left over from before the stream was cleared.
+            lBlock = lBlock->next;
+            fTok->current = lBlock;
+        } else {
+            lBlock = lNewBlock(fTok, fTok->pool);
+        }
+    }
     lBlock->data[lBlock->count++] = fVal;
 } // lAddByte
 
 
 
-static int lReadByte(TokenStream *pTok)
+static int lReadByte(TokenCursor *cursor)
 {
     TokenBlockStruct *lBlock;
     int lval = -1;
 
-    lBlock = pTok->current;
+    lBlock = cursor->block;
     if (lBlock) {
-        if (lBlock->current >= lBlock->count) {
+        if (cursor->offset >= lBlock->count) {
             lBlock = lBlock->next;
-            if (lBlock)
-                lBlock->current = 0;
-            pTok->current = lBlock;
+            cursor->offset = 0;
+            cursor->block = lBlock;
         }
-        if (lBlock)
-            lval = lBlock->data[lBlock->current++];
+        if (lBlock && cursor->offset < lBlock->count)
+            lval = lBlock->data[cursor->offset++];
     }
     return lval;
 } // lReadByte
@@ -106,7 +112,7 @@ static int lPeekByte(TokenStream *pTok)
 	if (lBlock) {
 		if (lBlock->current >= lBlock->count) {
 			lBlock = lBlock->next;
-			if (lBlock)
+			if (lBlock && lBlock->count > 0)
 				lval = lBlock->data[0];
 		}
 		else if (lBlock)
@@ -131,6 +137,7 @@ TokenStream *NewTokenStream(const char *name, MemoryPool *pool)
         pTok = (TokenStream*)mem_Alloc(pool, sizeof(TokenStream));
     pTok->next = NULL;
     pTok->name = idstr(name, pool);
+    pTok->pool = pool;
     pTok->head = NULL;
     pTok->current = NULL;
     lNewBlock(pTok, pool);
@@ -158,6 +165,21 @@ void DeleteTokenStream(TokenStream *pTok)
 
 
 
+// Empty a token stream for recording again.  Its blocks are kept and
+// refilled in order.
+void ClearTokenStream(TokenStream *pTok)
+{
+    TokenBlockStruct *pBlock;
+
+    for (pBlock = pTok->head; pBlock; pBlock = pBlock->next) {
+        pBlock->count = 0;
+        pBlock->current = 0;
+    }
+    pTok->current = pTok->head;
+} // ClearTokenStream
+
+
+
 // Add a token to the end of a list for later playback or printout.
 void RecordToken(TokenStream *pTok, int token, yystypepp * yylvalpp)
 {
@@ -215,14 +237,40 @@ int PeekTokenType(TokenStream *pTok)
 }
 
 
+// Reset a cursor to the start of a token stream.
+void RewindTokenCursor(TokenStream *pTok, TokenCursor *cursor)
+{
+    cursor->block = pTok->head;
+    cursor->offset = 0;
+} // RewindTokenCursor
+
+
+
+// Read a token at the stream's own position.
 int ReadToken(TokenStream *pTok, yystypepp * yylvalpp)
+{
+    TokenCursor cursor;
+    int token;
+
+    cursor.block = pTok->current;
+    cursor.offset = cursor.block ? cursor.block->current : 0;
+    token = ReadTokenAt(&cursor, yylvalpp);
+    pTok->current = cursor.block;
+    if (cursor.block)
+        cursor.block->current = cursor.offset;
+    return token;
+} // ReadToken
+
+
+
+int ReadTokenAt(TokenCursor *cursor, yystypepp * yylvalpp)
 {
     char symbol_name[MAX_SYMBOL_NAME_LEN + 1];
     char string_val[MAX_STRING_LEN + 1];
     int ltoken, len;
     char ch;
 
-    ltoken = lReadByte(pTok);
+    ltoken = lReadByte(cursor);
     if (ltoken >= 0) {
         if (ltoken > 127)
             ltoken += 128;
@@ -230,7 +278,7 @@ int ReadToken(TokenStream *pTok, yystypepp * yylvalpp)
         case CPP_IDENTIFIER:
         case CPP_TYPEIDENTIFIER:
             len = 0;
-            ch = lReadByte(pTok);
+            ch = lReadByte(cursor);
             while ((ch >= 'a' && ch <= 'z') ||
                      (ch >= 'A' && ch <= 'Z') ||
                      (ch >= '0' && ch <= '9') ||
@@ -239,7 +287,7 @@ int ReadToken(TokenStream *pTok, yystypepp * yylvalpp)
                 if (len < MAX_SYMBOL_NAME_LEN) {
                     symbol_name[len] = ch;
                     len++;
-                    ch = lReadByte(pTok);
+                    ch = lReadByte(cursor);
                 }
             }
             symbol_name[len] = '\0';
@@ -249,7 +297,7 @@ int ReadToken(TokenStream *pTok, yystypepp * yylvalpp)
             break;
         case CPP_STRCONSTANT:
             len = 0;
-            while ((ch = lReadByte(pTok)) != 0)
+            while ((ch = lReadByte(cursor)) != 0)
                 if (len < MAX_STRING_LEN)
                     string_val[len++] = ch;
             string_val[len] = 0;
@@ -257,30 +305,30 @@ int ReadToken(TokenStream *pTok, yystypepp * yylvalpp)
             break;
         case CPP_FLOATCONSTANT:
             len = 0;
-            ch = lReadByte(pTok);
+            ch = lReadByte(cursor);
             while ((ch >= '0' && ch <= '9')||(ch=='e'||ch=='E'||ch=='.')||(ch=='+'||ch=='-') ||
                 (ch=='f'||ch=='h'))
             {
                 if (len < MAX_SYMBOL_NAME_LEN) {
                     symbol_name[len] = ch;
                     len++;
-                    ch = lReadByte(pTok);
+                    ch = lReadByte(cursor);
                 }
             }
             symbol_name[len] = '\0';
             assert(ch == '\0');
             strcpy(yylvalpp->symbol_name,symbol_name);
-            yylvalpp->sc_fval=(float)atof(yylvalpp->symbol_name);
+            yylvalpp->sc_fval=CPPStringToFloat(yylvalpp->symbol_name, NULL);
             break;
         case CPP_INTCONSTANT:
             len = 0;
-            ch = lReadByte(pTok);
+            ch = lReadByte(cursor);
             while ((ch >= '0' && ch <= '9'))
             {
                 if (len < MAX_SYMBOL_NAME_LEN) {
                     symbol_name[len] = ch;
                     len++;
-                    ch = lReadByte(pTok);
+                    ch = lReadByte(cursor);
                 }
             }
             symbol_name[len] = '\0';
@@ -289,13 +337,13 @@ int ReadToken(TokenStream *pTok, yystypepp * yylvalpp)
             yylvalpp->sc_int=atoi(yylvalpp->symbol_name);
             break;
         case '(':
-            yylvalpp->sc_int = lReadByte(pTok);
+            yylvalpp->sc_int = lReadByte(cursor);
             break;
         }
         return ltoken;
     }
     return EOF_SY;
-} // ReadToken
+} // ReadTokenAt
 
 
 typedef struct TokenInputSrc {
@@ -316,14 +364,22 @@ static int scan_token(TokenInputSrc *in, yystypepp * yylvalpp)
     if (token > 0) return token;
     cpp->currentInput = in->base.prev;
     final = in->final;
-    free(in);
+    in->base.prev = cpp->freeTokenInputs;
+    cpp->freeTokenInputs = &in->base;
     if (final && !final(cpp)) return -1;
     return cpp->currentInput->scan(cpp->currentInput, yylvalpp);
 }
 
 int ReadFromTokenStream(TokenStream *ts, int (*final)(CPPStruct *))
 {
-    TokenInputSrc *in = malloc(sizeof(TokenInputSrc));
+    TokenInputSrc *in;
+
+    if (cpp->freeTokenInputs) {
+        in = (TokenInputSrc *) cpp->freeTokenInputs;
+        cpp->freeTokenInputs = in->base.prev;
+    } else {
+        in = mem_Alloc(cpp->pool, sizeof(TokenInputSrc));
+    }
     memset(in, 0, sizeof(TokenInputSrc));
     in->base.prev = cpp->currentInput;
     in->base.scan = (int (*)(InputSrc *, yystypepp *))scan_token;
@@ -346,12 +402,11 @@ static int reget_token(UngotToken *t, yystypepp * yylvalpp)
     int token = t->token;
     *yylvalpp = t->lval;
     cpp->currentInput = t->base.prev;
-    free(t);
     return token;
 }
 
 void UngetToken(int token, yystypepp * yylvalpp) {
-    UngotToken *t = malloc(sizeof(UngotToken));
+    UngotToken *t = mem_Alloc(cpp->pool, sizeof(UngotToken));
     memset(t, 0, sizeof(UngotToken));
     t->token = token;
     t->lval = *yylvalpp;
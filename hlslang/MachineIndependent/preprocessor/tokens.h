@@ -14,6 +14,7 @@ typedef struct TokenBlock_Rec TokenBlockStruct;
 typedef struct TokenStream_Rec {
     struct TokenStream_Rec *next;
     char *name;
+    MemoryPool *pool;           // blocks come from here, or malloc if NULL
     TokenBlockStruct *head;
     TokenBlockStruct *current;
 } TokenStream;
@@ -26,13 +27,24 @@ struct TokenBlock_Rec {
     unsigned char *data;
 };
 
+// A read position of its own in a token stream, so that streams shared by
+// several readers at once, such as cached #include files, are not changed
+// by reading them.
+typedef struct TokenCursor_Rec {
+    TokenBlockStruct *block;
+    int offset;
+} TokenCursor;
+
 
 TokenStream *NewTokenStream(const char *name, MemoryPool *pool);
 void DeleteTokenStream(TokenStream *pTok); 
+void ClearTokenStream(TokenStream *pTok);
 void RecordToken(TokenStream *pTok, int token, yystypepp * yylvalpp);
 void RewindTokenStream(TokenStream *pTok);
 int PeekTokenType(TokenStream *pTok);
 int ReadToken(TokenStream *pTok, yystypepp * yylvalpp);
+void RewindTokenCursor(TokenStream *pTok, TokenCursor *cursor);
+int ReadTokenAt(TokenCursor *cursor, yystypepp * yylvalpp);
 int ReadFromTokenStream(TokenStream *pTok, int (*final)(CPPStruct *));
 void UngetToken(int, yystypepp * yylvalpp);
 
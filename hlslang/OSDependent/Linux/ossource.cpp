@@ -5,9 +5,20 @@
 //
 // This file contains the Linux specific functions
 //
+
+// 64 bit file offsets for OS_SeekFile, also on 32 bit builds.
+#define _FILE_OFFSET_BITS 64
+
 #include "osinclude.h"
 #include "InitializeDll.h"
 
+#include <stdio.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysinfo.h>
+#include <time.h>
+
 #if !(defined(linux))
 #error Trying to build a Linux specific file in a non-Linux build.
 #endif
@@ -76,8 +87,15 @@ OS_TLSIndex OS_AllocTLSIndex()
 		assert(0 && "OS_AllocTLSIndex(): Unable to allocate Thread Local Storage");
 		return 0;
 	}
-	else
-		return pPoolIndex;
+
+	//
+	// Key 0 doubles as OS_INVALID_TLS_INDEX, so leave it allocated and take
+	// the next one.
+	//
+	if (pPoolIndex == OS_INVALID_TLS_INDEX)
+		return OS_AllocTLSIndex();
+
+	return pPoolIndex;
 }
 
 
@@ -110,3 +128,164 @@ bool OS_FreeTLSIndex(OS_TLSIndex nIndex)
 	else
 		return false;
 }
+
+
+//
+// Memory Mapped Files
+//
+// The file is opened through stdio since MachineIndependent, which is on the
+// include path, has an empty unistd.h of its own.
+//
+bool OS_MapFile(OS_MappedFile& file, const char* path, size_t size, bool writable)
+{
+	file.stream = 0;
+	file.data = 0;
+	file.size = 0;
+
+	FILE* stream = fopen(path, writable ? "r+b" : "rb");
+	if (!stream && writable)
+		stream = fopen(path, "w+b");
+	if (!stream)
+		return false;
+
+	struct stat st;
+	if (fstat(fileno(stream), &st) != 0 || (!writable && st.st_size == 0))
+	{
+		fclose(stream);
+		return false;
+	}
+	if (writable && (size_t)st.st_size < size)
+	{
+		// Extend the file by writing its last byte.
+		if (fseek(stream, (long)size - 1, SEEK_SET) != 0 || fputc(0, stream) == EOF || fflush(stream) != 0)
+		{
+			fclose(stream);
+			return false;
+		}
+	}
+	if ((size_t)st.st_size > size)
+		size = (size_t)st.st_size;
+
+	void* data = mmap(0, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fileno(stream), 0);
+	if (data == MAP_FAILED)
+	{
+		fclose(stream);
+		return false;
+	}
+
+	file.stream = stream;
+	file.data = data;
+	file.size = size;
+	return true;
+}
+
+
+void OS_UnmapFile(OS_MappedFile& file)
+{
+	if (file.data)
+		munmap(file.data, file.size);
+	if (file.stream)
+		fclose(file.stream);
+	file.stream = 0;
+	file.data = 0;
+	file.size = 0;
+}
+
+
+bool OS_LockFile(OS_MappedFile& file)
+{
+	while (flock(fileno(file.stream), LOCK_EX) != 0)
+	{
+		if (errno != EINTR)
+			return false;
+	}
+	return true;
+}
+
+
+void OS_UnlockFile(OS_MappedFile& file)
+{
+	flock(fileno(file.stream), LOCK_UN);
+}
+
+
+bool OS_ReplaceFile(const char* from, const char* to)
+{
+	return rename(from, to) == 0;
+}
+
+bool OS_SeekFile(FILE* file, unsigned long long offset, int origin)
+{
+	return fseeko(file, (off_t)offset, origin) == 0;
+}
+
+unsigned long long OS_TellFile(FILE* file)
+{
+	return (unsigned long long)ftello(file);
+}
+
+
+//
+// Threads
+//
+struct OS_ThreadStart {
+	OS_ThreadFunction function;
+	void* arg;
+};
+
+static void* ThreadStart(void* arg)
+{
+	OS_ThreadStart start = *(OS_ThreadStart*)arg;
+	delete (OS_ThreadStart*)arg;
+	start.function(start.arg);
+	return NULL;
+}
+
+
+bool OS_CreateThread(OS_Thread& thread, OS_ThreadFunction function, void* arg)
+{
+	OS_ThreadStart* start = new OS_ThreadStart;
+	start->function = function;
+	start->arg = arg;
+	if (pthread_create(&thread, NULL, ThreadStart, start) != 0)
+	{
+		delete start;
+		return false;
+	}
+	return true;
+}
+
+
+void OS_JoinThread(OS_Thread& thread)
+{
+	pthread_join(thread, NULL);
+}
+
+
+int OS_GetProcessorCount()
+{
+	int count = get_nprocs();
+	return count > 0 ? count : 1;
+}
+
+
+// Numbered in the order threads first ask, starting at 1.
+unsigned OS_GetThreadId()
+{
+	static unsigned lastId = 0;
+	static __thread unsigned id = 0;
+	if (!id)
+		id = __sync_add_and_fetch(&lastId, 1);
+	return id;
+}
+
+
+//
+// Timing
+//
+double OS_GetTime()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
@@ -8,6 +8,7 @@
 
 #include <Carbon/Carbon.h>
 #include <pthread.h>
+#include <stdio.h>
 #include <strings.h>
 
 #define min(X,Y) ((X) < (Y) ? X : Y)
@@ -29,4 +30,68 @@ inline void*    OS_GetTLSValue(OS_TLSIndex nIndex)
     return pthread_getspecific(nIndex);
 }
 
+
+//
+// Memory Mapped Files
+//
+struct OS_MappedFile {
+    FILE* stream;
+    void* data;
+    size_t size;
+};
+
+bool OS_MapFile(OS_MappedFile& file, const char* path, size_t size, bool writable);
+void OS_UnmapFile(OS_MappedFile& file);
+bool OS_LockFile(OS_MappedFile& file);
+void OS_UnlockFile(OS_MappedFile& file);
+bool OS_ReplaceFile(const char* from, const char* to);
+bool OS_SeekFile(FILE* file, unsigned long long offset, int origin);
+unsigned long long OS_TellFile(FILE* file);
+
+
+//
+// Mutexes
+//
+typedef pthread_mutex_t OS_Mutex;
+#define OS_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+inline void OS_InitMutex(OS_Mutex& mutex) { pthread_mutex_init(&mutex, NULL); }
+inline void OS_DestroyMutex(OS_Mutex& mutex) { pthread_mutex_destroy(&mutex); }
+inline void OS_LockMutex(OS_Mutex& mutex) { pthread_mutex_lock(&mutex); }
+inline void OS_UnlockMutex(OS_Mutex& mutex) { pthread_mutex_unlock(&mutex); }
+
+
+//
+// Condition variables, waited on with an OS_Mutex held
+//
+typedef pthread_cond_t OS_Condition;
+#define OS_CONDITION_INITIALIZER PTHREAD_COND_INITIALIZER
+
+inline void OS_InitCondition(OS_Condition& condition) { pthread_cond_init(&condition, NULL); }
+inline void OS_DestroyCondition(OS_Condition& condition) { pthread_cond_destroy(&condition); }
+inline void OS_WaitCondition(OS_Condition& condition, OS_Mutex& mutex) { pthread_cond_wait(&condition, &mutex); }
+inline void OS_SignalCondition(OS_Condition& condition) { pthread_cond_signal(&condition); }
+inline void OS_BroadcastCondition(OS_Condition& condition) { pthread_cond_broadcast(&condition); }
+
+
+//
+// Threads
+//
+typedef pthread_t OS_Thread;
+typedef void (*OS_ThreadFunction)(void* arg);
+
+bool OS_CreateThread(OS_Thread& thread, OS_ThreadFunction function, void* arg);
+void OS_JoinThread(OS_Thread& thread);
+int  OS_GetProcessorCount();
+
+// A number identifying the calling thread, unlike any other thread's.
+unsigned OS_GetThreadId();
+
+
+//
+// Timing
+//
+// Seconds from an arbitrary start, from a clock that never goes backwards.
+double OS_GetTime();
+
 #endif // __OSINCLUDE_H
@@ -5,6 +5,14 @@
 
 #include "osinclude.h"
 
+#include <errno.h>
+#include <mach/mach_time.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysctl.h>
+
 
 //
 // Thread Local Storage Operations
@@ -44,3 +52,165 @@ bool OS_FreeTLSIndex(OS_TLSIndex nIndex)
 
 	return true;
 }
+
+
+//
+// Memory Mapped Files
+//
+// The file is opened through stdio since MachineIndependent, which is on the
+// include path, has an empty unistd.h of its own.
+//
+bool OS_MapFile(OS_MappedFile& file, const char* path, size_t size, bool writable)
+{
+    file.stream = 0;
+    file.data = 0;
+    file.size = 0;
+
+    FILE* stream = fopen(path, writable ? "r+b" : "rb");
+    if (!stream && writable)
+        stream = fopen(path, "w+b");
+    if (!stream)
+        return false;
+
+    struct stat st;
+    if (fstat(fileno(stream), &st) != 0 || (!writable && st.st_size == 0))
+    {
+        fclose(stream);
+        return false;
+    }
+    if (writable && (size_t)st.st_size < size)
+    {
+        // Extend the file by writing its last byte.
+        if (fseek(stream, (long)size - 1, SEEK_SET) != 0 || fputc(0, stream) == EOF || fflush(stream) != 0)
+        {
+            fclose(stream);
+            return false;
+        }
+    }
+    if ((size_t)st.st_size > size)
+        size = (size_t)st.st_size;
+
+    void* data = mmap(0, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fileno(stream), 0);
+    if (data == MAP_FAILED)
+    {
+        fclose(stream);
+        return false;
+    }
+
+    file.stream = stream;
+    file.data = data;
+    file.size = size;
+    return true;
+}
+
+
+void OS_UnmapFile(OS_MappedFile& file)
+{
+    if (file.data)
+        munmap(file.data, file.size);
+    if (file.stream)
+        fclose(file.stream);
+    file.stream = 0;
+    file.data = 0;
+    file.size = 0;
+}
+
+
+bool OS_LockFile(OS_MappedFile& file)
+{
+    while (flock(fileno(file.stream), LOCK_EX) != 0)
+    {
+        if (errno != EINTR)
+            return false;
+    }
+    return true;
+}
+
+
+void OS_UnlockFile(OS_MappedFile& file)
+{
+    flock(fileno(file.stream), LOCK_UN);
+}
+
+
+bool OS_ReplaceFile(const char* from, const char* to)
+{
+    return rename(from, to) == 0;
+}
+
+bool OS_SeekFile(FILE* file, unsigned long long offset, int origin)
+{
+    return fseeko(file, (off_t)offset, origin) == 0;
+}
+
+unsigned long long OS_TellFile(FILE* file)
+{
+    return (unsigned long long)ftello(file);
+}
+
+
+//
+// Threads
+//
+struct OS_ThreadStart {
+    OS_ThreadFunction function;
+    void* arg;
+};
+
+static void* ThreadStart(void* arg)
+{
+    OS_ThreadStart start = *(OS_ThreadStart*)arg;
+    delete (OS_ThreadStart*)arg;
+    start.function(start.arg);
+    return NULL;
+}
+
+
+bool OS_CreateThread(OS_Thread& thread, OS_ThreadFunction function, void* arg)
+{
+    OS_ThreadStart* start = new OS_ThreadStart;
+    start->function = function;
+    start->arg = arg;
+    if (pthread_create(&thread, NULL, ThreadStart, start) != 0)
+    {
+        delete start;
+        return false;
+    }
+    return true;
+}
+
+
+void OS_JoinThread(OS_Thread& thread)
+{
+    pthread_join(thread, NULL);
+}
+
+
+int OS_GetProcessorCount()
+{
+    int count = 0;
+    size_t length = sizeof(count);
+    if (sysctlbyname("hw.ncpu", &count, &length, NULL, 0) != 0 || count < 1)
+        return 1;
+    return count;
+}
+
+
+unsigned OS_GetThreadId()
+{
+    uint64_t id = 0;
+    pthread_threadid_np(NULL, &id);
+    return (unsigned)id;
+}
+
+
+//
+// Timing
+//
+double OS_GetTime()
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return (double)mach_absolute_time() * timebase.numer / timebase.denom * 1e-9;
+}
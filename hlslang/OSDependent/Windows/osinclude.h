@@ -37,4 +37,69 @@ inline void* OS_GetTLSValue(OS_TLSIndex nIndex)
 	return TlsGetValue(nIndex);
 }
 
+
+//
+// Memory Mapped Files
+//
+struct OS_MappedFile {
+	HANDLE file;
+	HANDLE mapping;
+	void* data;
+	size_t size;
+};
+
+bool OS_MapFile(OS_MappedFile& file, const char* path, size_t size, bool writable);
+void OS_UnmapFile(OS_MappedFile& file);
+bool OS_LockFile(OS_MappedFile& file);
+void OS_UnlockFile(OS_MappedFile& file);
+bool OS_ReplaceFile(const char* from, const char* to);
+bool OS_SeekFile(FILE* file, unsigned long long offset, int origin);
+unsigned long long OS_TellFile(FILE* file);
+
+
+//
+// Mutexes
+//
+typedef SRWLOCK OS_Mutex;
+#define OS_MUTEX_INITIALIZER SRWLOCK_INIT
+
+inline void OS_InitMutex(OS_Mutex& mutex) { InitializeSRWLock(&mutex); }
+inline void OS_DestroyMutex(OS_Mutex&) { }
+inline void OS_LockMutex(OS_Mutex& mutex) { AcquireSRWLockExclusive(&mutex); }
+inline void OS_UnlockMutex(OS_Mutex& mutex) { ReleaseSRWLockExclusive(&mutex); }
+
+
+//
+// Condition variables, waited on with an OS_Mutex held
+//
+typedef CONDITION_VARIABLE OS_Condition;
+#define OS_CONDITION_INITIALIZER CONDITION_VARIABLE_INIT
+
+inline void OS_InitCondition(OS_Condition& condition) { InitializeConditionVariable(&condition); }
+inline void OS_DestroyCondition(OS_Condition&) { }
+inline void OS_WaitCondition(OS_Condition& condition, OS_Mutex& mutex) { SleepConditionVariableSRW(&condition, &mutex, INFINITE, 0); }
+inline void OS_SignalCondition(OS_Condition& condition) { WakeConditionVariable(&condition); }
+inline void OS_BroadcastCondition(OS_Condition& condition) { WakeAllConditionVariable(&condition); }
+
+
+//
+// Threads
+//
+typedef HANDLE OS_Thread;
+typedef void (*OS_ThreadFunction)(void* arg);
+
+bool OS_CreateThread(OS_Thread& thread, OS_ThreadFunction function, void* arg);
+void OS_JoinThread(OS_Thread& thread);
+int  OS_GetProcessorCount();
+
+// A number identifying the calling thread, unlike any other thread's.
+unsigned OS_GetThreadId();
+
+
+//
+// Timing
+//
+// Seconds from an arbitrary start, from a clock that never goes backwards.
+double OS_GetTime();
+
 #endif // __OSINCLUDE_H
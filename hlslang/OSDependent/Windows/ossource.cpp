@@ -4,6 +4,9 @@
 
 
 #include "osinclude.h"
+
+#include <process.h>
+
 //
 // This file contains contains the window's specific functions
 //
@@ -54,3 +57,162 @@ bool OS_FreeTLSIndex(OS_TLSIndex nIndex)
 	else
 		return false;
 }
+
+
+//
+// Memory Mapped Files
+//
+bool OS_MapFile(OS_MappedFile& file, const char* path, size_t size, bool writable)
+{
+	file.file = INVALID_HANDLE_VALUE;
+	file.mapping = NULL;
+	file.data = 0;
+	file.size = 0;
+
+	HANDLE h = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+	                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+	                       writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (h == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER current;
+	if (!GetFileSizeEx(h, &current) || (!writable && current.QuadPart == 0))
+	{
+		CloseHandle(h);
+		return false;
+	}
+	if ((unsigned __int64)current.QuadPart > size)
+		size = (size_t)current.QuadPart;
+
+	// Mapping a writable view past the end of the file extends it.
+	LARGE_INTEGER mapSize;
+	mapSize.QuadPart = size;
+	HANDLE mapping = CreateFileMappingA(h, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+	                                    mapSize.HighPart, mapSize.LowPart, NULL);
+	void* data = mapping ? MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size) : NULL;
+	if (!data)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(h);
+		return false;
+	}
+
+	file.file = h;
+	file.mapping = mapping;
+	file.data = data;
+	file.size = size;
+	return true;
+}
+
+
+void OS_UnmapFile(OS_MappedFile& file)
+{
+	if (file.data)
+		UnmapViewOfFile(file.data);
+	if (file.mapping)
+		CloseHandle(file.mapping);
+	if (file.file != INVALID_HANDLE_VALUE)
+		CloseHandle(file.file);
+	file.file = INVALID_HANDLE_VALUE;
+	file.mapping = NULL;
+	file.data = 0;
+	file.size = 0;
+}
+
+
+bool OS_LockFile(OS_MappedFile& file)
+{
+	OVERLAPPED overlapped = {0};
+	return LockFileEx(file.file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped) != 0;
+}
+
+
+void OS_UnlockFile(OS_MappedFile& file)
+{
+	OVERLAPPED overlapped = {0};
+	UnlockFileEx(file.file, 0, 1, 0, &overlapped);
+}
+
+
+bool OS_ReplaceFile(const char* from, const char* to)
+{
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+// Offsets are 64 bits even where long is not.
+bool OS_SeekFile(FILE* file, unsigned long long offset, int origin)
+{
+	return _fseeki64(file, (__int64)offset, origin) == 0;
+}
+
+unsigned long long OS_TellFile(FILE* file)
+{
+	return (unsigned long long)_ftelli64(file);
+}
+
+
+//
+// Threads
+//
+struct OS_ThreadStart {
+	OS_ThreadFunction function;
+	void* arg;
+};
+
+static unsigned __stdcall ThreadStart(void* arg)
+{
+	OS_ThreadStart start = *(OS_ThreadStart*)arg;
+	delete (OS_ThreadStart*)arg;
+	start.function(start.arg);
+	return 0;
+}
+
+
+bool OS_CreateThread(OS_Thread& thread, OS_ThreadFunction function, void* arg)
+{
+	OS_ThreadStart* start = new OS_ThreadStart;
+	start->function = function;
+	start->arg = arg;
+	thread = (HANDLE)_beginthreadex(NULL, 0, ThreadStart, start, 0, NULL);
+	if (!thread)
+	{
+		delete start;
+		return false;
+	}
+	return true;
+}
+
+
+void OS_JoinThread(OS_Thread& thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+	thread = NULL;
+}
+
+
+int OS_GetProcessorCount()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+
+unsigned OS_GetThreadId()
+{
+	return (unsigned)GetCurrentThreadId();
+}
+
+
+//
+// Timing
+//
+double OS_GetTime()
+{
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart / (double)frequency.QuadPart;
+}
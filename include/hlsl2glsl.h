@@ -121,6 +121,14 @@ typedef struct
 } ShUniformInfo;
 
 
+/// A macro defined before the source is preprocessed, as if by "#define name value".
+typedef struct
+{
+	const char *name;		///< identifier
+	const char *value;		///< replacement text; null or empty for an empty macro
+} ShMacroDefine;
+
+
 /// Target language version
 enum ETargetVersion
 {
@@ -174,6 +182,24 @@ typedef HlslCrossCompiler* ShHandle;
 typedef void*(*GlobalAllocateFunction)(unsigned, void*);
 typedef void(*GlobalFreeFunction)(void*, void*);
 
+/// Resolves an #include directive; see Hlsl2Glsl_SetIncludeHandler.
+/// \param isSystem
+///		True for #include <file>, false for #include "file".
+/// \param fileName
+///		File name as written in the directive.
+/// \param includerName
+///		Name of the file containing the directive; null for the main shader.
+/// \param data
+///		Receives the contents of the file, which need not be null terminated.
+/// \param size
+///		Receives the size of the contents in bytes.
+/// \return
+///		True if the file was found.
+typedef bool(*IncludeOpenFunction)(bool isSystem, const char* fileName, const char* includerName, const char** data, unsigned* size, void* userData);
+
+/// Releases contents returned by an IncludeOpenFunction.
+typedef void(*IncludeCloseFunction)(const char* data, void* userData);
+
 /// Initialize the HLSL2GLSL translator.  This function must be called once prior to calling any other
 /// HLSL2GLSL translator functions
 /// \return
@@ -197,6 +223,15 @@ SH_IMPORT_EXPORT ShHandle C_DECL Hlsl2Glsl_ConstructCompiler( const EShLanguage
 SH_IMPORT_EXPORT void C_DECL Hlsl2Glsl_DestructCompiler( ShHandle handle );
 
 
+/// Make a compiler ready to parse another shader, as if it had just been constructed for the
+/// same language.  Settings made through Hlsl2Glsl_SetIncludeHandler,
+/// Hlsl2Glsl_SetUserAttributeNames and Hlsl2Glsl_UseUserVaryings are kept.  The memory
+/// holding the last results is kept to be filled again, so a thread compiling many shaders
+/// can reuse one compiler per language instead of constructing and destroying one for each.
+/// A compiler must be reset, or a new one constructed, before it parses a second shader.
+SH_IMPORT_EXPORT void C_DECL Hlsl2Glsl_ResetCompiler( ShHandle handle );
+
+
 
 /// Parse HLSL shader to prepare it for final translation.
 SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_Parse(
@@ -207,6 +242,86 @@ SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_Parse(
 	unsigned options);
 
 
+/// Parse HLSL shader like Hlsl2Glsl_Parse, with macros defined before the source is scanned.
+/// The defines go straight into the preprocessor's macro table, so variants do not need
+/// "#define" lines pasted in front of the source.
+/// \param defines
+///      Macros to define; can be null if defineCount is 0.  A name given more than once
+///      takes the last value.
+/// \param defineCount
+///      Number of entries in defines
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_ParseWithDefines(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	const char* cgProfile,
+	ETargetVersion targetVersion,
+	unsigned options);
+
+
+/// Check a HLSL shader for errors without translating it: it is preprocessed, parsed and
+/// type checked like Hlsl2Glsl_ParseWithDefines, but no GLSL is generated, so editors and
+/// build steps that only want the diagnostics do not pay for it.  The compiler is reset
+/// first and holds nothing to translate afterwards.  Errors go to Hlsl2Glsl_GetInfoLog.
+/// \param maxErrors
+///      Number of errors after which checking stops, so a broken shader is not followed
+///      through a cascade of errors caused by the first ones; 0 reports them all
+/// \return
+///      1 if the shader has no errors, 0 otherwise
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_Validate(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	const char* cgProfile,
+	ETargetVersion targetVersion,
+	int maxErrors);
+
+
+/// Run only the preprocessor over a HLSL shader, without parsing it.  Useful to find
+/// shader variants that preprocess to the same tokens before paying for a full parse.
+///
+/// \param handle
+///      Handle to the compiler.  The include handler, if any, resolves #include.
+/// \param shaderString
+///      Source to preprocess
+/// \param defines
+///      Macros to define before the source is scanned; can be null if defineCount is 0
+/// \param defineCount
+///      Number of entries in defines
+/// \param options
+///      Reserved, pass 0
+/// \return
+///      1 on success, 0 on failure; errors are in the info log.
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_Preprocess(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	unsigned options);
+
+
+/// After preprocessing, retrieve the preprocessed source: tokens separated by single spaces,
+/// one line per source line that produced tokens.  Comments and blank lines are removed.
+/// The text is owned by the compiler and stays valid until the next Hlsl2Glsl_Preprocess call.
+SH_IMPORT_EXPORT const char* C_DECL Hlsl2Glsl_GetPreprocessedSource( const ShHandle handle );
+
+
+/// After preprocessing, retrieve the preprocessed tokens.  Each token is an index into
+/// the token spellings (see Hlsl2Glsl_GetPreprocessedTokenSpelling), which are numbered in
+/// order of first appearance, so two sources with equal token arrays and spellings
+/// preprocess to the same thing.
+/// \param count
+///      Receives the number of tokens
+SH_IMPORT_EXPORT const int* C_DECL Hlsl2Glsl_GetPreprocessedTokens( const ShHandle handle, int* count );
+
+
+/// After preprocessing, retrieve the text of a token index returned by
+/// Hlsl2Glsl_GetPreprocessedTokens; null if the index is out of range.
+SH_IMPORT_EXPORT const char* C_DECL Hlsl2Glsl_GetPreprocessedTokenSpelling( const ShHandle handle, int token );
+
+
 
 /// After parsing a HLSL shader, do the final translation to GLSL.
 SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_Translate(
@@ -217,12 +332,80 @@ SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_Translate(
 
 
 /// After translating HLSL shader(s), retrieve the translated GLSL source.
+/// The returned text is owned by the compiler and stays valid until the next
+/// Hlsl2Glsl_Translate call or until the compiler is destroyed.
 SH_IMPORT_EXPORT const char* C_DECL Hlsl2Glsl_GetShader( const ShHandle handle );
 
 
+/// After translating, retrieve the length of the translated GLSL source,
+/// not counting the terminating null.
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_GetShaderLength( const ShHandle handle );
+
+
+/// After translating, copy the translated GLSL source into a caller-supplied buffer.
+/// \param buffer
+///		Destination; receives at most bufferSize-1 characters plus a terminating null.
+///		Can be null if bufferSize is 0, which just queries the length.
+/// \param bufferSize
+///		Size of the destination buffer in bytes.
+/// \return
+///		Length of the full shader text (not counting the terminating null); if this is
+///		not less than bufferSize, the text was truncated.
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_CopyShader( const ShHandle handle, char* buffer, int bufferSize );
+
+
+/// Retrieve the warnings and errors of the compiler's last parse and translation as text,
+/// followed by any debug output such as the dump ETranslateOpIntermediate asks for.
 SH_IMPORT_EXPORT const char* C_DECL Hlsl2Glsl_GetInfoLog( const ShHandle handle );
 
 
+/// How serious a diagnostic is.
+typedef enum
+{
+	EShSeverityWarning,
+	EShSeverityError,
+	EShSeverityInternalError,	///< a fault of the translator rather than of the shader
+} EShSeverity;
+
+
+/// One warning or error from the info log, taken apart so tools need not parse the text.
+typedef struct
+{
+	EShSeverity severity;
+	const char* file;			///< file named by #include or #line that the message points into; null for the shader itself or when there is no location
+	int line;					///< line the message points at; 0 when it has no location
+	const char* text;			///< the message, without severity or location; points into the info log and is not null terminated
+	int textLength;				///< length of text
+} ShDiagnostic;
+
+
+/// After parsing, and translating if wanted, retrieve the warnings and errors in the order
+/// they appear in Hlsl2Glsl_GetInfoLog.  The line the log ends with counting the errors is
+/// not one of them.  The array and the strings it points to are valid until the compiler
+/// parses again, is reset or is destructed.
+///
+/// \param diagnostics
+///      Receives the array; null if there are none
+/// \param droppedCount
+///      If not null, receives how many diagnostics were left out by Hlsl2Glsl_SetDiagnosticLimit
+/// \return
+///      Number of diagnostics
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_GetDiagnostics( const ShHandle handle, const ShDiagnostic** diagnostics, int* droppedCount );
+
+
+/// Keep at most limit warnings and errors from each parse and translation.  Ones after that
+/// are left out of both the info log and Hlsl2Glsl_GetDiagnostics, so a badly broken shader
+/// does not produce a log larger than anyone will read.  The line counting the errors is
+/// always kept, and still counts all of them.  The limit is kept across
+/// Hlsl2Glsl_ResetCompiler.
+///
+/// \param limit
+///      Most diagnostics to keep; 0, the default, keeps them all
+/// \return
+///      1 on success, 0 if the handle is null
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_SetDiagnosticLimit( ShHandle handle, int limit );
+
+
 /// After translating, retrieve the number of uniforms
 SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_GetUniformCount( const ShHandle handle );
 
@@ -231,6 +414,76 @@ SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_GetUniformCount( const ShHandle handle );
 SH_IMPORT_EXPORT const ShUniformInfo* C_DECL Hlsl2Glsl_GetUniformInfo( const ShHandle handle );
 
 
+/// What one pass over the syntax tree cost.  Passes that are ready together share walks
+/// of the tree, so the time of a shared walk counts for each of them.
+typedef struct
+{
+	const char* name;			///< FindInputs for the first walk, which counts the nodes
+	double time;				///< seconds spent in the walks the pass took part in
+	int walkCount;				///< walks of the tree the pass took part in
+	int nodeCount;				///< nodes those walks handed to the pass
+	int skipped;				///< nonzero if the tree had nothing for the pass to work on
+} ShPassStats;
+
+
+/// Where the time and memory of a compiler's last parse and translation went.  Times are
+/// wall-clock seconds.
+typedef struct
+{
+	double preprocessTime;		///< macro expansion and #include, before parsing starts
+	double parseTime;			///< building the syntax tree from the preprocessed tokens
+	double transformTime;		///< the passes over the tree before GLSL is generated
+	double produceTime;			///< the pass generating GLSL for each function
+	double linkTime;			///< Hlsl2Glsl_Translate; 0 if its result came from the result cache
+	double cleanupTime;			///< assembling the final text out of the generated pieces
+	unsigned peakPoolBytes;		///< most pool memory the parse held at once, beyond what was held before it
+	unsigned allocationCount;	///< pool allocations made during the parse
+	unsigned allocatedBytes;	///< bytes asked for by those allocations
+	int nodeCount;				///< nodes in the syntax tree, before it is transformed
+	int outputLength;			///< length of the translated GLSL, as Hlsl2Glsl_GetShaderLength
+	int passCount;				///< entries in passes
+	const ShPassStats* passes;	///< the passes over the tree in the order they were set up; valid until the compiler parses again, is reset or is destructed
+} ShCompileStats;
+
+
+/// After parsing, and translating if wanted, retrieve timing and memory statistics for the
+/// compiler's last Hlsl2Glsl_ParseWithDefines and Hlsl2Glsl_Translate.  Phases that did not
+/// run, such as when a parse was skipped because its result was cached, report zero.  Asking
+/// builds the final GLSL text if Hlsl2Glsl_GetShader has not already done so.
+///
+/// \param stats
+///      Receives the statistics
+/// \return
+///      1 on success, 0 if the handle or stats is null
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_GetCompileStats( const ShHandle handle, ShCompileStats* stats );
+
+
+/// Trace every compile in the process to a file in the Chrome trace event format, which
+/// chrome://tracing and Perfetto open.  Each phase of each compile becomes an event on the
+/// thread that ran it: Preprocess inside Parse, one event per walk of the syntax tree named
+/// after the passes that shared it (PropagateSamplerTypes, PropagateMutableUniforms,
+/// ProduceGLSL, ...), Link, and Cleanup when the final text is assembled.  Events carry the
+/// shader's name and sizes such as sourceBytes, nodes and outputBytes.
+///
+/// Setting the HLSL2GLSL_TRACE environment variable to a path starts a trace at
+/// Hlsl2Glsl_Initialize.  A trace ends at Hlsl2Glsl_Finalize or Hlsl2Glsl_Shutdown.
+///
+/// \param path
+///      File to write, replacing it; null ends the trace being written
+/// \return
+///      1 on success, 0 if the file could not be created
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_SetTraceFile ( const char* path );
+
+
+/// Name the shader a compiler works on, such as by its path, to label its trace events.
+///
+/// \param name
+///      Copied; null or empty leaves the events unlabelled
+/// \return
+///      1 on success, 0 if the handle is null
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_SetShaderName ( ShHandle handle, const char* name );
+
+
 /// Instead of mapping HLSL attributes to GLSL fixed-function attributes, this function can be used to 
 /// override the  attribute mapping.  This tells the code generator to use user-defined attributes for 
 /// the semantics that are specified.
@@ -267,6 +520,175 @@ SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_UseUserVaryings ( ShHandle handle,
 
 SH_IMPORT_EXPORT bool C_DECL Hlsl2Glsl_VersionUsesPrecision (ETargetVersion version);
 
+
+/// Set the callbacks that supply files named by #include directives.  Without a handler
+/// #include is an error.
+///
+/// The tokens of each included file are cached for the life of the process, keyed by
+/// file name and a hash of the contents, so a header included by many shaders is only
+/// tokenized again when its contents change.
+///
+/// \param handle
+///      Handle to the compiler.  This should be called BEFORE calling Hlsl2Glsl_Parse
+/// \param openFunc
+///      Called for each #include; null removes the handler
+/// \param closeFunc
+///      Called once the contents from openFunc have been read; can be null
+/// \param userData
+///      Passed through to both callbacks
+/// \return
+///      1 on success, 0 on failure
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_SetIncludeHandler ( ShHandle handle,
+                                                          IncludeOpenFunction openFunc,
+                                                          IncludeCloseFunction closeFunc,
+                                                          void* userData );
+
+
+/// Enable a process-wide cache of translation results.  A shader is keyed by a 128-bit hash of
+/// its preprocessed tokens (with their line numbers) and every setting that affects the output:
+/// language, Cg profile, target versions, options, entry point, user attribute names and
+/// user varyings.  Shaders whose sources differ only in ways the preprocessor removes, such as
+/// comments or macros they do not use, share a result.
+///
+/// Once a shader's tokens are known to have parsed before, Hlsl2Glsl_Parse only preprocesses it,
+/// and a cache hit in Hlsl2Glsl_Translate returns the GLSL text and uniform table without
+/// parsing.  Warnings are not cached, so a hit has an empty info log.
+///
+/// \param maxBytes
+///      Approximate memory the cache may use; least recently used results are dropped
+///      first.  0 disables and empties the cache, which is the default.
+SH_IMPORT_EXPORT void C_DECL Hlsl2Glsl_SetResultCacheSize ( unsigned maxBytes );
+
+
+/// Back the result cache with a directory, so that results persist across runs and are shared
+/// by every process using it.  The directory holds an append-only data file, results.dat, and
+/// a memory-mapped hash index, results.idx, both keyed as for Hlsl2Glsl_SetResultCacheSize.
+/// It is consulted after the in-memory cache, which need not be enabled.
+///
+/// Writers may share a directory; they take turns through a lock on the index.  Readers take
+/// no lock, and are meant for worker processes sharing a cache that one process fills.  When
+/// the data file would grow past maxBytes, a writer rewrites the cache keeping the most
+/// recently used results that fit in half of it.  Only writers record use, so results that
+/// are only ever hit by readers are the first to go.
+///
+/// \param path
+///      Existing directory to keep the cache in, or null to stop using one
+/// \param maxBytes
+///      Cap on the size of the data file; unused when readOnly
+/// \param readOnly
+///      Look results up but never add them.  Fails if the directory holds no cache yet.
+/// \return
+///      1 on success, 0 if the cache could not be opened
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_SetResultCacheDirectory ( const char* path, unsigned maxBytes, bool readOnly );
+
+
+/// One shader for Hlsl2Glsl_CompileBatch: the arguments of Hlsl2Glsl_ParseWithDefines and
+/// Hlsl2Glsl_Translate, plus where the outcome goes.
+typedef struct
+{
+	EShLanguage language;
+	const char* source;
+	const char* entry;
+	const char* cgProfile;				///< can be null
+	ETargetVersion targetVersion;		///< used for both parsing and translation
+	unsigned options;					///< TTranslateOptions, used for both parsing and translation
+	const ShMacroDefine* defines;		///< can be null if defineCount is 0
+	int defineCount;
+	IncludeOpenFunction includeOpen;	///< can be null; see Hlsl2Glsl_SetIncludeHandler
+	IncludeCloseFunction includeClose;
+	void* includeUserData;
+	const char* name;					///< can be null; see Hlsl2Glsl_SetShaderName
+
+	ShHandle compiler;					///< set by Hlsl2Glsl_CompileBatch
+	int result;							///< set by Hlsl2Glsl_CompileBatch; 1 if the shader parsed and translated
+} ShCompileJob;
+
+
+/// Parse and translate many shaders on a pool of threads inside this process.  Each job gets
+/// its own compiler, which is left in the job for the caller to query as after
+/// Hlsl2Glsl_Translate (Hlsl2Glsl_GetShader, Hlsl2Glsl_GetInfoLog, ...) and to destroy with
+/// Hlsl2Glsl_DestructCompiler.  Results land in the job they came from, whatever order the
+/// jobs ran in.
+///
+/// The calling thread works too, and any other threads are started and stopped by this call;
+/// each has its own allocator and its own view of the built-in symbol tables.  Each thread
+/// starts on a contiguous share of the jobs and steals from the others once it runs out.
+/// Include handlers are called from the worker threads, so they must be thread safe.
+///
+/// \param jobs
+///      Jobs to run; their compiler and result fields are overwritten
+/// \param count
+///      Number of jobs
+/// \param threads
+///      Most threads to use, counting the calling one; 0 uses one per processor
+/// \return
+///      1 if every job succeeded, 0 otherwise
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_CompileBatch ( ShCompileJob* jobs, int count, int threads );
+
+
+/// How work queued by Hlsl2Glsl_ParseAsync or Hlsl2Glsl_TranslateAsync ended.
+typedef enum
+{
+	EShAsyncSucceeded,
+	EShAsyncFailed,		///< Hlsl2Glsl_GetInfoLog has the errors
+	EShAsyncCancelled,	///< the work never ran
+} EShAsyncResult;
+
+/// Called once for every piece of queued work, with the compiler it was queued on.
+typedef void(*AsyncCallbackFunction)(ShHandle handle, EShAsyncResult result, void* userData);
+
+
+/// Queue Hlsl2Glsl_ParseWithDefines to run on a thread owned by the library, and return at
+/// once.  The arguments are copied, so the caller may change or free them straight away.
+/// The compiler is reset, as by Hlsl2Glsl_ResetCompiler, just before the parse runs, so a
+/// compiler that parsed before can be given the next version of a shader without a reset.
+///
+/// Work is run in the background by one thread per processor, started by the first call and
+/// stopped by Hlsl2Glsl_Finalize.  Work queued on the same compiler runs in the order it was
+/// queued and never overlaps, so a parse can be followed by Hlsl2Glsl_TranslateAsync without
+/// waiting for it.  The compiler must not otherwise be used until its callback has been
+/// called.  The callback, and the compiler's include handler, run on the worker thread.
+///
+/// \param callback
+///      Called when the parse has finished or been cancelled; can be null
+/// \return
+///      1 if the parse was queued, 0 if not, in which case the callback is not called
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_ParseAsync(
+	const ShHandle handle,
+	const char* shaderString,
+	const ShMacroDefine* defines,
+	int defineCount,
+	const char* cgProfile,
+	ETargetVersion targetVersion,
+	unsigned options,
+	AsyncCallbackFunction callback,
+	void* userData);
+
+
+/// Queue Hlsl2Glsl_Translate to run on a thread owned by the library; see Hlsl2Glsl_ParseAsync.
+/// If the last parse queued on the compiler failed, the translate does not run and its
+/// callback gets EShAsyncFailed, leaving the parse errors in Hlsl2Glsl_GetInfoLog.
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_TranslateAsync(
+	const ShHandle handle,
+	const char* entry,
+	ETargetVersion targetVersion,
+	unsigned options,
+	AsyncCallbackFunction callback,
+	void* userData);
+
+
+/// Cancel the work queued on a compiler that has not started yet, such as when the source it
+/// was for has been edited again.  Work already running is left to finish.  Callbacks of
+/// cancelled work are called from this function with EShAsyncCancelled.
+/// \return
+///      The number of pieces of work cancelled
+SH_IMPORT_EXPORT int C_DECL Hlsl2Glsl_CancelAsync( ShHandle handle );
+
+
+/// Wait until all work queued on a compiler has finished.  Hlsl2Glsl_DestructCompiler cancels
+/// and waits for a compiler's work itself, so it must not be called from that work's callback.
+SH_IMPORT_EXPORT void C_DECL Hlsl2Glsl_WaitAsync( ShHandle handle );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,799 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+//
+// Compile throughput benchmark over the test corpus.  Loads every shader of
+// the corpus into memory, then runs construct/parse/translate/destruct
+// cycles over them, round robin so each shader sees the same conditions, and
+// reports the latency of each shader and of all of them together.
+//
+// A run can be saved as a baseline, and a later run checked against one: the
+// check fails if the whole corpus, or one of the tracked shaders, got slower
+// or allocates more by more than the threshold.
+//
+// With -s it instead generates shaders that grow along one axis at a time,
+// such as the number of functions or samplers, and fits how compile time
+// grows with size along each.  An exponent well above 1 means some part of
+// the compiler is superlinear in that axis.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define snprintf _snprintf
+#else
+#include <dirent.h>
+#include <time.h>
+#endif
+#include "../../include/hlsl2glsl.h"
+
+
+static const char* kUsage =
+	"usage: hlsl2glslbench [options] [repository]\n"
+	"Times parsing and translating each shader of the test corpus.\n"
+	"\n"
+	"  -n count      timed cycles per shader (default 10, or 3 with -s)\n"
+	"  -w count      untimed cycles per shader first (default 1)\n"
+	"  -t name       also check this shader against the baseline, as\n"
+	"                fragment/pp-complex1; can be repeated\n"
+	"  -o file       save the results as a baseline\n"
+	"  -b file       compare the results with a baseline\n"
+	"  -r percent    slowdown or allocation growth that counts as a\n"
+	"                regression (default 10)\n"
+	"\n"
+	"  -s axes       measure scaling instead, along all axes or a comma\n"
+	"                separated list of: functions, calldepth, samplers,\n"
+	"                mutables, macros, structs, exprdepth, constarray, nonsquare\n"
+	"  -m size       largest size to generate (default 256)\n"
+	"  -x exponent   exponent above which an axis counts as superlinear\n"
+	"                (default 1.3)\n"
+	"  -g folder     also write the generated shaders to folder\n"
+	"\n"
+	"Exits with 0 on success, 1 if the baseline check finds a regression, an\n"
+	"axis is superlinear or a shader cannot be read, 2 on bad usage.\n";
+
+static const char* kBaselineHeader = "hlsl2glslbench baseline 1";
+
+
+// Where the corpus is, and how the shaders in each folder are translated.
+struct CorpusFolder {
+	const char* folder;
+	const char* label;
+	EShLanguage language;
+	const char* entry;
+	const char* profile;
+	ETargetVersion version;
+};
+
+static const CorpusFolder kCorpus[] = {
+	{ "tests/vertex", "vertex", EShLangVertex, "main", NULL, ETargetGLSL_110 },
+	{ "tests/fragment", "fragment", EShLangFragment, "main", NULL, ETargetGLSL_110 },
+	{ "tests/combined", "combined-vertex", EShLangVertex, "vs_main", "glslv", ETargetGLSL_120 },
+	{ "tests/combined", "combined-fragment", EShLangFragment, "ps_main", "glslf", ETargetGLSL_120 },
+	{ "nonsquared-matrix-test/vertex", "nonsquared", EShLangVertex, "main", NULL, ETargetGLSL_110 },
+};
+
+// The largest shaders, whose cost is checked on its own as well as in the total.
+static const char* kTracked[] = {
+	"fragment/z-fxaa3-11-pc39",
+	"fragment/pp-complex1",
+};
+
+
+struct Shader {
+	std::string name;
+	std::string source;
+	const CorpusFolder* folder;
+	std::vector<double> times;
+	unsigned allocations;
+	unsigned peakPoolBytes;
+	bool failed;
+	bool tracked;
+};
+
+struct Summary {
+	double p50, p90, p99;
+	unsigned allocations;
+	unsigned peakPoolBytes;
+};
+
+struct BaselineEntry {
+	std::string name;
+	Summary summary;
+};
+
+
+static double Now()
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return double(count.QuadPart) / double(frequency.QuadPart);
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+
+static bool EndsWith(const std::string& str, const std::string& sub)
+{
+	return str.size() >= sub.size() && str.compare(str.size() - sub.size(), sub.size(), sub) == 0;
+}
+
+
+static std::vector<std::string> GetFiles(const std::string& folder, const std::string& endsWith)
+{
+	std::vector<std::string> res;
+
+#ifdef _MSC_VER
+	WIN32_FIND_DATAA FindFileData;
+	HANDLE hFind = FindFirstFileA((folder + "/*" + endsWith).c_str(), &FindFileData);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return res;
+	do {
+		res.push_back(FindFileData.cFileName);
+	} while (FindNextFileA(hFind, &FindFileData));
+	FindClose(hFind);
+#else
+	DIR* dirp = opendir(folder.c_str());
+	if (!dirp)
+		return res;
+	while (dirent* dp = readdir(dirp))
+	{
+		std::string fname = dp->d_name;
+		if (EndsWith(fname, endsWith))
+			res.push_back(fname);
+	}
+	closedir(dirp);
+#endif
+
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+
+static bool ReadStringFromFile(const std::string& pathName, std::string& output)
+{
+	FILE* file = fopen(pathName.c_str(), "rb");
+	if (!file)
+		return false;
+	char buffer[4096];
+	size_t n;
+	output.clear();
+	while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		output.append(buffer, n);
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+
+// The time below which the given fraction of the sorted samples fall.
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0;
+	size_t rank = size_t(fraction * sorted.size() + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	if (rank > sorted.size())
+		rank = sorted.size();
+	return sorted[rank - 1];
+}
+
+
+static Summary Summarize(std::vector<double> times, unsigned allocations, unsigned peakPoolBytes)
+{
+	std::sort(times.begin(), times.end());
+	Summary summary;
+	summary.p50 = Percentile(times, 0.50);
+	summary.p90 = Percentile(times, 0.90);
+	summary.p99 = Percentile(times, 0.99);
+	summary.allocations = allocations;
+	summary.peakPoolBytes = peakPoolBytes;
+	return summary;
+}
+
+
+static void Compile(Shader& shader, bool timed)
+{
+	const CorpusFolder& folder = *shader.folder;
+
+	double start = Now();
+	ShHandle compiler = Hlsl2Glsl_ConstructCompiler(folder.language);
+	bool ok = Hlsl2Glsl_Parse(compiler, shader.source.c_str(), folder.profile, folder.version, 0) &&
+		Hlsl2Glsl_Translate(compiler, folder.entry, folder.version, 0);
+	double time = Now() - start;
+
+	ShCompileStats stats;
+	if (Hlsl2Glsl_GetCompileStats(compiler, &stats))
+	{
+		shader.allocations = stats.allocationCount;
+		shader.peakPoolBytes = stats.peakPoolBytes;
+	}
+	Hlsl2Glsl_DestructCompiler(compiler);
+
+	shader.failed = !ok;
+	if (timed)
+		shader.times.push_back(time);
+}
+
+
+static bool LoadCorpus(const std::string& root, const std::vector<std::string>& tracked, std::vector<Shader>& shaders)
+{
+	bool ok = true;
+	for (size_t f = 0; f < sizeof(kCorpus) / sizeof(kCorpus[0]); ++f)
+	{
+		const CorpusFolder& folder = kCorpus[f];
+		std::string path = root + "/" + folder.folder;
+		std::vector<std::string> files = GetFiles(path, "-in.txt");
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+			Shader shader;
+			shader.name = std::string(folder.label) + "/" + files[i].substr(0, files[i].size() - 7);
+			shader.folder = &folder;
+			shader.allocations = 0;
+			shader.peakPoolBytes = 0;
+			shader.failed = false;
+			shader.tracked = std::find(tracked.begin(), tracked.end(), shader.name) != tracked.end();
+			if (!ReadStringFromFile(path + "/" + files[i], shader.source))
+			{
+				printf("cannot read %s/%s\n", path.c_str(), files[i].c_str());
+				ok = false;
+				continue;
+			}
+			shaders.push_back(shader);
+		}
+	}
+	return ok;
+}
+
+
+static bool WriteBaseline(const char* path, const Summary& total, double shadersPerSecond, const std::vector<Shader>& shaders, const std::vector<Summary>& summaries)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+	fprintf(file, "%s\n", kBaselineHeader);
+	fprintf(file, "# name p50 p90 p99 (seconds) allocations peakPoolBytes\n");
+	fprintf(file, "total %.9g %.9g %.9g %u %u %.9g\n", total.p50, total.p90, total.p99, total.allocations, total.peakPoolBytes, shadersPerSecond);
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		const Summary& s = summaries[i];
+		fprintf(file, "shader %s %.9g %.9g %.9g %u %u\n", shaders[i].name.c_str(), s.p50, s.p90, s.p99, s.allocations, s.peakPoolBytes);
+	}
+	return fclose(file) == 0;
+}
+
+
+static bool ReadBaseline(const char* path, std::vector<BaselineEntry>& entries)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return false;
+	char line[1024];
+	bool ok = fgets(line, sizeof(line), file) && !strncmp(line, kBaselineHeader, strlen(kBaselineHeader));
+	while (ok && fgets(line, sizeof(line), file))
+	{
+		char kind[16], name[512];
+		BaselineEntry entry;
+		Summary& s = entry.summary;
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "total %lf %lf %lf %u %u", &s.p50, &s.p90, &s.p99, &s.allocations, &s.peakPoolBytes) == 5)
+			entry.name = "total";
+		else if (sscanf(line, "%15s %511s %lf %lf %lf %u %u", kind, name, &s.p50, &s.p90, &s.p99, &s.allocations, &s.peakPoolBytes) == 7 && !strcmp(kind, "shader"))
+			entry.name = name;
+		else
+			ok = false;
+		entries.push_back(entry);
+	}
+	fclose(file);
+	return ok;
+}
+
+
+static const Summary* FindBaseline(const std::vector<BaselineEntry>& entries, const std::string& name)
+{
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].name == name)
+			return &entries[i].summary;
+	}
+	return NULL;
+}
+
+
+// Prints and returns whether current is a regression from baseline.  Times
+// are compared at the median, which noise moves least.
+static bool Regressed(const std::string& name, const Summary& baseline, const Summary& current, double threshold)
+{
+	bool regressed = false;
+	double limit = 1.0 + threshold / 100.0;
+	if (current.p50 > baseline.p50 * limit)
+	{
+		printf("REGRESSION %s: median %.3fms -> %.3fms (%+.1f%%)\n", name.c_str(),
+			baseline.p50 * 1000, current.p50 * 1000, (current.p50 / baseline.p50 - 1) * 100);
+		regressed = true;
+	}
+	if (current.allocations > baseline.allocations * limit)
+	{
+		printf("REGRESSION %s: allocations %u -> %u\n", name.c_str(), baseline.allocations, current.allocations);
+		regressed = true;
+	}
+	return regressed;
+}
+
+
+static void PrintRow(const char* marker, const std::string& name, const Summary& s, const char* note)
+{
+	printf("%s %-44s %9.3f %9.3f %9.3f %9u %9u%s\n", marker, name.c_str(),
+		s.p50 * 1000, s.p90 * 1000, s.p99 * 1000, s.allocations, s.peakPoolBytes / 1024, note);
+}
+
+
+static void Append(std::string& out, const char* format, ...)
+{
+	char buffer[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	buffer[sizeof(buffer) - 1] = 0;
+	out += buffer;
+}
+
+
+//
+// Generators of shaders that grow along one axis.  Each writes a fragment
+// shader of size n along its axis; n of 0 gives the part that does not grow,
+// whose cost is taken off the larger sizes before fitting.
+//
+
+static const char* kMainBegin =
+	"float4 main(float2 uv : TEXCOORD0) : COLOR {\n"
+	"\tfloat4 r = float4(uv, 0.0, 1.0);\n";
+static const char* kMainEnd =
+	"\treturn r;\n"
+	"}\n";
+
+// Functions called once each from main.
+static void GenerateFunctions(int n, std::string& out)
+{
+	for (int i = 0; i < n; ++i)
+		Append(out, "float f%d(float x) { return x * %d.0 + 1.0; }\n", i, i);
+	out += kMainBegin;
+	for (int i = 0; i < n; ++i)
+		Append(out, "\tr.x += f%d(uv.x);\n", i);
+	out += kMainEnd;
+}
+
+// A chain of functions each calling the one before it.
+static void GenerateCallDepth(int n, std::string& out)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		if (i == 0)
+			Append(out, "float f0(float x) { return x + 1.0; }\n");
+		else
+			Append(out, "float f%d(float x) { return f%d(x) * 0.5 + 1.0; }\n", i, i - 1);
+	}
+	out += kMainBegin;
+	if (n)
+		Append(out, "\tr.x = f%d(uv.x);\n", n - 1);
+	out += kMainEnd;
+}
+
+// Untyped samplers, each passed to a helper that gives them their type.
+static void GenerateSamplers(int n, std::string& out)
+{
+	out += "float4 fetch(sampler s, float2 uv) { return tex2D(s, uv); }\n";
+	for (int i = 0; i < n; ++i)
+		Append(out, "sampler s%d;\n", i);
+	out += kMainBegin;
+	for (int i = 0; i < n; ++i)
+		Append(out, "\tr += fetch(s%d, uv);\n", i);
+	out += kMainEnd;
+}
+
+// Uniforms the shader writes to.
+static void GenerateMutables(int n, std::string& out)
+{
+	for (int i = 0; i < n; ++i)
+		Append(out, "float u%d;\n", i);
+	out += kMainBegin;
+	for (int i = 0; i < n; ++i)
+		Append(out, "\tu%d = u%d * 2.0;\n\tr.x += u%d;\n", i, i, i);
+	out += kMainEnd;
+}
+
+// Function-like macros expanded once each.
+static void GenerateMacros(int n, std::string& out)
+{
+	for (int i = 0; i < n; ++i)
+		Append(out, "#define M%d(x) ((x) * %d.0 + 1.0)\n", i, i);
+	out += kMainBegin;
+	for (int i = 0; i < n; ++i)
+		Append(out, "\tr.x += M%d(uv.x);\n", i);
+	out += kMainEnd;
+}
+
+// Structures, each with an overload of one function taking it, so every
+// call is resolved among all the overloads.
+static void GenerateStructs(int n, std::string& out)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		Append(out, "struct S%d { float4 a; float b; };\n", i);
+		Append(out, "float get(S%d s) { return s.a.x * s.b; }\n", i);
+	}
+	out += kMainBegin;
+	for (int i = 0; i < n; ++i)
+		Append(out, "\tS%d s%d;\n\ts%d.a = r;\n\ts%d.b = %d.0;\n\tr.x += get(s%d);\n", i, i, i, i, i, i);
+	out += kMainEnd;
+}
+
+// One expression nested n deep.
+static void GenerateExpressionDepth(int n, std::string& out)
+{
+	out += kMainBegin;
+	out += "\tr.x = ";
+	for (int i = 0; i < n; ++i)
+		out += i & 1 ? "(uv.y * " : "(uv.x + ";
+	out += "1.0";
+	out.append(n, ')');
+	out += ";\n";
+	out += kMainEnd;
+}
+
+// A constant array of n elements, summed in a loop.
+static void GenerateConstantArray(int n, std::string& out)
+{
+	if (n)
+	{
+		Append(out, "const float kTable[%d] = { ", n);
+		for (int i = 0; i < n; ++i)
+			Append(out, i ? ", %d.0" : "%d.0", i);
+		out += " };\n";
+	}
+	out += kMainBegin;
+	if (n)
+		Append(out, "\tfor (int i = 0; i < %d; ++i)\n\t\tr.x += kTable[i];\n", n);
+	out += kMainEnd;
+}
+
+// Products with a non-square matrix, each of which goes through a helper
+// function in the GLSL.
+static void GenerateNonSquare(int n, std::string& out)
+{
+	out += "uniform float4x3 m;\n";
+	out += kMainBegin;
+	for (int i = 0; i < n; ++i)
+		Append(out, "\tr.xyz += mul(float4(r.xyz, %d.0), m);\n", i);
+	out += kMainEnd;
+}
+
+typedef void (*GenerateFunction)(int n, std::string& out);
+
+struct ScalingAxis {
+	const char* name;
+	GenerateFunction generate;
+};
+
+static const ScalingAxis kAxes[] = {
+	{ "functions", GenerateFunctions },
+	{ "calldepth", GenerateCallDepth },
+	{ "samplers", GenerateSamplers },
+	{ "mutables", GenerateMutables },
+	{ "macros", GenerateMacros },
+	{ "structs", GenerateStructs },
+	{ "exprdepth", GenerateExpressionDepth },
+	{ "constarray", GenerateConstantArray },
+	{ "nonsquare", GenerateNonSquare },
+};
+
+
+// Median seconds of count cycles over source, or a negative time if it does
+// not translate.
+static double TimeSource(const std::string& source, int count)
+{
+	std::vector<double> times;
+	for (int i = 0; i < count; ++i)
+	{
+		double start = Now();
+		ShHandle compiler = Hlsl2Glsl_ConstructCompiler(EShLangFragment);
+		bool ok = Hlsl2Glsl_Parse(compiler, source.c_str(), NULL, ETargetGLSL_110, 0) &&
+			Hlsl2Glsl_Translate(compiler, "main", ETargetGLSL_110, 0);
+		double time = Now() - start;
+		if (!ok)
+			printf("%s", Hlsl2Glsl_GetInfoLog(compiler));
+		Hlsl2Glsl_DestructCompiler(compiler);
+		if (!ok)
+			return -1;
+		times.push_back(time);
+	}
+	std::sort(times.begin(), times.end());
+	return Percentile(times, 0.50);
+}
+
+
+// Slope of the least squares line through the points (log size, log time).
+static double FitExponent(const std::vector<int>& sizes, const std::vector<double>& times)
+{
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	size_t n = sizes.size();
+	for (size_t i = 0; i < n; ++i)
+	{
+		double x = log(double(sizes[i]));
+		double y = log(times[i]);
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+	double d = n * sxx - sx * sx;
+	return d > 0 ? (n * sxy - sx * sy) / d : 0;
+}
+
+
+static bool SelectAxes(const std::string& list, std::vector<const ScalingAxis*>& axes)
+{
+	size_t start = 0;
+	while (start <= list.size())
+	{
+		size_t comma = list.find(',', start);
+		std::string name = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+		bool found = false;
+		for (size_t i = 0; i < sizeof(kAxes) / sizeof(kAxes[0]); ++i)
+		{
+			if (name == "all" || name == kAxes[i].name)
+			{
+				axes.push_back(&kAxes[i]);
+				found = true;
+			}
+		}
+		if (!found)
+			return false;
+		if (comma == std::string::npos)
+			break;
+		start = comma + 1;
+	}
+	return true;
+}
+
+
+// Times each axis at sizes doubling from 8 up to maxSize, and returns
+// whether all of them translated and grew no faster than the limit.
+static bool RunScaling(const std::vector<const ScalingAxis*>& axes, int maxSize, int count, double limit, const char* folder)
+{
+	bool ok = true;
+	for (size_t a = 0; a < axes.size(); ++a)
+	{
+		const ScalingAxis& axis = *axes[a];
+		std::vector<int> sizes;
+		std::vector<double> times;
+		double fixedTime = 0;
+		bool failed = false;
+
+		printf("%-12s", axis.name);
+		for (int n = 0; n <= maxSize && !failed; n = n ? n * 2 : 8)
+		{
+			std::string source;
+			axis.generate(n, source);
+			if (folder)
+			{
+				char name[64];
+				snprintf(name, sizeof(name), "/%s-%d.hlsl", axis.name, n);
+				FILE* file = fopen((std::string(folder) + name).c_str(), "wb");
+				if (file)
+				{
+					fwrite(source.data(), 1, source.size(), file);
+					fclose(file);
+				}
+				else
+					printf(" (cannot write %s%s)", folder, name);
+			}
+
+			double time = TimeSource(source, count);
+			if (time < 0)
+			{
+				printf(" size %d does not translate", n);
+				failed = true;
+				break;
+			}
+			if (!n)
+			{
+				printf(" 0:%.2fms", time * 1000);
+				fixedTime = time;
+				continue;
+			}
+			printf(" %d:%.2fms", n, time * 1000);
+
+			// Growth that is small next to the fixed cost is mostly noise.
+			if (time - fixedTime >= fixedTime / 4)
+			{
+				sizes.push_back(n);
+				times.push_back(time - fixedTime);
+			}
+		}
+
+		if (failed)
+		{
+			printf("\n");
+			ok = false;
+			continue;
+		}
+		if (sizes.size() < 3)
+		{
+			printf("  not fitted, the fixed cost dominates; try a larger -m\n");
+			continue;
+		}
+		double exponent = FitExponent(sizes, times);
+		bool superlinear = exponent > limit;
+		printf("  exponent %.2f%s\n", exponent, superlinear ? "  SUPERLINEAR" : "");
+		ok &= !superlinear;
+	}
+	return ok;
+}
+
+
+int main(int argc, const char** argv)
+{
+	int iterations = 0;
+	int warmup = 1;
+	double threshold = 10;
+	const char* baselineOut = NULL;
+	const char* baselineIn = NULL;
+	std::string root = ".";
+	std::vector<std::string> tracked(kTracked, kTracked + sizeof(kTracked) / sizeof(kTracked[0]));
+	const char* scalingAxes = NULL;
+	int maxSize = 256;
+	double exponentLimit = 1.3;
+	const char* generatedFolder = NULL;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		if (arg[0] != '-')
+		{
+			root = arg;
+			continue;
+		}
+		if (!arg[1] || arg[2] || i + 1 >= argc)
+		{
+			printf("%s", kUsage);
+			return 2;
+		}
+		const char* value = argv[++i];
+		switch (arg[1])
+		{
+		case 'n': iterations = atoi(value); break;
+		case 'w': warmup = atoi(value); break;
+		case 't': tracked.push_back(value); break;
+		case 'o': baselineOut = value; break;
+		case 'b': baselineIn = value; break;
+		case 'r': threshold = atof(value); break;
+		case 's': scalingAxes = value; break;
+		case 'm': maxSize = atoi(value); break;
+		case 'x': exponentLimit = atof(value); break;
+		case 'g': generatedFolder = value; break;
+		default:
+			printf("%s", kUsage);
+			return 2;
+		}
+	}
+	std::vector<const ScalingAxis*> axes;
+	if (iterations < 0 || warmup < 0 || threshold < 0 || maxSize < 16 ||
+		(scalingAxes && !SelectAxes(scalingAxes, axes)))
+	{
+		printf("%s", kUsage);
+		return 2;
+	}
+
+	Hlsl2Glsl_Initialize(NULL, NULL, NULL);
+
+	if (scalingAxes)
+	{
+		bool ok = RunScaling(axes, maxSize, iterations ? iterations : 3, exponentLimit, generatedFolder);
+		Hlsl2Glsl_Shutdown();
+		return ok ? 0 : 1;
+	}
+	if (!iterations)
+		iterations = 10;
+
+	std::vector<Shader> shaders;
+	bool ok = LoadCorpus(root, tracked, shaders);
+	if (shaders.empty())
+	{
+		printf("no shaders found under %s\n", root.c_str());
+		Hlsl2Glsl_Shutdown();
+		return 1;
+	}
+
+	// Round robin over the corpus, so a slow patch of the machine's time
+	// spreads over every shader rather than landing on a few.
+	double start = Now();
+	for (int cycle = 0; cycle < warmup + iterations; ++cycle)
+	{
+		for (size_t i = 0; i < shaders.size(); ++i)
+			Compile(shaders[i], cycle >= warmup);
+	}
+	double wall = Now() - start;
+
+	std::vector<double> allTimes;
+	std::vector<Summary> summaries;
+	unsigned allocations = 0;
+	unsigned peakPoolBytes = 0;
+	double compileTime = 0;
+	printf("  %-44s %9s %9s %9s %9s %9s\n", "shader", "p50 ms", "p90 ms", "p99 ms", "allocs", "peak KB");
+	for (size_t i = 0; i < shaders.size(); ++i)
+	{
+		const Shader& shader = shaders[i];
+		summaries.push_back(Summarize(shader.times, shader.allocations, shader.peakPoolBytes));
+		PrintRow(shader.tracked ? "*" : " ", shader.name, summaries.back(), shader.failed ? "  (fails to translate)" : "");
+		allTimes.insert(allTimes.end(), shader.times.begin(), shader.times.end());
+		allocations += shader.allocations;
+		peakPoolBytes = std::max(peakPoolBytes, shader.peakPoolBytes);
+		for (size_t t = 0; t < shader.times.size(); ++t)
+			compileTime += shader.times[t];
+	}
+
+	// The total's allocations are those of one pass over the corpus, and its
+	// peak the largest of any shader.
+	Summary total = Summarize(allTimes, allocations, peakPoolBytes);
+	double shadersPerSecond = compileTime > 0 ? allTimes.size() / compileTime : 0;
+	PrintRow(" ", "total", total, "");
+	printf("%d shaders, %d cycles each: %.1f shaders/s, %.3fs in all\n",
+		(int)shaders.size(), iterations, shadersPerSecond, wall);
+
+	if (baselineOut && !WriteBaseline(baselineOut, total, shadersPerSecond, shaders, summaries))
+	{
+		printf("cannot write baseline %s\n", baselineOut);
+		ok = false;
+	}
+
+	if (baselineIn)
+	{
+		std::vector<BaselineEntry> entries;
+		if (!ReadBaseline(baselineIn, entries))
+		{
+			printf("cannot read baseline %s\n", baselineIn);
+			ok = false;
+		}
+		else
+		{
+			bool regressed = false;
+			const Summary* base = FindBaseline(entries, "total");
+			if (base)
+				regressed |= Regressed("total", *base, total, threshold);
+			for (size_t i = 0; i < shaders.size(); ++i)
+			{
+				if (!shaders[i].tracked)
+					continue;
+				base = FindBaseline(entries, shaders[i].name);
+				if (base)
+					regressed |= Regressed(shaders[i].name, *base, summaries[i], threshold);
+				else
+					printf("%s is not in the baseline\n", shaders[i].name.c_str());
+			}
+			printf("baseline check %s (threshold %.1f%%)\n", regressed ? "FAILED" : "passed", threshold);
+			ok &= !regressed;
+		}
+	}
+
+	Hlsl2Glsl_Shutdown();
+	return ok ? 0 : 1;
+}
@@ -598,6 +598,420 @@ static bool TestFile (TestRun type,
 	return false;
 }
 
+// In-memory #include files for the API tests below.
+struct TestIncludeFile
+{
+	const char* name;
+	const char* text;
+};
+
+struct TestIncludeHandler
+{
+	const TestIncludeFile* files;
+	int fileCount;
+	std::string opened;		// "includer>file;" for each file opened, with "-" for the shader itself
+};
+
+static bool OpenTestInclude (bool isSystem, const char* fileName, const char* includerName, const char** data, unsigned* size, void* userData)
+{
+	TestIncludeHandler& includes = *(TestIncludeHandler*)userData;
+	for (int i = 0; i < includes.fileCount; ++i)
+	{
+		if (strcmp (includes.files[i].name, fileName) != 0)
+			continue;
+		includes.opened += std::string(includerName ? includerName : "-") + ">" + (isSystem ? "<" : "") + fileName + ";";
+		*data = includes.files[i].text;
+		*size = (unsigned)strlen (includes.files[i].text);
+		return true;
+	}
+	return false;
+}
+
+
+// Parses, with the defines if there are any, and translates a fragment shader
+// with entry point main.  Returns the GLSL, or an empty string after printing
+// why it failed.
+static std::string CompileFragment (const char* source, TestIncludeHandler* includes, const ShMacroDefine* defines = NULL, int defineCount = 0)
+{
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	if (includes)
+		Hlsl2Glsl_SetIncludeHandler (parser, OpenTestInclude, NULL, includes);
+
+	std::string text;
+	int parseOk = defineCount ?
+		Hlsl2Glsl_ParseWithDefines (parser, source, defines, defineCount, NULL, ETargetGLSL_110, 0) :
+		Hlsl2Glsl_Parse (parser, source, NULL, ETargetGLSL_110, 0);
+	if (!parseOk)
+		printf ("  parse error: %s\n", Hlsl2Glsl_GetInfoLog (parser));
+	else if (!Hlsl2Glsl_Translate (parser, "main", ETargetGLSL_110, 0))
+		printf ("  translate error: %s\n", Hlsl2Glsl_GetInfoLog (parser));
+	else
+		text = Hlsl2Glsl_GetShader (parser);
+
+	Hlsl2Glsl_DestructCompiler (parser);
+	return text;
+}
+
+
+// Parses a fragment shader that is expected to fail, and returns its info log.
+static std::string ParseFailureLog (const char* source, TestIncludeHandler* includes, const ShMacroDefine* defines = NULL, int defineCount = 0)
+{
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	if (includes)
+		Hlsl2Glsl_SetIncludeHandler (parser, OpenTestInclude, NULL, includes);
+
+	std::string log;
+	if (Hlsl2Glsl_ParseWithDefines (parser, source, defines, defineCount, NULL, ETargetGLSL_110, 0))
+		printf ("  parse was expected to fail\n");
+	else
+		log = Hlsl2Glsl_GetInfoLog (parser);
+
+	Hlsl2Glsl_DestructCompiler (parser);
+	return log;
+}
+
+
+static bool Expect (bool condition, const char* what)
+{
+	if (!condition)
+		printf ("  %s\n", what);
+	return condition;
+}
+
+
+static bool TestIncludes ()
+{
+	TestIncludeFile files[] = {
+		{ "common.h", "#include <scale.h>\nfloat4 Scaled (float4 c) { return c * SCALE; }\n" },
+		{ "scale.h", "#define SCALE 2.0\n" },
+	};
+	TestIncludeHandler includes = { files, 2 };
+	const char* source =
+		"#include \"common.h\"\n"
+		"float4 main (float4 c : COLOR0) : COLOR0 { return Scaled (c); }\n";
+
+	bool res = true;
+	std::string glsl = CompileFragment (source, &includes);
+	res &= Expect (glsl.find ("c * 2.0") != std::string::npos, "included macro was not expanded");
+	res &= Expect (includes.opened == "->common.h;common.h><scale.h;", "files were not opened with their includers");
+
+	// The token cache must not replay a header whose contents have changed.
+	files[1].text = "#define SCALE 3.0\n";
+	glsl = CompileFragment (source, &includes);
+	res &= Expect (glsl.find ("c * 3.0") != std::string::npos, "changed header was not read again");
+
+	std::string log = ParseFailureLog ("#include \"missing.h\"\nfloat4 main () : COLOR0 { return 0.0; }\n", &includes);
+	res &= Expect (log.find ("Include file not found:") != std::string::npos && log.find ("missing.h") != std::string::npos, "missing include was not reported");
+	log = ParseFailureLog (source, NULL);
+	res &= Expect (log.find ("#include used without an include handler") != std::string::npos, "include without a handler was not reported");
+	return res;
+}
+
+
+// Preprocesses a shader and returns its tokens, spelled out and separated by
+// spaces; the lines they came from are not kept.
+static std::string PreprocessedTokens (ShHandle parser, const char* source, const ShMacroDefine* defines, int defineCount)
+{
+	std::string text;
+	if (!Hlsl2Glsl_Preprocess (parser, source, defines, defineCount, 0))
+	{
+		printf ("  preprocess error: %s\n", Hlsl2Glsl_GetInfoLog (parser));
+		return text;
+	}
+	int count = 0;
+	const int* tokens = Hlsl2Glsl_GetPreprocessedTokens (parser, &count);
+	for (int i = 0; i < count; ++i)
+	{
+		const char* spelling = Hlsl2Glsl_GetPreprocessedTokenSpelling (parser, tokens[i]);
+		text += std::string(i ? " " : "") + (spelling ? spelling : "<null>");
+	}
+	return text;
+}
+
+
+static bool TestPreprocess ()
+{
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	const ShMacroDefine defines[] = { { "SCALE", "2.0" } };
+	const char* source =
+		"// scaled colour\n"
+		"#define TWICE(x) ((x) * SCALE)\n"
+		"\n"
+		"float4 main (float4 c : COLOR0) : COLOR0\n"
+		"{ return TWICE(c); /* done */ }\n";
+	const char* expanded = "float4 main (float4 c : COLOR0) : COLOR0 { return ((c) * 2.0); }";
+
+	bool res = true;
+	std::string tokens = PreprocessedTokens (parser, source, defines, 1);
+	const char* text = Hlsl2Glsl_GetPreprocessedSource (parser);
+	res &= Expect (text && std::string(text) ==
+		"float4 main ( float4 c : COLOR0 ) : COLOR0\n"
+		"{ return ( ( c ) * 2.0 ) ; }\n", "preprocessed source is wrong");
+	res &= Expect (Hlsl2Glsl_GetPreprocessedTokenSpelling (parser, 0) && strcmp (Hlsl2Glsl_GetPreprocessedTokenSpelling (parser, 0), "float4") == 0, "spellings are not numbered in order of appearance");
+	res &= Expect (Hlsl2Glsl_GetPreprocessedTokenSpelling (parser, 1000) == NULL, "out of range spelling is not null");
+
+	// Sources that differ only in what the preprocessor removes give the same tokens.
+	res &= Expect (tokens == PreprocessedTokens (parser, expanded, NULL, 0), "expanded source gives different tokens");
+	res &= Expect (tokens == "float4 main ( float4 c : COLOR0 ) : COLOR0 { return ( ( c ) * 2.0 ) ; }", "tokens are wrong");
+
+	res &= Expect (!Hlsl2Glsl_Preprocess (parser, "#error stop here\n", NULL, 0, 0), "#error did not fail");
+	res &= Expect (strstr (Hlsl2Glsl_GetInfoLog (parser), "stop here") != NULL, "#error was not reported");
+
+	Hlsl2Glsl_DestructCompiler (parser);
+	return res;
+}
+
+
+static bool TestParseWithDefines ()
+{
+	bool res = true;
+
+	// A name given twice takes the last value; a null value defines it empty.
+	const ShMacroDefine defines[] = { { "SCALE", "2.0" }, { "USE_TINT", NULL }, { "SCALE", "3.0" } };
+	std::string glsl = CompileFragment (
+		"float4 main (float4 c : COLOR0) : COLOR0 {\n"
+		"#ifdef USE_TINT\n"
+		"	c.x = 0.5;\n"
+		"#endif\n"
+		"	return c * SCALE;\n"
+		"}\n", NULL, defines, 3);
+	res &= Expect (glsl.find ("c * 3.0") != std::string::npos, "last value of a define was not used");
+	res &= Expect (glsl.find ("c.x = 0.5") != std::string::npos, "empty define was not defined");
+
+	// The defines must not reach the non-square matrix support, which uses these names.
+	const ShMacroDefine clashing[] = { { "m", "oops" }, { "v", "oops" }, { "row", "oops" }, { "col0", "oops" } };
+	glsl = CompileFragment (
+		"uniform float4x3 mat;\n"
+		"float4 main (float4 c : COLOR0) : COLOR0 { return float4(mul(c, mat), 1.0); }\n", NULL, clashing, 4);
+	res &= Expect (!glsl.empty () && glsl.find ("oops") == std::string::npos, "defines were expanded in the non-square matrix support");
+
+	const ShMacroDefine invalid[] = { { "1bad", "x" } };
+	std::string log = ParseFailureLog ("float4 main (float4 c : COLOR0) : COLOR0 { return c; }\n", NULL, invalid, 1);
+	res &= Expect (log.find ("invalid macro name") != std::string::npos, "invalid define name was not reported");
+	return res;
+}
+
+
+// Parses and translates a fragment shader like CompileFragment, and also returns
+// how many nodes its parse built: none when the result cache let it skip the parse.
+static std::string CompileCounted (const char* source, ETargetVersion version, int& nodeCount)
+{
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	std::string text;
+	if (!Hlsl2Glsl_Parse (parser, source, NULL, version, 0))
+		printf ("  parse error: %s\n", Hlsl2Glsl_GetInfoLog (parser));
+	else if (!Hlsl2Glsl_Translate (parser, "main", version, 0))
+		printf ("  translate error: %s\n", Hlsl2Glsl_GetInfoLog (parser));
+	else
+		text = Hlsl2Glsl_GetShader (parser);
+
+	ShCompileStats stats;
+	nodeCount = Hlsl2Glsl_GetCompileStats (parser, &stats) ? stats.nodeCount : -1;
+	Hlsl2Glsl_DestructCompiler (parser);
+	return text;
+}
+
+
+static bool TestResultCache ()
+{
+	const char* source = "float4 main (float4 c : COLOR0) : COLOR0 { return c * 2.0; }\n";
+	const char* sameTokens = "float4 main (float4 c : COLOR0) : COLOR0 { return c * 2.0; /* again */ }\n";
+	const char* otherTokens = "float4 main (float4 c : COLOR0) : COLOR0 { return c * 4.0; }\n";
+
+	bool res = true;
+	int nodeCount;
+	Hlsl2Glsl_SetResultCacheSize (1 << 20);
+
+	std::string first = CompileCounted (source, ETargetGLSL_110, nodeCount);
+	res &= Expect (nodeCount > 0, "first compile did not parse");
+	std::string hit = CompileCounted (sameTokens, ETargetGLSL_110, nodeCount);
+	res &= Expect (nodeCount == 0, "source with the same tokens was parsed again");
+	res &= Expect (!first.empty () && hit == first, "cached result differs");
+
+	std::string other = CompileCounted (otherTokens, ETargetGLSL_110, nodeCount);
+	res &= Expect (nodeCount > 0 && other.find ("c * 4.0") != std::string::npos, "source with other tokens was not compiled");
+	std::string es = CompileCounted (source, ETargetGLSL_ES_100, nodeCount);
+	res &= Expect (nodeCount > 0 && !es.empty () && es != first, "other target was not compiled");
+
+	// A parse skipped while the cache held its result must still run if the
+	// cache is emptied before the translate.
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	res &= Expect (Hlsl2Glsl_Parse (parser, source, NULL, ETargetGLSL_110, 0) != 0, "cached parse failed");
+	Hlsl2Glsl_SetResultCacheSize (0);
+	res &= Expect (Hlsl2Glsl_Translate (parser, "main", ETargetGLSL_110, 0) && first == Hlsl2Glsl_GetShader (parser), "translate after emptying the cache is wrong");
+	Hlsl2Glsl_DestructCompiler (parser);
+
+	return res;
+}
+
+
+// Each piece of async work gets its own slot, as callbacks can run on
+// different threads.
+static void StoreAsyncResult (ShHandle handle, EShAsyncResult result, void* userData)
+{
+	*(int*)userData = result;
+}
+
+
+static bool TestAsync ()
+{
+	const char* source = "float4 main (float4 c : COLOR0) : COLOR0 { return c * 2.0; }\n";
+	bool res = true;
+
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	int parsed = -1, translated = -1;
+	Hlsl2Glsl_ParseAsync (parser, source, NULL, 0, NULL, ETargetGLSL_110, 0, StoreAsyncResult, &parsed);
+	Hlsl2Glsl_TranslateAsync (parser, "main", ETargetGLSL_110, 0, StoreAsyncResult, &translated);
+	Hlsl2Glsl_WaitAsync (parser);
+	res &= Expect (parsed == EShAsyncSucceeded && translated == EShAsyncSucceeded, "async compile failed");
+	res &= Expect (translated == EShAsyncSucceeded && strstr (Hlsl2Glsl_GetShader (parser), "c * 2.0") != NULL, "async compile gave wrong GLSL");
+
+	// The translate after a failed parse does not run, and the parse errors stay.
+	parsed = translated = -1;
+	Hlsl2Glsl_ParseAsync (parser, "float4 main () : COLOR0 { return undeclared; }\n", NULL, 0, NULL, ETargetGLSL_110, 0, StoreAsyncResult, &parsed);
+	Hlsl2Glsl_TranslateAsync (parser, "main", ETargetGLSL_110, 0, StoreAsyncResult, &translated);
+	Hlsl2Glsl_WaitAsync (parser);
+	res &= Expect (parsed == EShAsyncFailed && translated == EShAsyncFailed, "translate after a failed parse did not fail");
+	res &= Expect (strstr (Hlsl2Glsl_GetInfoLog (parser), "undeclared") != NULL, "parse errors were not kept");
+
+	// Work on one compiler runs in order, so all but the first few are still
+	// queued when they are cancelled.
+	const int kQueued = 16;
+	int results[kQueued];
+	for (int i = 0; i < kQueued; ++i)
+	{
+		results[i] = -1;
+		Hlsl2Glsl_ParseAsync (parser, source, NULL, 0, NULL, ETargetGLSL_110, 0, StoreAsyncResult, &results[i]);
+	}
+	int cancelled = Hlsl2Glsl_CancelAsync (parser);
+	Hlsl2Glsl_WaitAsync (parser);
+	int called = 0, cancelledCalls = 0;
+	for (int i = 0; i < kQueued; ++i)
+	{
+		called += results[i] != -1;
+		cancelledCalls += results[i] == EShAsyncCancelled;
+	}
+	res &= Expect (called == kQueued, "not every callback was called");
+	res &= Expect (cancelled > 0 && cancelledCalls == cancelled, "cancelled work was not reported as cancelled");
+	res &= Expect (results[kQueued - 1] == EShAsyncCancelled, "last queued parse was not cancelled");
+
+	Hlsl2Glsl_DestructCompiler (parser);
+	return res;
+}
+
+
+// Counts the errors a compiler's info log lists, leaving out the line with
+// the total.
+static int CountLoggedErrors (ShHandle parser)
+{
+	int count = 0;
+	for (const char* p = Hlsl2Glsl_GetInfoLog (parser); (p = strstr (p, "ERROR: ")) != NULL; p += 7)
+		count += p[7] == '\'';
+	return count;
+}
+
+
+static bool TestValidate ()
+{
+	const char* broken =
+		"float4 main (float4 c : COLOR0) : COLOR0 {\n"
+		"	float a = one;\n"
+		"	float b = two;\n"
+		"	float d = three;\n"
+		"	return c;\n"
+		"}\n";
+	bool res = true;
+
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	res &= Expect (!Hlsl2Glsl_Validate (parser, broken, NULL, 0, NULL, ETargetGLSL_110, 0), "broken shader validated");
+	res &= Expect (CountLoggedErrors (parser) == 3, "not every error was reported");
+	res &= Expect (!Hlsl2Glsl_Validate (parser, broken, NULL, 0, NULL, ETargetGLSL_110, 2), "broken shader validated with maxErrors");
+	res &= Expect (CountLoggedErrors (parser) == 2, "checking did not stop at maxErrors");
+	res &= Expect (strstr (Hlsl2Glsl_GetInfoLog (parser), "three") == NULL, "error after maxErrors was reported");
+
+	const ShMacroDefine defines[] = { { "ONE", "1.0" } };
+	res &= Expect (Hlsl2Glsl_Validate (parser, "float4 main (float4 c : COLOR0) : COLOR0 { return c * ONE; }\n", defines, 1, NULL, ETargetGLSL_110, 1) != 0, "valid shader did not validate");
+	res &= Expect (Hlsl2Glsl_GetInfoLog (parser)[0] == '\0', "valid shader has a log");
+	res &= Expect (!Hlsl2Glsl_Translate (parser, "main", ETargetGLSL_110, 0), "validated shader was left to translate");
+
+	Hlsl2Glsl_DestructCompiler (parser);
+	return res;
+}
+
+
+static bool DiagnosticIs (const ShDiagnostic& diagnostic, EShSeverity severity, const char* file, int line, const char* text)
+{
+	return diagnostic.severity == severity &&
+		(file ? diagnostic.file && strcmp (diagnostic.file, file) == 0 : !diagnostic.file) &&
+		diagnostic.line == line &&
+		std::string(diagnostic.text, diagnostic.textLength) == text;
+}
+
+
+static bool TestDiagnostics ()
+{
+	TestIncludeFile files[] = {
+		{ "bad.h", "static const float h = nothing;\n" },
+	};
+	TestIncludeHandler includes = { files, 1 };
+	const char* source =
+		"#include \"bad.h\" extra\n"
+		"float4 main (float4 c : COLOR0) : COLOR0 {\n"
+		"	float a = one;\n"
+		"	float b = two;\n"
+		"	return c;\n"
+		"}\n";
+	bool res = true;
+
+	ShHandle parser = Hlsl2Glsl_ConstructCompiler (EShLangFragment);
+	Hlsl2Glsl_SetIncludeHandler (parser, OpenTestInclude, NULL, &includes);
+	Hlsl2Glsl_Parse (parser, source, NULL, ETargetGLSL_110, 0);
+	const ShDiagnostic* diagnostics = NULL;
+	int dropped = -1;
+	int count = Hlsl2Glsl_GetDiagnostics (parser, &diagnostics, &dropped);
+	res &= Expect (count == 4 && dropped == 0, "wrong number of diagnostics");
+	if (count == 4)
+	{
+		res &= Expect (DiagnosticIs (diagnostics[0], EShSeverityWarning, NULL, 1, "unexpected tokens following #include preprocessor directive - expected a newline"), "warning is wrong");
+		res &= Expect (DiagnosticIs (diagnostics[1], EShSeverityError, "bad.h", 1, "'nothing' : undeclared identifier"), "error in the included file is wrong");
+		res &= Expect (DiagnosticIs (diagnostics[2], EShSeverityError, NULL, 3, "'one' : undeclared identifier"), "first error in the shader is wrong");
+		res &= Expect (DiagnosticIs (diagnostics[3], EShSeverityError, NULL, 4, "'two' : undeclared identifier"), "second error in the shader is wrong");
+	}
+
+	// The limit leaves diagnostics out of the log as well, but not out of the total.
+	Hlsl2Glsl_ResetCompiler (parser);
+	Hlsl2Glsl_SetDiagnosticLimit (parser, 2);
+	Hlsl2Glsl_Parse (parser, source, NULL, ETargetGLSL_110, 0);
+	count = Hlsl2Glsl_GetDiagnostics (parser, &diagnostics, &dropped);
+	res &= Expect (count == 2 && dropped == 2, "limit was not applied");
+	res &= Expect (strstr (Hlsl2Glsl_GetInfoLog (parser), "'one'") == NULL, "dropped error is in the log");
+	res &= Expect (strstr (Hlsl2Glsl_GetInfoLog (parser), "3 compilation errors") != NULL, "error total does not count dropped errors");
+
+	Hlsl2Glsl_ResetCompiler (parser);
+	Hlsl2Glsl_Parse (parser, "float4 main (float4 c : COLOR0) : COLOR0 { return c; }\n", NULL, ETargetGLSL_110, 0);
+	res &= Expect (Hlsl2Glsl_GetDiagnostics (parser, &diagnostics, &dropped) == 0 && !diagnostics, "clean shader has diagnostics");
+
+	Hlsl2Glsl_DestructCompiler (parser);
+	return res;
+}
+
+
+// Tests of the API beyond Parse and Translate, run after the shader files.
+static const struct
+{
+	const char* name;
+	bool (*run) ();
+} kApiTests[] = {
+	{ "includes", TestIncludes },
+	{ "preprocess", TestPreprocess },
+	{ "parse with defines", TestParseWithDefines },
+	{ "result cache", TestResultCache },
+	{ "async", TestAsync },
+	{ "validate", TestValidate },
+	{ "diagnostics", TestDiagnostics },
+};
+
+
 void Delete(void* p, void* ud);
 void* Allocate(unsigned size, void* ud);
 
@@ -680,6 +1094,15 @@ int main (int argc, const char** argv)
 		}
 	}
 
+	printf ("TESTING api...\n");
+	for (size_t i = 0; i < sizeof(kApiTests) / sizeof(kApiTests[0]); ++i)
+	{
+		printf ("test %s\n", kApiTests[i].name);
+		++tests;
+		if (!kApiTests[i].run ())
+			++errors;
+	}
+
 	clock_t time1 = clock();
 	float t = float(time1-time0) / float(CLOCKS_PER_SEC);
 	if (errors != 0)
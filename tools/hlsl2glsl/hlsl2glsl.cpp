@@ -0,0 +1,618 @@
+// Copyright (c) The HLSL2GLSLFork Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE.txt file.
+
+//
+// Command line translator.  Translates the given files, and the shader files
+// found under the given directories, on a pool of threads, writing the GLSL
+// and a JSON description of its uniforms next to each input or under an
+// output directory.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../../include/hlsl2glsl.h"
+
+
+static const char* kUsage =
+	"usage: hlsl2glsl [options] input...\n"
+	"Translates each input file, and each shader file under each input directory.\n"
+	"\n"
+	"  -e name        entry point (default main)\n"
+	"  -p profile     Cg profile; vs_* and vp* profiles select the vertex stage\n"
+	"  -s stage       vertex or fragment (default fragment, or as the profile says)\n"
+	"  -t target      es100, 110 or 120 (default 110)\n"
+	"  -D name[=val]  define a macro\n"
+	"  -I dir         search dir for #include files\n"
+	"  -x ext         translate files ending in .ext found in directories;\n"
+	"                 can be repeated (default hlsl, fx and cg)\n"
+	"  -o dir         write outputs under dir instead of next to the inputs\n"
+	"  -j n           use n threads; 0 means one per processor (default 0)\n"
+	"  --stats        print where the time went for each shader\n"
+	"  --trace file   write a Chrome trace of the compile phases to file\n"
+	"\n"
+	"For each input x.ext it writes x.glsl and x.json, which lists the uniforms.\n"
+	"Exits with 0 if every shader translated, 1 if any did not, 2 on bad usage.\n";
+
+
+struct Options {
+	const char* entry;
+	const char* profile;
+	EShLanguage language;
+	ETargetVersion target;
+	std::vector<ShMacroDefine> defines;
+	std::vector<std::string> defineText;
+	std::vector<std::string> includePaths;
+	std::vector<std::string> extensions;
+	std::string outputDir;
+	int threads;
+	bool stats;
+	const char* traceFile;
+};
+
+
+// A shader to translate, and where its results go.
+struct Input {
+	std::string path;
+	std::string output;				// path of the outputs without the extension
+	const char* source;
+	size_t mappedSize;				// 0 if source was read rather than mapped
+	std::string text;				// the source, if read
+	std::string includeDir;
+	std::set<std::string> includes;	// paths of the #include files opened, for nested includes
+	const Options* options;
+};
+
+
+static double Now()
+{
+	timeval t;
+	gettimeofday(&t, 0);
+	return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+
+static bool EndsWith(const std::string& str, const std::string& sub)
+{
+	return str.size() >= sub.size() && str.compare(str.size() - sub.size(), sub.size(), sub) == 0;
+}
+
+
+static std::string DirName(const std::string& path)
+{
+	size_t slash = path.rfind('/');
+	if (slash == std::string::npos)
+		return ".";
+	if (slash == 0)
+		return "/";
+	return path.substr(0, slash);
+}
+
+
+static std::string StripExtension(const std::string& path)
+{
+	size_t dot = path.rfind('.');
+	size_t slash = path.rfind('/');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return path;
+	return path.substr(0, dot);
+}
+
+
+static bool IsDirectory(const std::string& path)
+{
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+static bool MakeDirectories(const std::string& path)
+{
+	if (path.empty() || IsDirectory(path))
+		return true;
+	if (!MakeDirectories(DirName(path)))
+		return false;
+	return mkdir(path.c_str(), 0777) == 0 || errno == EEXIST;
+}
+
+
+static bool ReadFile(const std::string& path, std::string& text)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+	if (!f)
+		return false;
+	char buffer[4096];
+	size_t n;
+	text.clear();
+	while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		text.append(buffer, n);
+	bool ok = !ferror(f);
+	fclose(f);
+	return ok;
+}
+
+
+static bool WriteFile(const std::string& path, const std::string& text)
+{
+	if (!MakeDirectories(DirName(path)))
+		return false;
+	FILE* f = fopen(path.c_str(), "wb");
+	if (!f)
+		return false;
+	bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+	return fclose(f) == 0 && ok;
+}
+
+
+// Maps the file when the bytes after its end, which the kernel zeroes, make
+// it a null terminated string; reads it otherwise.
+static bool LoadSource(Input& input)
+{
+	input.source = 0;
+	input.mappedSize = 0;
+
+	int fd = open(input.path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	size_t size = (size_t)st.st_size;
+	long page = sysconf(_SC_PAGESIZE);
+	if (size > 0 && page > 0 && size % (size_t)page != 0)
+	{
+		void* data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			close(fd);
+			input.source = (const char*)data;
+			input.mappedSize = size;
+			return true;
+		}
+	}
+	close(fd);
+
+	if (!ReadFile(input.path, input.text))
+		return false;
+	input.source = input.text.c_str();
+	return true;
+}
+
+
+static void UnloadSource(Input& input)
+{
+	if (input.mappedSize)
+		munmap((void*)input.source, input.mappedSize);
+	input.source = 0;
+	input.mappedSize = 0;
+	std::string().swap(input.text);
+}
+
+
+//
+// #include "file" is looked for next to the file holding the directive and
+// then on the -I paths; #include <file> only on the -I paths.  Each file is
+// handed over behind a #line naming its path, so the library names it by
+// that path, not as the directive wrote it, when it includes files of its
+// own; same-named headers in different directories stay apart.  Each input
+// is compiled on one thread, so its set of opened files needs no lock.
+//
+static bool OpenInclude(bool isSystem, const char* fileName, const char* includerName, const char** data, unsigned* size, void* userData)
+{
+	Input& input = *(Input*)userData;
+
+	std::vector<std::string> dirs;
+	if (!isSystem)
+		dirs.push_back(includerName && input.includes.count(includerName) ? DirName(includerName) : input.includeDir);
+	const std::vector<std::string>& paths = input.options->includePaths;
+	dirs.insert(dirs.end(), paths.begin(), paths.end());
+
+	for (size_t i = 0; i < dirs.size(); ++i)
+	{
+		std::string path = fileName[0] == '/' ? std::string(fileName) : dirs[i] + "/" + fileName;
+		std::string text;
+		if (!ReadFile(path, text))
+			continue;
+		text.insert(0, "#line 1 \"" + path + "\"\n");
+		char* copy = (char*)malloc(text.size() + 1);
+		memcpy(copy, text.data(), text.size());
+		*data = copy;
+		*size = (unsigned)text.size();
+		input.includes.insert(path);
+		return true;
+	}
+	return false;
+}
+
+
+static void CloseInclude(const char* data, void*)
+{
+	free((void*)data);
+}
+
+
+static void FindInputs(const std::string& dir, const std::string& outputDir, const Options& options, std::vector<Input>& inputs)
+{
+	DIR* d = opendir(dir.c_str());
+	if (!d)
+		return;
+	std::vector<std::string> names;
+	while (dirent* entry = readdir(d))
+	{
+		std::string name = entry->d_name;
+		if (name != "." && name != "..")
+			names.push_back(name);
+	}
+	closedir(d);
+
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		std::string path = dir + "/" + names[i];
+		std::string output = outputDir.empty() ? std::string() : outputDir + "/" + names[i];
+		if (IsDirectory(path))
+		{
+			FindInputs(path, output, options, inputs);
+			continue;
+		}
+		for (size_t e = 0; e < options.extensions.size(); ++e)
+		{
+			if (!EndsWith(names[i], "." + options.extensions[e]))
+				continue;
+			Input input;
+			input.path = path;
+			input.output = StripExtension(output.empty() ? path : output);
+			inputs.push_back(input);
+			break;
+		}
+	}
+}
+
+
+static const char* TypeName(EShType type)
+{
+	static const char* names[] = {
+		"void", "bool", "bvec2", "bvec3", "bvec4", "int", "ivec2", "ivec3", "ivec4",
+		"float", "vec2", "vec3", "vec4", "mat2", "mat3", "mat4",
+		"sampler", "sampler1D", "sampler1DShadow", "sampler2D", "sampler2DShadow",
+		"sampler3D", "samplerCube", "sampler2DRect", "sampler2DRectShadow", "struct",
+	};
+	if (type < 0 || type >= (int)(sizeof(names) / sizeof(names[0])))
+		return "unknown";
+	return names[type];
+}
+
+
+static void AppendJsonString(std::string& json, const char* text)
+{
+	if (!text)
+	{
+		json += "null";
+		return;
+	}
+	json += '"';
+	for (const char* c = text; *c; ++c)
+	{
+		switch (*c)
+		{
+		case '"': json += "\\\""; break;
+		case '\\': json += "\\\\"; break;
+		case '\n': json += "\\n"; break;
+		case '\t': json += "\\t"; break;
+		default:
+			if ((unsigned char)*c < 0x20)
+			{
+				char escape[8];
+				snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)*c);
+				json += escape;
+			}
+			else
+				json += *c;
+		}
+	}
+	json += '"';
+}
+
+
+static std::string Reflect(const Input& input, ShHandle compiler)
+{
+	std::string json = "{\n\t\"source\": ";
+	AppendJsonString(json, input.path.c_str());
+	json += ",\n\t\"entry\": ";
+	AppendJsonString(json, input.options->entry);
+	json += ",\n\t\"uniforms\": [";
+
+	int count = Hlsl2Glsl_GetUniformCount(compiler);
+	const ShUniformInfo* uniforms = Hlsl2Glsl_GetUniformInfo(compiler);
+	for (int i = 0; i < count; ++i)
+	{
+		json += i ? ",\n\t\t{ \"name\": " : "\n\t\t{ \"name\": ";
+		AppendJsonString(json, uniforms[i].name);
+		json += ", \"semantic\": ";
+		AppendJsonString(json, uniforms[i].semantic);
+		json += ", \"type\": ";
+		AppendJsonString(json, TypeName(uniforms[i].type));
+		char arraySize[32];
+		snprintf(arraySize, sizeof(arraySize), ", \"arraySize\": %d }", uniforms[i].arraySize);
+		json += arraySize;
+	}
+	json += count ? "\n\t]\n}\n" : "]\n}\n";
+	return json;
+}
+
+
+static void PrintStats(const Input& input, ShHandle compiler)
+{
+	ShCompileStats stats;
+	if (!Hlsl2Glsl_GetCompileStats(compiler, &stats))
+		return;
+	printf("%s: preprocess %.3fms, parse %.3fms, transform %.3fms, produce %.3fms, link %.3fms, cleanup %.3fms\n",
+		input.path.c_str(), stats.preprocessTime * 1000, stats.parseTime * 1000, stats.transformTime * 1000,
+		stats.produceTime * 1000, stats.linkTime * 1000, stats.cleanupTime * 1000);
+	printf("  %d nodes, %u allocations of %u bytes, peak pool %u bytes, %d bytes out\n",
+		stats.nodeCount, stats.allocationCount, stats.allocatedBytes, stats.peakPoolBytes, stats.outputLength);
+	for (int i = 0; i < stats.passCount; ++i)
+	{
+		const ShPassStats& pass = stats.passes[i];
+		if (pass.skipped)
+			printf("  %-26s skipped\n", pass.name);
+		else
+			printf("  %-26s %.3fms, %d walks, %d nodes\n", pass.name, pass.time * 1000, pass.walkCount, pass.nodeCount);
+	}
+}
+
+
+static bool ParseOptions(int argc, char** argv, Options& options, std::vector<std::string>& paths)
+{
+	options.entry = "main";
+	options.profile = 0;
+	options.language = EShLangFragment;
+	options.target = ETargetGLSL_110;
+	options.threads = 0;
+	options.stats = false;
+	options.traceFile = 0;
+
+	const char* stage = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--stats")
+		{
+			options.stats = true;
+			continue;
+		}
+		if (arg == "--trace")
+		{
+			if (i + 1 >= argc)
+				return false;
+			options.traceFile = argv[++i];
+			continue;
+		}
+		if (arg.size() < 2 || arg[0] != '-')
+		{
+			paths.push_back(arg);
+			continue;
+		}
+
+		// The value of an option can follow it directly or be the next argument.
+		char flag = arg[1];
+		if (arg.size() > 2 && arg[1] == '-')
+			return false;
+		const char* value = arg.size() > 2 ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : 0);
+		if (!value)
+			return false;
+
+		switch (flag)
+		{
+		case 'e': options.entry = value; break;
+		case 'p': options.profile = value; break;
+		case 's': stage = value; break;
+		case 'D': options.defineText.push_back(value); break;
+		case 'I': options.includePaths.push_back(value); break;
+		case 'x': options.extensions.push_back(value[0] == '.' ? value + 1 : value); break;
+		case 'o': options.outputDir = value; break;
+		case 'j': options.threads = atoi(value); break;
+		case 't':
+			if (!strcmp(value, "es100"))
+				options.target = ETargetGLSL_ES_100;
+			else if (!strcmp(value, "110"))
+				options.target = ETargetGLSL_110;
+			else if (!strcmp(value, "120"))
+				options.target = ETargetGLSL_120;
+			else
+				return false;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	if (options.profile && (!strncmp(options.profile, "vs", 2) || !strncmp(options.profile, "vp", 2) || !strncmp(options.profile, "arbvp", 5)))
+		options.language = EShLangVertex;
+	if (stage)
+	{
+		if (!strcmp(stage, "vertex"))
+			options.language = EShLangVertex;
+		else if (!strcmp(stage, "fragment"))
+			options.language = EShLangFragment;
+		else
+			return false;
+	}
+	if (options.extensions.empty())
+	{
+		options.extensions.push_back("hlsl");
+		options.extensions.push_back("fx");
+		options.extensions.push_back("cg");
+	}
+
+	// Split NAME=VALUE now that the strings will not move again.
+	for (size_t i = 0; i < options.defineText.size(); ++i)
+	{
+		std::string& text = options.defineText[i];
+		size_t equals = text.find('=');
+		if (equals != std::string::npos)
+			text[equals] = 0;
+	}
+	for (size_t i = 0; i < options.defineText.size(); ++i)
+	{
+		const std::string& text = options.defineText[i];
+		ShMacroDefine define;
+		define.name = text.c_str();
+		size_t equals = strlen(define.name);
+		define.value = equals < text.size() ? text.c_str() + equals + 1 : 0;
+		options.defines.push_back(define);
+	}
+
+	return !paths.empty() && options.threads >= 0;
+}
+
+
+int main(int argc, char** argv)
+{
+	Options options;
+	std::vector<std::string> paths;
+	if (!ParseOptions(argc, argv, options, paths))
+	{
+		fputs(kUsage, stderr);
+		return 2;
+	}
+
+	std::vector<Input> inputs;
+	bool ok = true;
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		std::string path = paths[i];
+		while (path.size() > 1 && EndsWith(path, "/"))
+			path.erase(path.size() - 1);
+		if (IsDirectory(path))
+		{
+			FindInputs(path, options.outputDir, options, inputs);
+			continue;
+		}
+		Input input;
+		input.path = path;
+		size_t slash = path.rfind('/');
+		std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+		input.output = StripExtension(options.outputDir.empty() ? path : options.outputDir + "/" + name);
+		inputs.push_back(input);
+	}
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		inputs[i].includeDir = DirName(inputs[i].path);
+		inputs[i].options = &options;
+	}
+	if (inputs.empty())
+	{
+		fputs("hlsl2glsl: no shaders to translate\n", stderr);
+		return 1;
+	}
+
+	if (!Hlsl2Glsl_Initialize(0, 0, 0))
+	{
+		fputs("hlsl2glsl: could not initialize the translator\n", stderr);
+		return 1;
+	}
+	if (options.traceFile && !Hlsl2Glsl_SetTraceFile(options.traceFile))
+	{
+		fprintf(stderr, "hlsl2glsl: cannot write %s\n", options.traceFile);
+		ok = false;
+	}
+
+	// Work in chunks, so a large tree does not hold every source and
+	// result at once.
+	const size_t kChunkSize = 256;
+	double start = Now();
+	int translated = 0;
+	for (size_t first = 0; first < inputs.size(); first += kChunkSize)
+	{
+		size_t last = first + kChunkSize < inputs.size() ? first + kChunkSize : inputs.size();
+
+		std::vector<ShCompileJob> jobs;
+		std::vector<Input*> jobInputs;
+		for (size_t i = first; i < last; ++i)
+		{
+			Input& input = inputs[i];
+			if (!LoadSource(input))
+			{
+				fprintf(stderr, "%s: cannot read: %s\n", input.path.c_str(), strerror(errno));
+				ok = false;
+				continue;
+			}
+			ShCompileJob job;
+			memset(&job, 0, sizeof(job));
+			job.language = options.language;
+			job.source = input.source;
+			job.entry = options.entry;
+			job.cgProfile = options.profile;
+			job.targetVersion = options.target;
+			job.options = ETranslateOpNone;
+			job.defines = options.defines.empty() ? 0 : &options.defines[0];
+			job.defineCount = (int)options.defines.size();
+			job.includeOpen = OpenInclude;
+			job.includeClose = CloseInclude;
+			job.includeUserData = &input;
+			job.name = input.path.c_str();
+			jobs.push_back(job);
+			jobInputs.push_back(&input);
+		}
+		if (jobs.empty())
+			continue;
+
+		Hlsl2Glsl_CompileBatch(&jobs[0], (int)jobs.size(), options.threads);
+
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			Input& input = *jobInputs[i];
+			ShHandle compiler = jobs[i].compiler;
+			if (!compiler)
+			{
+				fprintf(stderr, "%s: could not create a compiler\n", input.path.c_str());
+				ok = false;
+			}
+			else if (!jobs[i].result)
+			{
+				fprintf(stderr, "%s: translation failed\n%s", input.path.c_str(), Hlsl2Glsl_GetInfoLog(compiler));
+				ok = false;
+			}
+			else
+			{
+				std::string glslPath = input.output + ".glsl";
+				std::string jsonPath = input.output + ".json";
+				if (!WriteFile(glslPath, Hlsl2Glsl_GetShader(compiler)) || !WriteFile(jsonPath, Reflect(input, compiler)))
+				{
+					fprintf(stderr, "%s: cannot write %s: %s\n", input.path.c_str(), input.output.c_str(), strerror(errno));
+					ok = false;
+				}
+				else
+					++translated;
+				if (options.stats)
+					PrintStats(input, compiler);
+			}
+			if (compiler)
+				Hlsl2Glsl_DestructCompiler(compiler);
+			UnloadSource(input);
+		}
+	}
+
+	if (options.stats)
+		printf("%d of %d shaders translated in %.3fs\n", translated, (int)inputs.size(), Now() - start);
+
+	Hlsl2Glsl_Finalize();
+	Hlsl2Glsl_Shutdown();
+	return ok ? 0 : 1;
+}